@@ -0,0 +1,73 @@
+#ifndef _INC_LHCOREADER
+#define _INC_LHCOREADER
+
+#include <string>
+#include <vector>
+#include <cmath>
+
+#include "Math/Vector4D.h"
+
+// Object type codes used in the LHCO format
+#define LHCO_PHOTON 0
+#define LHCO_ELECTRON 1
+#define LHCO_MUON 2
+#define LHCO_TAU 3
+#define LHCO_JET 4
+#define LHCO_MET 6
+
+// One line of an LHCO event:
+// #  typ  eta  phi  pt  jmas  ntrk  btag  had/em  dummy  dummy
+struct LHCOObject{
+  int type;
+  double eta, phi, pt, jmas, ntrk, btag, hadem;
+
+  // For leptons, the sign of ntrk gives the charge
+  inline int GetCharge() const { return (ntrk > 0) - (ntrk < 0); }
+  inline bool IsBTagged() const { return btag > 0; }
+  inline ROOT::Math::PtEtaPhiEVector GetP4() const {
+    const double p = pt * cosh(eta);
+    return ROOT::Math::PtEtaPhiEVector(pt, eta, phi, sqrt(p*p + jmas*jmas));
+  }
+};
+
+class LHCOEvent{
+  public:
+
+  // Objects of a given type, in the order of the file
+  // If charge != 0, only keep the objects with that charge; if bTagged is true, only keep b-tagged objects
+  std::vector<const LHCOObject*> GetObjects(const int type, const int charge = 0, const bool bTagged = false) const;
+
+  long number;
+  long trigger;
+  std::vector<LHCOObject> objects;
+};
+
+// Streaming reader for LHCO files.
+// The file is mapped in memory and parsed in place, without going through iostreams.
+// Events can be read sequentially (NextEvent) or by index (ReadEntry), in which case 
+// the offsets of all events are found with a quick scan of the file when it is opened.
+class LHCOReader{
+  public:
+
+  LHCOReader(const std::string &file);
+  ~LHCOReader();
+
+  inline long GetEntries() const { return _eventOffsets.size(); }
+  // Read the next event in the file, returns false at the end of the file
+  bool NextEvent(LHCOEvent &event);
+  // Read event number entry (starting at 0), returns false if out of range
+  bool ReadEntry(const long entry, LHCOEvent &event);
+
+  private:
+
+  void IndexEvents();
+
+  std::string _fileName;
+  int _fd;
+  const char* _data;
+  size_t _size;
+  const char* _pos;
+  std::vector<size_t> _eventOffsets;
+};
+
+#endif
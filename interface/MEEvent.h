@@ -3,6 +3,8 @@
 
 #include "Math/Vector4D.h"
 
+#include "fourVector.h"
+
 class MEEvent{
   public:
 
@@ -13,10 +15,21 @@ class MEEvent{
   inline const ROOT::Math::PtEtaPhiEVector& GetP5() const { return _p5; }
   inline const ROOT::Math::PtEtaPhiEVector& GetP6() const { return _p6; }
   inline const ROOT::Math::PtEtaPhiEVector& GetMet() const { return _Met; }
+  
+  // Integrand-side representation, computed once when the event is set
+  // i is the particle number: 3 = e+, 4 = b, 5 = mu-, 6 = bbar
+  inline const FourVector& GetVector(const int i) const { return _vectors[i-3]; }
+  inline const FourVectorCache& GetKinematics(const int i) const { return _kinematics[i-3]; }
+  inline const FourVector& GetMetVector() const { return _MetVector; }
+  // ISR vector defined from the observed particles and MET
+  inline const FourVector& GetISR() const { return _ISR; }
 
   private:
 
   ROOT::Math::PtEtaPhiEVector _p3, _p4, _p5, _p6, _Met;
+  FourVector _vectors[4];
+  FourVectorCache _kinematics[4];
+  FourVector _MetVector, _ISR;
 };
 
 #endif
@@ -0,0 +1,85 @@
+#ifndef _INC_MEMCPP
+#define _INC_MEMCPP
+
+#include <stdint.h>
+
+// C API of the weight computation, built as a shared library (make ttbar_lib => ttbar/libME_ttbar.so),
+// to compute the weights of batches of events directly from columnar data, without ROOT files.
+// Python bindings: python/memcpp.py.
+//
+// All the arrays are owned by the caller, and are neither copied nor kept after the call.
+// The events are given as a structure of arrays, and go through the same object selection as in ME_ttbar
+// (see EventSelection): lepton and jet cuts, b-tagging and maximal number of jets.
+// Errors in the arguments are reported by a non-zero return value, errors in the configuration
+// (missing TF or PDF, ...) still terminate the program, as in ME_ttbar.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum MEMcppIntegrator { MEMCPP_VEGAS = 0, MEMCPP_SOBOL = 1, MEMCPP_LATTICE = 2, MEMCPP_NATIVE = 3 };
+enum MEMcppTFType { MEMCPP_TF_BINNED = 0, MEMCPP_TF_SPLINE = 1, MEMCPP_TF_GAUSSIAN = 2 };
+// Same values as the status of the regression files
+enum MEMcppStatus { MEMCPP_NOT_SELECTED = 0, MEMCPP_WEIGHTED = 1, MEMCPP_PRESCREENED = 2 };
+
+// Same meaning and defaults as the options of ME_ttbar (see README), set by memcpp_default_config
+typedef struct{
+  const char *tfFile;       // ROOT TF file or table cache (required)
+  const char *pdfName;
+  const char *paramCard;
+  int integrator;           // MEMcppIntegrator
+  int nThreads;             // threads of the native integrator, each with its own process and PDF
+  double prune;
+  int preScreenPoints;
+  double preScreenMinWeight;
+  uint64_t seed;            // reproducible mode if non-zero, the events are then identified by their ID (see MEMcppEvents)
+  int tfSampling;
+  int tfTypes[3];           // MEMcppTFType of the electron, muon and jet TFs
+  const char *tfFiles[3];   // parameter files of the MEMCPP_TF_GAUSSIAN TFs
+  double leptonPtMin, leptonEtaMax;
+  double jetPtMin, jetEtaMax;
+  unsigned int bTagMask;    // 0 => all the jets are candidates for the b quarks
+  unsigned int maxJets;
+} MEMcppConfig;
+
+// Batch of nEvents events. Array x of event i is x[i], except for the jets: jet j of event i is x[i*jetStride + j],
+// for j < nJets[i]. The leptons (one e+ and one mu- per event) and jets are given as pt, eta, phi, E, the MET as pt, phi.
+typedef struct{
+  long nEvents;
+  const double *positronPt, *positronEta, *positronPhi, *positronE;
+  const double *muonPt, *muonEta, *muonPhi, *muonE;
+  int jetStride;
+  const int32_t *nJets;
+  const double *jetPt, *jetEta, *jetPhi, *jetE;
+  const int32_t *jetBTag;   // b-tagging word, compared to bTagMask (may be NULL if bTagMask = 0)
+  const double *metPt, *metPhi;
+  const int64_t *ids;       // event IDs for the seeds of the reproducible mode (may be NULL => index in the batch)
+} MEMcppEvents;
+
+// Results of each event: weight, error, CPU time (s) and MEMcppStatus. If counters is not NULL, it is filled
+// with the memcpp_n_counters() integrand stage counters of each event (counters[i*memcpp_n_counters() + k]).
+typedef struct{
+  double *weight, *error, *time;
+  int32_t *status;
+  uint64_t *counters;
+} MEMcppResults;
+
+typedef struct MEMcppHandle MEMcppHandle;
+
+void memcpp_default_config(MEMcppConfig *config);
+// Returns NULL on invalid configurations
+MEMcppHandle* memcpp_create(const MEMcppConfig *config);
+void memcpp_destroy(MEMcppHandle *handle);
+
+// Compute the weights of the events, returns 0 on success. A handle must not be used by several threads at once.
+int memcpp_compute(MEMcppHandle *handle, const MEMcppEvents *events, MEMcppResults *results);
+
+int memcpp_n_counters(void);
+// Name of the stage counter k, e.g. "rejected_visibles"
+const char* memcpp_counter_name(const int counter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef _INC_MEPERMUTATIONS
+#define _INC_MEPERMUTATIONS
+
+#include <vector>
+#include <utility>
+
+#include "Math/Vector4D.h"
+
+#include "MEEvent.h"
+
+// Enumerates the possible assignments of the selected jets to the b and anti-b quarks.
+// Every ordered pair of distinct jets defines one permutation, stored as a complete MEEvent
+// (per-event quantities are therefore computed once, when the objects are set).
+// With 2 jets, this gives the usual (b,bbar) and (bbar,b) assignments.
+class MEPermutations{
+  public:
+
+  void SetObjects(const ROOT::Math::PtEtaPhiEVector &ep, const ROOT::Math::PtEtaPhiEVector &mum, const std::vector<ROOT::Math::PtEtaPhiEVector> &jets, const ROOT::Math::PtEtaPhiEVector &met);
+
+  inline size_t GetNumberOfPermutations() const { return _events.size(); }
+  inline const MEEvent& GetPermutation(const size_t i) const { return _events[i]; }
+  // Indices (in the jet vector given to SetObjects) of the jets assigned to the b and anti-b quarks
+  inline const std::pair<size_t, size_t>& GetJetAssignment(const size_t i) const { return _assignments[i]; }
+
+  private:
+
+  std::vector<MEEvent> _events;
+  std::vector< std::pair<size_t, size_t> > _assignments;
+};
+
+#endif
@@ -15,41 +15,159 @@
 #include "TH1D.h"
 
 #include "transferFunction.h"
+#include "tableCache.h"
 #include "MEEvent.h"
+#include "MEPermutations.h"
+#include "integrandStages.h"
+#include "matrixElement.h"
+#include "qmcIntegrator.h"
+#include "vegasIntegrator.h"
 
 int CUBAIntegrand(const int *nDim, const double* psPoint, const int *nComp, double *value, void *inputs, const int *nVec, const int *core, const double *weight);
+// Same, with a leading component summing |f| over the nComp - 1 others, so that CUBA's Vegas refines its grid on all of them
+int CUBASummedIntegrand(const int *nDim, const double* psPoint, const int *nComp, double *value, void *inputs, const int *nVec, const int *core, const double *weight);
 
 class MEWeight{
   public:
 
-  double Integrand(const double* psPoint, const double *weight);
-  inline double ComputePdf(const int &pid, const double &x, const double &q2);
-  inline std::map< std::pair<int, int>, double > getMatrixElements(const std::vector< std::vector<double> > &initialMomenta, const std::vector< std::pair<int, std::vector<double> > > &finalState) const { return _process.sigmaKin(initialMomenta, finalState); }
+  enum IntegratorType { CUBA_VEGAS, QMC_SOBOL, QMC_LATTICE, NATIVE_VEGAS };
+  // Maximal number of phase-space points passed at once to the integrand by CUBA
+  static const int cubaBatchPoints = 64;
+
+  // Process-specific: final-state particles of the matrix element (in the order of the momenta of the batch),
+  // per-event stage of the integrand (see integrandStages.h), and the integrand itself, in two steps:
+  // the kinematics of a phase-space point for one event stage, whose solutions are added to the batch with the
+  // position index of their integrand value, then the matrix elements and PDFs of all the solutions of the batch,
+  // added to values. thread is the index of the integration thread, selecting the process and PDF instances.
+  static const std::vector<int>& GetFinalState();
+  // Q^2 of the PDFs in the integrand (the cached PDF tables must be computed at this scale)
+  static double GetPdfScale();
+  void PrepareEvent(const MEEvent &event, EventStage &stage) const;
+  void IntegrandKinematics(const double* psPoint, const EventStage &stage, const int index, MEBatch &batch, const int thread = 0);
+  void IntegrandMatrixElements(MEBatch &batch, double *values, const int thread = 0);
+  // Integrand of nPoints phase-space points (psPoints[point*nDim + i]) for all the components:
+  // values[point*nComp + component], with one call to the matrix element backend.
+  // With the PDF members, each event stage has one component per member: component = stage*nMembers + member.
+  void Integrand(const int nPoints, const int nDim, const double* psPoints, const int nComp, double *values, const int thread = 0);
+  inline double ComputePdf(const int &pid, const double &x, const double &q2, const int thread = 0, const int member = 0);
   double ComputeWeight(double &error);
+  // Integrate all permutations at once, as the components of a single vector-valued integral.
+  // If a pruning threshold has been set, permutations whose quick estimate is smaller than
+  // threshold*(largest estimate) are not integrated further: their quick estimate is returned instead.
+  // Returns false if the event has been rejected by the pre-screening (weights are then the quick estimates).
+  bool ComputeWeights(const MEPermutations &permutations, std::vector<double> &weights, std::vector<double> &errors);
   MEEvent* GetEvent();
+  inline const MEEvent& GetComponentEvent(const int i) const { return *_components[i]; }
+  inline const EventStage& GetComponentStage(const int i) const { return _stages[i]; }
+  inline void SetPermutationPruning(const double threshold) { _pruneThreshold = threshold; }
+  // Enable a quick first pass using nPoints Sobol points (0 => disabled).
+  // Events whose estimated weight is not larger than minWeight (in particular kinematically incompatible events, 
+  // with a vanishing estimate) are not integrated further. For the others, the estimate sets the precision target.
+  inline void SetPreScreening(const int nPoints, const double minWeight = 0.) { _preScreenPoints = nPoints; _preScreenMinWeight = minWeight; }
+  // Choose the integration engine (default CUBA Vegas). With compare = true, each integration is also done
+  // with the other engines on the same integrand, and their results, number of evaluations and CPU time are printed
+  // (the results of the chosen engine are used).
+  void SetIntegrator(const IntegratorType type, const bool compare = false);
+  // The matrix element and PDF evaluations are not thread-safe: each additional integration thread of the
+  // native Vegas integrator needs its own instance of the process (a PDF instance is created for it here).
+  // Must be called before SetIntegrator.
+  void AddThreadProcess(CPPProcess &process);
+  void AddThreadProcess(MatrixElement &matrixElement);
+  inline int GetNumberOfThreads() const { return _matrixElements.size(); }
+  // Stage counters of the integrand, summed over the threads, since the last reset
+  StageCounters GetStageCounters() const;
+  void ResetStageCounters();
+  // Reproducible mode (seed != 0): the random numbers of each integration are derived from the run seed, the event ID
+  // (see SetEventID), the integrated permutations and the integration pass (quick estimate or full integration), 
+  // so that the weight of an event doesn't depend on the other events processed in the job, nor on the number of threads.
+  // CUBA then uses the Mersenne Twister generator with the derived seed instead of the Sobol sequence.
+  inline void SetRunSeed(const uint64_t seed) { _runSeed = seed; }
+  inline void SetEventID(const long entry) { _eventID = entry; }
+  // Starting grid of the native Vegas integrator, and grid at the end of its last integration
+  bool LoadVegasGrid(const std::string &fileName);
+  bool SaveVegasGrid(const std::string &fileName) const;
   void SetEvent(const ROOT::Math::PtEtaPhiEVector &ep, const ROOT::Math::PtEtaPhiEVector &mum, const ROOT::Math::PtEtaPhiEVector &b, const ROOT::Math::PtEtaPhiEVector &bbar, const ROOT::Math::PtEtaPhiEVector &met);
-  void AddTF(const std::string particleName, const std::string histName);
+  // Transfer function of a type of particle: name is a histogram of the TF file, or a parameter file (see TransferFunction::DefineComponent)
+  void AddTF(const std::string particleName, const std::string name, const TFComponent::Type type = TFComponent::BINNED);
   void AddInitialState(int pid1, int pid2);
+  // Weights for all the members of the PDF set (e.g. for the PDF uncertainties) in the same integration: the matrix
+  // elements are evaluated once per point, and each member is integrated as a separate component. The pruning and
+  // pre-screening use the central member. Not available with the PDF tables of a table cache.
+  void SetPdfMembers(const bool allMembers);
+  inline int GetNumberOfPdfMembers() const { return _pdfMembers.size() ? _pdfMembers[0].size() : 1; }
+  // Weights and errors of all the PDF members in the last ComputeWeight(s): [component*nMembers + member], member 0 being the central one
+  inline const std::vector<double>& GetMemberWeights() const { return _memberWeights; }
+  inline const std::vector<double>& GetMemberErrors() const { return _memberErrors; }
+  // Importance sampling of the energies of the visible particles from their TF (default), instead of a uniform sampling
+  // over the TF range (see VisibleParticle::Set)
+  inline void SetTFSampling(const bool sampling) { _tfSampling = sampling; }
 
+  // fileTF is either a ROOT file with the TF histograms, or a table cache written by tools/compile_cache.
+  // If the cache also contains the tables of the PDF pdfName (at the fixed scale of the integrand), LHAPDF is not used.
+  // The MadGraph standalone process is evaluated through CPPProcessME, other MatrixElement backends are passed directly.
   MEWeight(CPPProcess &process, const std::string pdfName, const std::string fileTF);
+  MEWeight(MatrixElement &matrixElement, const std::string pdfName, const std::string fileTF);
   ~MEWeight();
 
   private:
 
+  // Set the events integrated as components, and prepare their per-event stage
+  // indices are the permutation numbers of the components (used to derive the seeds)
+  void SetComponents(const std::vector<const MEEvent*> &components, const std::vector<size_t> &indices);
+  // Seed of the next integration in reproducible mode (pass = 0 for the quick estimate, 1 for the full integration), 0 otherwise
+  uint64_t GetIntegrationSeed(const int pass) const;
+  // Quick estimate, pruning and full integration of the events currently in _components
+  bool IntegrateComponents(std::vector<double> &weights, std::vector<double> &errors);
+  // Run the integration over the events currently in _components, returns the number of evaluations
+  int Integrate(const int maxEval, const int nStart, const char verbosity, const double relAccuracy, const double absAccuracy, const uint64_t seed, double *mcResult, double *error, double *prob);
+  int RunIntegrator(const IntegratorType type, const int maxEval, const int nStart, const char verbosity, const double relAccuracy, const double absAccuracy, const uint64_t seed, double *mcResult, double *error, double *prob);
+
   std::vector< std::pair<int, int> > _initialStates;
-  CPPProcess &_process;
-  LHAPDF::PDF* _pdf;
+  std::string _pdfName;
+  // One matrix element backend, PDF instance and batch per integration thread
+  std::vector<MatrixElement*> _matrixElements;
+  std::vector<LHAPDF::PDF*> _pdfs;
+  // With SetPdfMembers: all the members of the PDF set, for each thread
+  std::vector< std::vector<LHAPDF::PDF*> > _pdfMembers;
+  std::vector<double> _memberWeights, _memberErrors;
+  std::vector<MEBatch> _batches;
+  std::vector<StageCounters> _counters;
+  // Backends created for the CPPProcess instances
+  std::vector<MatrixElement*> _ownedMatrixElements;
   MEEvent* _recEvent;
   TransferFunction* _TF;
+  bool _tfSampling;
+  // If the TF file is a table cache: the mapped cache, and the PDF tables it contains (if any), used instead of LHAPDF
+  TableCache* _cache;
+  PdfTable* _pdfTable;
+  // Events (e.g. permutations) integrated as the components of the integral
+  std::vector<const MEEvent*> _components;
+  std::vector<EventStage> _stages;
+  std::vector<size_t> _componentIndices;
+  double _pruneThreshold;
+  int _preScreenPoints;
+  double _preScreenMinWeight;
+  uint64_t _runSeed;
+  long _eventID;
+  IntegratorType _integrator;
+  bool _compareIntegrators;
+  QMCIntegrator* _sobolIntegrator;
+  QMCIntegrator* _latticeIntegrator;
+  VegasIntegrator* _vegasIntegrator;
 };
 
-inline double MEWeight::ComputePdf(const int &pid, const double &x, const double &q2){
+inline double MEWeight::ComputePdf(const int &pid, const double &x, const double &q2, const int thread, const int member){
   // return f(pid,x,q2)
   if(x <= 0 || x >= 1 || q2 <= 0){
     std::cout << "WARNING: PDF x or Q^2 value out of bounds!" << std::endl;
     return 0.;
+  }else if(_pdfTable){
+    // Computed at GetPdfScale(), checked when loading the tables
+    return _pdfTable->xfx(pid, x)/x;
+  }else if(_pdfMembers.size()){
+    return _pdfMembers[thread][member]->xfxQ2(pid, x, q2)/x;
   }else{
-    return _pdf->xfxQ2(pid, x, q2)/x;
+    return _pdfs[thread]->xfxQ2(pid, x, q2)/x;
   }
 }
 
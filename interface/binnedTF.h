@@ -2,28 +2,46 @@
 #define _INC_BINNEDTF
 
 #include <string>
+#include <vector>
 #include <algorithm>
 
 #include "TH2.h"
 #include "TFile.h"
 
-class BinnedTF{
+#include "tfComponent.h"
+#include "tableCache.h"
+
+// Piecewise constant TF, from a 2D histogram of delta = Erec - Egen (y) vs Egen (x) with fixed-width bins.
+// The bin contents are either copied from the histogram of a ROOT file, or used in place from a table cache.
+class BinnedTF: public TFComponent{
   public:
 
   BinnedTF(const std::string particleName, const std::string histName, TFile* file);
-  ~BinnedTF();
-  inline double Evaluate(const double &Erec, const double &Egen) const;
-  inline double GetDeltaRange(const double &Erec) const;
-  inline double GetDeltaMin(const double &Erec) const;
-  inline double GetDeltaMax(const double &Erec) const;
+  // The values of the table are not copied: the cache must outlive the TF
+  BinnedTF(const std::string particleName, const TableView &table);
+  inline double Evaluate(const double &Erec, const double &Egen) const override;
+  inline double GetDeltaMin(const double &Erec) const override;
+  inline double GetDeltaMax(const double &Erec) const override;
+  // Cumulative distribution of the Egen slice containing Erec (computed when loading the TF)
+  void FillSampler(const double &Erec, DeltaSampler &sampler) const override;
+
+  // Copy the contents of a histogram of the TF file into values, and describe them in table (also used by SplineTF and tools/compile_cache).
+  // Returns false if the histogram can't be found.
+  static bool ReadHistogram(TFile* file, const std::string &histName, std::vector<double> &values, TableView &table);
 
   private:
 
+  void SetTable(const TableView &table);
+
   std::string _particleName;
-  double _histDeltaMin, _histDeltaMax;
   double _deltaMin, _deltaMax, _deltaRange;
   double _EgenMax, _EgenMin;
-  const TH2D* _TF;
+  int _nEgen, _nDelta;
+  // _values[iEgen*_nDelta + iDelta], pointing to _ownValues or to a table cache
+  const double *_values;
+  std::vector<double> _ownValues;
+  // Cumulative distributions in delta of each Egen slice
+  std::vector<double> _cdfs;
 };
 
 inline double BinnedTF::Evaluate(const double &Erec, const double &Egen) const {
@@ -36,15 +54,11 @@ inline double BinnedTF::Evaluate(const double &Erec, const double &Egen) const {
     return 0.;
   }
 
-  // Use ROOT's global bin number "feature" for 2-dimensional histograms
-  const int bin = _TF->FindFixBin(Egen, delta);
-
-  //std::cout << ", TF = " << _TF->GetBinContent(bin) << std::endl;
-  return _TF->GetBinContent(bin);
-}
+  // Same bin numbers as TAxis::FindFixBin, the upper edges belonging to the last bins
+  const int iEgen = std::min(static_cast<int>(_nEgen*(Egen - _EgenMin)/(_EgenMax - _EgenMin)), _nEgen - 1);
+  const int iDelta = std::min(static_cast<int>(_nDelta*(delta - _deltaMin)/_deltaRange), _nDelta - 1);
 
-inline double BinnedTF::GetDeltaRange(const double &Erec) const {
-  return GetDeltaMax(Erec) - GetDeltaMin(Erec);
+  return _values[iEgen*_nDelta + iDelta];
 }
 
 inline double BinnedTF::GetDeltaMin(const double &Erec) const {
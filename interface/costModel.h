@@ -0,0 +1,52 @@
+#ifndef _INC_COSTMODEL
+#define _INC_COSTMODEL
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "MEPermutations.h"
+
+// Predicts the integration time of an event from cheap kinematic features of its selected objects (number of
+// permutations, lepton and jet energies, MET, ISR, visible mass), with a linear model of log(time) fitted by
+// (ridge-regularised) least squares on the times recorded in past runs.
+// Used to schedule the most expensive events first, and to split jobs with equal predicted durations.
+class CostModel{
+  public:
+
+  static const int nFeatures = 7;
+
+  CostModel();
+
+  // Features of a selected event (all its permutations are integrated at once)
+  static std::vector<double> GetFeatures(const MEPermutations &permutations);
+
+  // Training: one sample per event with a recorded time (s)
+  void AddSample(const std::vector<double> &features, const double time);
+  inline size_t GetNumberOfSamples() const { return _samples.size(); }
+  // Returns false if there are not enough samples
+  bool Fit(const double ridge = 1e-6);
+  // Predicted time (s)
+  double Predict(const std::vector<double> &features) const;
+  // Spread of log(time) around the prediction in the training sample
+  inline double GetResolution() const { return _resolution; }
+
+  bool Save(const std::string &fileName) const;
+  bool Load(const std::string &fileName);
+
+  private:
+
+  std::vector< std::vector<double> > _samples;
+  std::vector<double> _logTimes;
+  std::vector<double> _coefficients;
+  double _resolution;
+};
+
+// Recorded times of past runs, per entry: either the output of ME_ttbar (ROOT file with the Entry and
+// Weight_TT_cpp_me branches), or the result file of the work queue (lines "entry weight error time status",
+// failed events are skipped)
+bool ReadRecordedTimes(const std::string &fileName, std::map<long, double> &times);
+// Predicted costs, one line "entry cost" per event
+bool ReadPredictedCosts(const std::string &fileName, std::map<long, double> &costs);
+
+#endif
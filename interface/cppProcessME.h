@@ -0,0 +1,31 @@
+#ifndef _INC_CPPPROCESSME
+#define _INC_CPPPROCESSME
+
+#include <vector>
+#include <utility>
+
+#include "src/process_base_classes.h"
+
+#include "matrixElement.h"
+
+// Backend for the MadGraph standalone C++ output (CPPProcess::sigmaKin), evaluating one point at a time.
+// The initial states are those returned by sigmaKin.
+class CPPProcessME: public MatrixElement{
+  public:
+
+  // finalPIDs are the final-state particles, in the order of the momenta passed to Evaluate
+  CPPProcessME(CPPProcess &process, const std::vector<int> &finalPIDs);
+
+  virtual void Evaluate(const int nPoints, const double *momenta, double *values) override;
+  virtual const std::vector< std::pair<int, int> >& GetInitialStates() const override { return _initialStates; }
+
+  private:
+
+  CPPProcess &_process;
+  std::vector< std::pair<int, int> > _initialStates;
+  // Inputs of sigmaKin, reused between points
+  std::vector< std::vector<double> > _initialMomenta;
+  std::vector< std::pair<int, std::vector<double> > > _finalState;
+};
+
+#endif
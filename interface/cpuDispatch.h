@@ -0,0 +1,40 @@
+#ifndef _INC_CPUDISPATCH
+#define _INC_CPUDISPATCH
+
+#include <string>
+#include <vector>
+
+#include "fourVector.h"
+
+// Runtime selection of the instruction set used by the hot kernels of the integrand (see isaTarget.h):
+// the farm is heterogeneous, so the kernels are compiled for several levels, and the best one supported
+// by the CPU is chosen at startup. Results can differ in the last bits between the levels (FMA contractions),
+// so reproducible comparisons between machines need the same level, which can be forced.
+enum ISALevel { ISA_GENERIC = 0, ISA_SSE4 = 1, ISA_AVX2 = 2, ISA_AVX512 = 3, N_ISA_LEVELS };
+
+// Entry points of the kernels of one level
+struct ISAKernels{
+  int (*computeTransformD)(const double &s13, const double &s134, const double &s25, const double &s256,
+                           const FourVector &p3, const FourVector &p4, const FourVector &p5, const FourVector &p6, const FourVector &Met, const FourVector &ISR,
+                           std::vector<FourVector> &p1, std::vector<FourVector> &p2,
+                           int &nRejectedRoots);
+  double (*computeJacobianD)(const FourVector *p, const double &sqrt_s);
+};
+
+// Called during the static initialisation by each compiled variant
+bool RegisterISAKernels(const ISALevel level, const ISAKernels &kernels);
+
+// Highest level supported by the CPU and the OS
+ISALevel DetectISALevel();
+const char* GetISAName(const ISALevel level);
+// "generic", "sse4", "avx2" or "avx512", returns false for other names
+bool ParseISALevel(const std::string &name, ISALevel &level);
+
+// Use the kernels of the given level (exits if it isn't compiled or not supported by the CPU). By default, the highest
+// level both compiled and supported is used. Must be called before the integration threads are started.
+void SelectISALevel(const ISALevel level);
+ISALevel GetISALevel();
+// Kernels of the selected level
+const ISAKernels& GetISAKernels();
+
+#endif
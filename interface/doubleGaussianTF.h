@@ -0,0 +1,60 @@
+#ifndef _INC_DOUBLEGAUSSIANTF
+#define _INC_DOUBLEGAUSSIANTF
+
+#include <string>
+#include <algorithm>
+#define _USE_MATH_DEFINES // include M_PI constant
+#include <cmath>
+
+#include "tfComponent.h"
+
+// Parametric TF: sum of two Gaussians in delta = Erec - Egen, normalised to 1 for each Egen:
+//   TF = [ exp(-(delta-mean1)^2/(2 sigma1^2)) + amplitude * exp(-(delta-mean2)^2/(2 sigma2^2)) ] / ( sqrt(2pi) (sigma1 + amplitude*sigma2) )
+// Each parameter depends on Egen as p = a + b*sqrt(Egen) + c*Egen, as in MadWeight.
+//
+// The parameters are read from a text file, with one line "name a b c" for each of
+// mean1, sigma1, mean2, sigma2 and amplitude (lines starting with # are ignored).
+// An optional line "nsigma n" (default 5) sets the integration range: the Gaussians evaluated at Egen = Erec,
+// up to n widths from their means.
+class DoubleGaussianTF: public TFComponent{
+  public:
+
+  DoubleGaussianTF(const std::string particleName, const std::string paramFile);
+
+  inline double Evaluate(const double &Erec, const double &Egen) const override;
+  double GetDeltaMin(const double &Erec) const override;
+  double GetDeltaMax(const double &Erec) const override;
+
+  private:
+
+  enum Parameter { MEAN1, SIGMA1, MEAN2, SIGMA2, AMPLITUDE, N_PARAMETERS };
+
+  inline double GetParameter(const int parameter, const double &sqrtEgen, const double &Egen) const {
+    return _a[parameter] + _b[parameter]*sqrtEgen + _c[parameter]*Egen;
+  }
+
+  std::string _particleName;
+  double _a[N_PARAMETERS], _b[N_PARAMETERS], _c[N_PARAMETERS];
+  double _nSigma;
+};
+
+inline double DoubleGaussianTF::Evaluate(const double &Erec, const double &Egen) const {
+  if(Egen <= 0.)
+    return 0.;
+
+  const double sqrtEgen = std::sqrt(Egen);
+  const double delta = Erec - Egen;
+
+  const double sigma1 = std::fabs(GetParameter(SIGMA1, sqrtEgen, Egen));
+  const double sigma2 = std::fabs(GetParameter(SIGMA2, sqrtEgen, Egen));
+  const double amplitude = GetParameter(AMPLITUDE, sqrtEgen, Egen);
+  const double x1 = (delta - GetParameter(MEAN1, sqrtEgen, Egen))/sigma1;
+  const double x2 = (delta - GetParameter(MEAN2, sqrtEgen, Egen))/sigma2;
+
+  const double value = ( std::exp(-0.5*x1*x1) + amplitude*std::exp(-0.5*x2*x2) ) / ( std::sqrt(2.*M_PI)*(sigma1 + amplitude*sigma2) );
+
+  // Parameters out of their domain of validity (vanishing widths, negative amplitude) give NaNs or negative values
+  return value > 0. ? value : 0.;
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef _INC_EVENTPIPELINE
+#define _INC_EVENTPIPELINE
+
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+
+// Lock-free ring buffer of slot indices, for one producer thread and one consumer thread
+class SlotRing{
+  public:
+
+  // Holds at least capacity indices
+  SlotRing(const size_t capacity);
+
+  // Return false if the ring is full / empty
+  bool TryPush(const size_t slot);
+  bool TryPop(size_t &slot);
+  // Wait until the index can be pushed / popped. The waiting thread spins shortly, then sleeps for increasing
+  // durations (up to 1 ms), so that it doesn't take CPU time from the other threads during long computations.
+  void Push(const size_t slot);
+  size_t Pop();
+
+  private:
+
+  std::vector<size_t> _slots;
+  size_t _mask;
+  // Next index to pop (only written by the consumer) and to push (only written by the producer),
+  // on separate cache lines
+  alignas(64) std::atomic<size_t> _head;
+  alignas(64) std::atomic<size_t> _tail;
+};
+
+// Three-stage event pipeline over a pool of nSlots preallocated events, owned by the caller and identified by their index:
+//  - a reader thread fills the free slots with the next events: read(slot) returns false when there are no more events
+//  - the calling thread computes the events, compute(slot), in the order they were read
+//  - a writer thread stores the results, write(slot), in the same order, after which the slot is reused
+// The slots are passed from one stage to the next through SlotRings, so that reading up to nSlots-1 events in advance
+// and writing the results overlap with the computation. The functions of each stage are only called from one thread,
+// but must not share unprotected state with the other stages.
+class EventPipeline{
+  public:
+
+  EventPipeline(const size_t nSlots);
+
+  // Returns the number of events processed
+  size_t Run(const std::function<bool(size_t)> &read, const std::function<void(size_t)> &compute, const std::function<void(size_t)> &write);
+
+  private:
+
+  size_t _nSlots;
+};
+
+#endif
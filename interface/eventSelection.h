@@ -0,0 +1,55 @@
+#ifndef _INC_EVENTSELECTION
+#define _INC_EVENTSELECTION
+
+#include <vector>
+
+#include "Math/Vector4D.h"
+
+#include "MEPermutations.h"
+
+// Cuts applied on the reconstructed objects
+struct SelectionCuts{
+  double leptonPtMin = 10.;
+  double leptonEtaMax = 2.5;
+  double jetPtMin = 20.;
+  double jetEtaMax = 2.5;
+  // If true, only b-tagged jets are candidates for the b and anti-b quarks
+  bool requireBTag = true;
+  // Bits of the (Delphes) b-tagging word defining a b-tagged jet
+  unsigned int bTagMask = 1;
+  // Only the leading maxJets selected jets are kept (0 => no limit)
+  unsigned int maxJets = 4;
+};
+
+// Selects the reconstructed objects for the e+ mu- b bbar channel, 
+// and builds the candidate assignments (permutations) to be integrated.
+// The objects can be added in any order, they are sorted by decreasing Pt.
+class EventSelection{
+  public:
+
+  EventSelection(const SelectionCuts &cuts = SelectionCuts());
+
+  void Clear();
+  void AddElectron(const ROOT::Math::PtEtaPhiEVector &p4, const int charge);
+  void AddMuon(const ROOT::Math::PtEtaPhiEVector &p4, const int charge);
+  void AddJet(const ROOT::Math::PtEtaPhiEVector &p4, const bool bTagged);
+  inline void SetMet(const ROOT::Math::PtEtaPhiEVector &met) { _met = met; _hasMet = true; }
+  
+  inline bool IsBTagged(const unsigned int bTagWord) const { return bTagWord & _cuts.bTagMask; }
+  inline const SelectionCuts& GetCuts() const { return _cuts; }
+
+  // Returns false if the event does not contain a positive electron, a negative muon, 
+  // two candidate jets and MET. Otherwise, the leading leptons and jets are used to build the permutations.
+  bool BuildPermutations(MEPermutations &permutations) const;
+
+  private:
+
+  bool PassLeptonCuts(const ROOT::Math::PtEtaPhiEVector &p4) const;
+  
+  SelectionCuts _cuts;
+  std::vector<ROOT::Math::PtEtaPhiEVector> _positrons, _muons, _jets;
+  ROOT::Math::PtEtaPhiEVector _met;
+  bool _hasMet;
+};
+
+#endif
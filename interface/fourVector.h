@@ -0,0 +1,105 @@
+#ifndef _INC_FOURVECTOR
+#define _INC_FOURVECTOR
+
+#include <cmath>
+
+#include "Math/Vector4D.h"
+
+// Minimal (Px,Py,Pz,E) 4-vector used in the integrand.
+// Plain trivially-copyable struct: the accessors never hide trigonometric functions or square roots,
+// quantities such as |P|, Pt or the mass have to be computed explicitly (see FourVectorCache).
+// ROOT::Math vectors are only used at the I/O boundary (see ToFourVector).
+struct FourVector{
+  double px, py, pz, e;
+
+  inline FourVector operator+(const FourVector &v) const { return { px + v.px, py + v.py, pz + v.pz, e + v.e }; }
+  inline FourVector operator-(const FourVector &v) const { return { px - v.px, py - v.py, pz - v.pz, e - v.e }; }
+  inline FourVector operator-() const { return { -px, -py, -pz, -e }; }
+  inline FourVector& operator+=(const FourVector &v) { px += v.px; py += v.py; pz += v.pz; e += v.e; return *this; }
+  inline bool operator==(const FourVector &v) const { return px == v.px && py == v.py && pz == v.pz && e == v.e; }
+
+  inline double Dot(const FourVector &v) const { return e*v.e - px*v.px - py*v.py - pz*v.pz; }
+  inline double M2() const { return e*e - px*px - py*py - pz*pz; }
+  inline double P2() const { return px*px + py*py + pz*pz; }
+  inline double Pt2() const { return px*px + py*py; }
+};
+
+// Quantities derived from a FourVector, computed explicitly once (e.g. per event) instead of at every use
+struct FourVectorCache{
+  double p, pt, m, eta, phi;
+  // Unit vector along the momentum
+  double ux, uy, uz;
+
+  inline void Compute(const FourVector &v){
+    p = sqrt(v.P2());
+    pt = sqrt(v.Pt2());
+    const double m2 = v.M2();
+    m = m2 > 0 ? sqrt(m2) : 0.;
+    eta = pt > 0 ? asinh(v.pz/pt) : 0.;
+    phi = atan2(v.py, v.px);
+    ux = p > 0 ? v.px/p : 0.;
+    uy = p > 0 ? v.py/p : 0.;
+    uz = p > 0 ? v.pz/p : 0.;
+  }
+
+  // Build the vector with the same direction and mass, and energy E. Returns false if E < m.
+  inline bool WithEnergy(const double E, FourVector &v) const {
+    const double rad = E*E - m*m;
+    if(rad < 0)
+      return false;
+    const double newP = sqrt(rad);
+    v = { newP*ux, newP*uy, newP*uz, E };
+    return true;
+  }
+};
+
+// General boost of v by velocity (bx,by,bz), as ROOT::Math::Boost
+inline FourVector boost(const FourVector &v, const double bx, const double by, const double bz){
+  const double b2 = bx*bx + by*by + bz*bz;
+  const double gamma = 1./sqrt(1. - b2);
+  const double bp = bx*v.px + by*v.py + bz*v.pz;
+  const double gamma2 = b2 > 0 ? (gamma - 1.)/b2 : 0.;
+  const double factor = gamma2*bp + gamma*v.e;
+  return { v.px + factor*bx, v.py + factor*by, v.pz + factor*bz, gamma*(v.e + bp) };
+}
+
+// ISR correction in closed form: the total momentum tot is boosted to its transverse rest frame 
+// (velocity beta = (Px/E, Py/E, 0)), where the longitudinal parton momenta are defined from the total E' and Pz:
+//   E' = sqrt(E^2 - Pt^2), Pz' = Pz, q1Pz = (Pz + E')/2, q2Pz = (Pz - E')/2
+// The partons are then boosted back. Since beta is transverse and the partons are along z, this gives:
+//   parton = (|q| Px/E', |q| Py/E', q, |q| E/E')
+// Returns false if tot is not time-like.
+inline bool transverseBoostPartons(const FourVector &tot, double &q1Pz, double &q2Pz, FourVector &parton1, FourVector &parton2){
+  const double ET2 = tot.e*tot.e - tot.Pt2();
+  if(ET2 <= 0)
+    return false;
+  
+  const double ET = sqrt(ET2);
+  q1Pz = 0.5*(tot.pz + ET);
+  q2Pz = 0.5*(tot.pz - ET);
+  
+  const double bx = tot.px/ET;
+  const double by = tot.py/ET;
+  const double gamma = tot.e/ET;
+  const double q1 = fabs(q1Pz);
+  const double q2 = fabs(q2Pz);
+  
+  parton1 = { q1*bx, q1*by, q1Pz, q1*gamma };
+  parton2 = { q2*bx, q2*by, q2Pz, q2*gamma };
+  
+  return true;
+}
+
+inline FourVector ToFourVector(const ROOT::Math::PxPyPzEVector &v){
+  return { v.Px(), v.Py(), v.Pz(), v.E() };
+}
+
+inline FourVector ToFourVector(const ROOT::Math::PtEtaPhiEVector &v){
+  return { v.Px(), v.Py(), v.Pz(), v.E() };
+}
+
+inline ROOT::Math::PxPyPzEVector ToPxPyPzEVector(const FourVector &v){
+  return ROOT::Math::PxPyPzEVector(v.px, v.py, v.pz, v.e);
+}
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef _INC_INTEGRANDSTAGES
+#define _INC_INTEGRANDSTAGES
+
+#include <vector>
+#include <algorithm>
+#define _USE_MATH_DEFINES // include M_PI constant
+#include <cmath>
+#include <chrono>
+
+#include "fourVector.h"
+#include "tfComponent.h"
+
+// The integrand is split in stages, according to what the quantities depend on:
+//  - per event: everything fixed by the reconstructed objects (directions, masses, TF components and ranges),
+//    computed once before the integration and stored in an EventStage
+//  - per phase-space point: the generated visible particles, their TF weight and phase-space density
+//    (EventStage::GenerateVisibles), and e.g. the Breit-Wigner flattening
+//  - per solution: the invisible particles, partons and jacobian
+//  - per batch of solutions (of several points and components): the matrix elements and PDFs (see MEBatch)
+// Each quantity should be computed at the outermost stage where it is invariant.
+// A process defines MEWeight::PrepareEvent (filling the EventStage) next to its MEWeight::IntegrandKinematics
+// and MEWeight::IntegrandMatrixElements.
+
+// Visible particle whose energy is smeared by a transfer function.
+// The generated vector has the same direction and mass as the reconstructed one, only the energy changes.
+class VisibleParticle{
+  public:
+
+  // Per event. If tf is null, the particle is not smeared (generated = reconstructed).
+  // With importanceSampling, delta = Erec - Egen is sampled from the approximate TF density of TFComponent::FillSampler,
+  // otherwise uniformly over the range.
+  void Set(const FourVector &rec, const TFComponent* tf, const bool importanceSampling = false);
+
+  // Per phase-space point: build the generated vector p from the integration variable u in [0,1],
+  // and return the TF weight (TF / (sampling density of delta) * dE/dP) times the phase-space density dPhi = |P|^2 sin(theta)/(2*E*(2pi)^3).
+  // Returns 0 if the generated energy is not physical.
+  inline double Generate(const double u, FourVector &p) const;
+
+  inline const FourVectorCache& GetKinematics() const { return _kin; }
+  inline double GetMass() const { return _kin.m; }
+  inline double GetErec() const { return _Erec; }
+  inline bool IsSmeared() const { return _deltaRange != 0.; }
+
+  private:
+
+  FourVectorCache _kin;
+  double _Erec;
+  const TFComponent* _TF;
+  double _deltaMax, _deltaRange;
+  bool _importanceSampling;
+  DeltaSampler _sampler;
+  // sin(theta)/(2*(2pi)^3): only the energy-dependent part of dPhi is left for the per-point stage
+  double _dPhiFactor;
+};
+
+inline double VisibleParticle::Generate(const double u, FourVector &p) const {
+  double Egen, inverseDensity;
+  if(_importanceSampling){
+    double delta;
+    inverseDensity = 1./_sampler.Sample(u, delta);
+    Egen = _Erec - delta;
+  }else{
+    Egen = _Erec - _deltaMax + _deltaRange * u;
+    inverseDensity = _deltaRange;
+  }
+
+  const double P2 = Egen*Egen - _kin.m*_kin.m;
+  if(P2 < 0)
+    return 0.;
+  const double P = sqrt(P2);
+  p = { P*_kin.ux, P*_kin.uy, P*_kin.uz, Egen };
+
+  if(_deltaRange != 0.){
+    // TF / density * dE/dP * dPhi, where dE/dP * dPhi = |P| sin(theta)/(2*(2pi)^3)
+    return _TF->Evaluate(_Erec, Egen) * inverseDensity * P * _dPhiFactor;
+  }else{
+    return P2 * _dPhiFactor / Egen;
+  }
+}
+
+class EventStage{
+  public:
+
+  inline void Clear() { _visibles.clear(); }
+  inline void AddVisible(const FourVector &rec, const TFComponent* tf, const bool importanceSampling = false) { _visibles.emplace_back(); _visibles.back().Set(rec, tf, importanceSampling); }
+  inline void SetInvisibles(const FourVector &Met, const FourVector &ISR) { _Met = Met; _ISR = ISR; }
+
+  inline size_t GetNumberOfVisibles() const { return _visibles.size(); }
+  inline const VisibleParticle& GetVisible(const size_t i) const { return _visibles[i]; }
+  inline const FourVector& GetMet() const { return _Met; }
+  inline const FourVector& GetISR() const { return _ISR; }
+
+  // Per phase-space point: generate all visible particles, in the order they were added, using the integration variables u[0..n-1].
+  // Returns the product of their weights (see VisibleParticle::Generate), 0 as soon as one is not physical.
+  inline double GenerateVisibles(const double *u, FourVector *p) const;
+
+  private:
+
+  std::vector<VisibleParticle> _visibles;
+  FourVector _Met, _ISR;
+};
+
+inline double EventStage::GenerateVisibles(const double *u, FourVector *p) const {
+  double weight = 1.;
+  for(size_t i = 0; i < _visibles.size(); ++i){
+    weight *= _visibles[i].Generate(u[i], p[i]);
+    if(weight == 0.)
+      return 0.;
+  }
+  return weight;
+}
+
+// Number of phase-space points reaching or rejected at each stage of the integrand,
+// e.g. to check that an optimisation does not change which points contribute.
+// Also holds the estimated time spent in each stage, measured on one point out of timingPeriod (see StageClock).
+class StageCounters{
+  public:
+
+  enum Counter {
+    POINTS,               // integrand evaluations (one per point and component)
+    REJECTED_VISIBLES,    // generated energies not physical, or vanishing TF
+    REJECTED_INVARIANTS,  // inconsistent Breit-Wigner invariants
+    NO_SOLUTION,          // no solution for the neutrinos
+    SOLUTIONS,            // neutrino solutions
+    REJECTED_PARTONS,     // solutions with unphysical initial partons
+    REJECTED_JACOBIAN,    // solutions with a vanishing or negative jacobian
+    MATRIX_ELEMENTS,      // matrix element evaluations
+    REJECTED_ROOTS,       // spurious roots dropped by the neutrino solver
+    N_COUNTERS
+  };
+
+  enum Stage {
+    VISIBLES_STAGE,       // generated visible particles and TF
+    NEUTRINOS_STAGE,      // Breit-Wigner flattening and neutrino solutions
+    KINEMATICS_STAGE,     // partons (ISR correction) and jacobian
+    MATRIX_ELEMENT_STAGE, // matrix elements (per batch of solutions)
+    PDF_STAGE,            // PDFs and sum over the initial states (per batch of solutions)
+    N_STAGES
+  };
+
+  static const unsigned int timingPeriod = 64;
+
+  StageCounters() { Reset(); }
+
+  inline void Reset() { std::fill(_counts, _counts + N_COUNTERS, 0ULL); std::fill(_times, _times + N_STAGES, 0.); }
+  inline void Increment(const Counter counter, const unsigned long long n = 1) { _counts[counter] += n; }
+  inline unsigned long long Get(const int counter) const { return _counts[counter]; }
+  inline void Set(const int counter, const unsigned long long value) { _counts[counter] = value; }
+  inline void AddTime(const Stage stage, const double seconds) { _times[stage] += seconds; }
+  // Estimated total time spent in the stage (s)
+  inline double GetTime(const int stage) const { return _times[stage]; }
+  StageCounters& operator+=(const StageCounters &other);
+
+  // Name used in printouts and files, e.g. "rejected_visibles"
+  static const char* GetName(const int counter);
+  // e.g. "neutrinos"
+  static const char* GetStageName(const int stage);
+
+  private:
+
+  unsigned long long _counts[N_COUNTERS];
+  double _times[N_STAGES];
+};
+
+// Measures the time between successive laps of the integrand, if enabled (one point out of period),
+// and adds it, scaled by the period, to the stage which has just finished. Disabled, it costs a branch per lap.
+// The batched stages, evaluated once per batch of points, are timed with period = 1.
+class StageClock{
+  public:
+
+  StageClock(StageCounters &counters, const unsigned int period = StageCounters::timingPeriod):
+    _counters(counters),
+    _period(period),
+    _enabled(counters.Get(StageCounters::POINTS) % period == 0) {
+    if(_enabled)
+      _last = std::chrono::steady_clock::now();
+  }
+
+  inline void Lap(const StageCounters::Stage stage){
+    if(!_enabled)
+      return;
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    _counters.AddTime(stage, _period*std::chrono::duration<double>(now - _last).count());
+    _last = now;
+  }
+
+  private:
+
+  StageCounters &_counters;
+  unsigned int _period;
+  bool _enabled;
+  std::chrono::steady_clock::time_point _last;
+};
+
+#endif
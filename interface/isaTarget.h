@@ -0,0 +1,45 @@
+#ifndef _INC_ISATARGET
+#define _INC_ISATARGET
+
+// The hot kernels (neutrino solutions and jacobian: utils.cpp, jacobianD.cpp) are compiled once for each ISA level
+// (isa_* variables of the makefile), with ISA_VARIANT set to the level (see ISALevel in cpuDispatch.h).
+// Each variant has its functions in its own namespace, compiled for its instruction set by a target pragma.
+// The pragma is placed after the includes, so that the inline functions of the headers (std::vector, ...), which
+// the linker merges between the variants, are never compiled for a higher level than the CPU running them.
+// The default build (ISA_VARIANT undefined or 0) is the generic variant, in the global namespace.
+
+#if !defined(ISA_VARIANT) || ISA_VARIANT == 0
+
+#define ISA_LEVEL ISA_GENERIC
+#define ISA_NAMESPACE
+#define ISA_NAMESPACE_BEGIN
+#define ISA_NAMESPACE_END
+#define ISA_TARGET_BEGIN
+#define ISA_TARGET_END
+
+#else
+
+#if ISA_VARIANT == 1
+#define ISA_LEVEL ISA_SSE4
+#define ISA_NAMESPACE isa_sse4
+#define ISA_TARGET_PRAGMA _Pragma("GCC target(\"sse4.2,popcnt\")")
+#elif ISA_VARIANT == 2
+#define ISA_LEVEL ISA_AVX2
+#define ISA_NAMESPACE isa_avx2
+#define ISA_TARGET_PRAGMA _Pragma("GCC target(\"avx2,fma\")")
+#elif ISA_VARIANT == 3
+#define ISA_LEVEL ISA_AVX512
+#define ISA_NAMESPACE isa_avx512
+#define ISA_TARGET_PRAGMA _Pragma("GCC target(\"avx512f,avx512dq,avx512vl,avx512bw,avx2,fma\")")
+#else
+#error "Unknown ISA_VARIANT"
+#endif
+
+#define ISA_NAMESPACE_BEGIN namespace ISA_NAMESPACE {
+#define ISA_NAMESPACE_END }
+#define ISA_TARGET_BEGIN _Pragma("GCC push_options") ISA_TARGET_PRAGMA ISA_NAMESPACE_BEGIN
+#define ISA_TARGET_END ISA_NAMESPACE_END _Pragma("GCC pop_options")
+
+#endif
+
+#endif
@@ -2,14 +2,26 @@
 #define _INC_JACOBIAND
 
 #include <vector>
-#include "Math/Vector4D.h"
+#include "fourVector.h"
+#include "isaTarget.h"
 
 #define INV_JAC_MIN 1e3 // Just as in MW
 
+// Compiled for each ISA level (see isaTarget.h), called through the dispatcher (GetISAKernels in cpuDispatch.h)
+ISA_NAMESPACE_BEGIN
+
+// Finds the neutrino momenta p1,p2 for the given invariants. The (E1,E2) intersections are polished
+// and checked (see solve2QuadsPolished): nRejectedRoots is the number of spurious roots dropped.
+// Returns the number of solutions.
 int ComputeTransformD(const double &s13, const double &s134, const double &s25, const double &s256,
-                      const ROOT::Math::PxPyPzEVector &p3, const ROOT::Math::PxPyPzEVector &p4, const ROOT::Math::PxPyPzEVector &p5, const ROOT::Math::PxPyPzEVector &p6, const ROOT::Math::PxPyPzEVector &Met, const ROOT::Math::PxPyPzEVector &ISR,
-                      std::vector<ROOT::Math::PxPyPzEVector> &p1, std::vector<ROOT::Math::PxPyPzEVector> &p2);
+                      const FourVector &p3, const FourVector &p4, const FourVector &p5, const FourVector &p6, const FourVector &Met, const FourVector &ISR,
+                      std::vector<FourVector> &p1, std::vector<FourVector> &p2,
+                      int &nRejectedRoots);
+
+// p is an array containing the 6 momenta p1,...,p6
+// Returns -1 if the jacobian is close to singular (or not finite)
+double computeJacobianD(const FourVector *p, const double &sqrt_s);
 
-double computeJacobianD(const std::vector<ROOT::Math::PxPyPzEVector> &p, const double &sqrt_s);
+ISA_NAMESPACE_END
 
 #endif
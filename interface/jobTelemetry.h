@@ -0,0 +1,65 @@
+#ifndef _INC_JOBTELEMETRY
+#define _INC_JOBTELEMETRY
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+
+#include "integrandStages.h"
+
+// Job-level metrics, written periodically (and at the end of the job) as a snapshot file, to monitor many jobs
+// without parsing their logs: events done and remaining, events/hour and ETA, per-event latency (histogram and
+// quantiles), integrand evaluations per second, integrand time per stage, and memory usage (RSS).
+// Files ending in .prom are written in the Prometheus text format (for the node exporter textfile collector),
+// other files in JSON. The file is replaced atomically, so it can be read at any time.
+class JobTelemetry{
+  public:
+
+  // job is the label identifying the job in the metrics. The background thread writing the file every
+  // interval seconds is started here.
+  JobTelemetry(const std::string &fileName, const std::string &job, const double interval);
+  // Stops the background thread, and writes the final snapshot
+  ~JobTelemetry();
+
+  // Number of events of the job (< 0 if unknown, e.g. with the work queue)
+  void SetTotalEvents(const long total);
+  // Called for each processed event (thread-safe). realTime is the latency of the event (s), the counters
+  // are the integrand stage counters of its integration.
+  void AddEvent(const double realTime, const double cpuTime, const bool selected, const StageCounters &counters);
+
+  void Write();
+
+  private:
+
+  struct Snapshot;
+  void TakeSnapshot(Snapshot &snapshot);
+  std::string FormatJSON(const Snapshot &snapshot) const;
+  std::string FormatPrometheus(const Snapshot &snapshot) const;
+  void Run();
+
+  // Upper bounds of the latency histogram buckets (s)
+  static const std::vector<double> latencyBuckets;
+
+  std::string _fileName;
+  std::string _job;
+  bool _prometheus;
+  double _interval;
+  std::chrono::steady_clock::time_point _start;
+
+  std::mutex _mutex;
+  long _total;
+  long _nSelected;
+  double _cpuTime;
+  std::vector<double> _latencies;
+  StageCounters _counters;
+
+  std::mutex _stopMutex;
+  std::condition_variable _wakeUp;
+  bool _stop;
+  std::thread _thread;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef _INC_MATRIXELEMENT
+#define _INC_MATRIXELEMENT
+
+#include <vector>
+#include <utility>
+
+#include "fourVector.h"
+
+// Matrix element backend: evaluates the squared matrix elements of a process at many phase-space points per call,
+// for each of its initial states. The integrand collects the solutions of a batch of phase-space points and evaluates
+// their matrix elements in one call. Implementation: CPPProcessME (MadGraph standalone C++ output, one point at a time).
+// An instance is only used by one thread at a time.
+class MatrixElement{
+  public:
+
+  virtual ~MatrixElement() {}
+
+  // momenta[(point*nParticles + particle)*4 + mu] in (E,px,py,pz), with the two initial partons first, followed by the
+  // final-state particles in the order given to the backend. The matrix element of point i for the initial state s
+  // (see GetInitialStates) is written to values[i*nStates + s].
+  virtual void Evaluate(const int nPoints, const double *momenta, double *values) = 0;
+  // Initial states (pid1, pid2) for which the matrix elements are computed
+  virtual const std::vector< std::pair<int, int> >& GetInitialStates() const = 0;
+};
+
+// Solutions of the integrand (for several phase-space points and components) waiting for their matrix elements,
+// which are then evaluated in one call to the backend
+class MEBatch{
+  public:
+
+  MEBatch(const int nParticles = 0): _nParticles(nParticles) {}
+
+  inline void Clear() { _momenta.clear(); _indices.clear(); _factors.clear(); _x1.clear(); _x2.clear(); }
+  // index is the position of the integrand value the solution contributes to, factor everything but the matrix
+  // element and PDFs, x1 and x2 the momentum fractions of the initial partons. The momenta are in the order of the backend.
+  inline void Add(const int index, const double factor, const double x1, const double x2, const FourVector *momenta){
+    _indices.push_back(index);
+    _factors.push_back(factor);
+    _x1.push_back(x1);
+    _x2.push_back(x2);
+    for(int i = 0; i < _nParticles; ++i){
+      _momenta.push_back(momenta[i].e);
+      _momenta.push_back(momenta[i].px);
+      _momenta.push_back(momenta[i].py);
+      _momenta.push_back(momenta[i].pz);
+    }
+  }
+
+  inline int Size() const { return _indices.size(); }
+  inline const double* GetMomenta() const { return _momenta.data(); }
+  inline int GetIndex(const int i) const { return _indices[i]; }
+  inline double GetFactor(const int i) const { return _factors[i]; }
+  inline double GetX1(const int i) const { return _x1[i]; }
+  inline double GetX2(const int i) const { return _x2[i]; }
+  // Output of the backend
+  inline double* GetValues(const int nStates) { _values.resize(_indices.size()*nStates); return _values.data(); }
+
+  private:
+
+  int _nParticles;
+  std::vector<double> _momenta;
+  std::vector<int> _indices;
+  std::vector<double> _factors, _x1, _x2;
+  std::vector<double> _values;
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef _INC_QMCINTEGRATOR
+#define _INC_QMCINTEGRATOR
+
+#include <vector>
+#include <map>
+#include <cstdint>
+
+#include "quasiRandom.h"
+#include "vegasGrid.h"
+
+// Adaptive importance sampling with randomized quasi-Monte Carlo points.
+// As in Vegas, the integration variables are mapped through a separable grid, refined after each iteration
+// so that the bins have equal contributions to the variance. Each iteration uses several independent
+// randomizations of the point set: the spread of the replicates gives the error of the iteration,
+// and the iterations are combined weighting them by their inverse variance.
+// The grid is adapted using the sum of the absolute values of the components.
+class QMCIntegrator{
+  public:
+
+  enum Rule { SOBOL, LATTICE };
+
+  QMCIntegrator(const int nDim, const Rule rule, const uint64_t seed = 1);
+  ~QMCIntegrator();
+
+  // Integrate until error < max(relAccuracy*|result|, absAccuracy) for all components, or maxEval evaluations.
+  // nStart is the number of evaluations in the first iterations (the number of points per replicate is rounded up to a
+  // power of 2, or down if that would exceed maxEval).
+  // prob is the chi-square probability that the iterations are not consistent (as in CUBA, should be < 0.95).
+  // Returns the number of evaluations.
+  int Integrate(SamplingIntegrand integrand, void *userData, const int nComp, const int maxEval, const int nStart, const double relAccuracy, const double absAccuracy, double *result, double *error, double *prob);
+
+  // The randomizations of the n-th integration after setting the seed only depend on the seed and n
+  inline void SetSeed(const uint64_t seed) { _seed = seed; _nCalls = 0; }
+
+  private:
+
+  PointSet* GetPointSet(const uint64_t nPoints);
+
+  static const int _nReplicates = 8;
+  // Points passed at once to the integrand
+  static const int _blockSize = 64;
+  // Number of iterations with a constant number of points, before doubling it at each iteration
+  static const int _nAdaptIterations = 4;
+
+  int _nDim;
+  Rule _rule;
+  uint64_t _seed;
+  VegasGrid _grid;
+  PointSet* _sobol;
+  // Lattice rules depend on the number of points, and are built only once
+  std::map<uint64_t, PointSet*> _lattices;
+  // Number of calls to Integrate, so that successive integrations use independent randomizations
+  uint64_t _nCalls;
+};
+
+#endif
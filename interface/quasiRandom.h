@@ -0,0 +1,70 @@
+#ifndef _INC_QUASIRANDOM
+#define _INC_QUASIRANDOM
+
+#include <vector>
+#include <cstdint>
+
+// Randomized quasi-Monte Carlo point sets on the unit cube ]0,1[^d.
+// Each randomization gives an unbiased estimate of an integral, so that the spread of
+// independent randomizations (replicates) gives a reliable error estimate, which plain Sobol does not.
+
+// 64-bit mixing function (splitmix64), used to derive independent seeds
+inline uint64_t mixSeed(uint64_t x){
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+class PointSet{
+  public:
+
+  virtual ~PointSet() {}
+  // Draw a new randomization of the point set
+  virtual void Randomize(const uint64_t seed) = 0;
+  // Point i of the current randomization, x[0..dim-1]
+  virtual void GetPoint(const uint64_t i, double *x) const = 0;
+  inline int GetDimension() const { return _dim; }
+
+  protected:
+
+  int _dim;
+};
+
+// Sobol sequence (Joe-Kuo direction numbers, up to 10 dimensions) with nested uniform (Owen) scrambling,
+// implemented using the hash-based scrambling of B. Burley, JCGT 9 (2020).
+// The first 2^m points of each randomization form a (t,m,d)-net.
+class SobolSequence: public PointSet{
+  public:
+
+  SobolSequence(const int dim);
+  virtual void Randomize(const uint64_t seed);
+  virtual void GetPoint(const uint64_t i, double *x) const;
+
+  static const int maxDimension = 10;
+
+  private:
+
+  // Direction numbers, 32 per dimension
+  std::vector<uint32_t> _directions;
+  std::vector<uint32_t> _seeds;
+};
+
+// Rank-1 lattice rule with n points, x_i = frac(i*z/n + shift), with a random shift per randomization.
+// The generating vector is of Korobov type, z = (1, a, a^2, ...) mod n, where a minimises the P_2 criterion.
+class LatticeRule: public PointSet{
+  public:
+
+  LatticeRule(const int dim, const uint64_t n);
+  virtual void Randomize(const uint64_t seed);
+  virtual void GetPoint(const uint64_t i, double *x) const;
+  inline uint64_t GetNumberOfPoints() const { return _n; }
+
+  private:
+
+  uint64_t _n;
+  std::vector<uint64_t> _z;
+  std::vector<double> _shift;
+};
+
+#endif
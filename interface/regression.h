@@ -0,0 +1,45 @@
+#ifndef _INC_REGRESSION
+#define _INC_REGRESSION
+
+#include <string>
+#include <vector>
+
+#include "integrandStages.h"
+
+// Comparison of the weights of a fixed set of events with stored reference values,
+// to check that a change (optimisation, new integrator, ...) does not modify the results.
+
+struct RegressionRecord{
+  enum Status { NOT_SELECTED = 0, WEIGHTED = 1, PRESCREENED = 2 };
+
+  long entry;
+  int status;
+  double weight, error;
+  // CPU time (s), only reported
+  double time;
+  StageCounters counters;
+  // Counters present in the file the record was read from (bit i for the counter i): references written by an older
+  // version may lack counters added since then, which are not compared
+  unsigned int countersPresent = (1u << StageCounters::N_COUNTERS) - 1;
+};
+
+// A weight passes if |weight - reference| <= max(weightRel*|reference|, weightSigma*sqrt(error^2 + reference error^2)),
+// its error if |error - reference error| <= errorRel*(reference error),
+// and each stage counter if |counter - reference| <= countersRel*reference.
+// In reproducible mode (same seed), an unchanged code gives identical results, and all tolerances can be 0.
+struct RegressionTolerances{
+  double weightRel = 0.;
+  double weightSigma = 3.;
+  double errorRel = 0.5;
+  double countersRel = 0.05;
+};
+
+// Text file, one line per event: "entry status weight error time counters...", with a header line starting with #
+// naming the columns. The counters are read by name, so that files with fewer counters (or in another order) can be read.
+bool WriteRegressionFile(const std::string &fileName, const std::vector<RegressionRecord> &records);
+bool ReadRegressionFile(const std::string &fileName, std::vector<RegressionRecord> &records);
+
+// Compare the records (matched by entry) and print the deviations, returns the number of failing events
+int CompareRegression(const std::vector<RegressionRecord> &reference, const std::vector<RegressionRecord> &current, const RegressionTolerances &tolerances);
+
+#endif
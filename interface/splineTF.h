@@ -0,0 +1,91 @@
+#ifndef _INC_SPLINETF
+#define _INC_SPLINETF
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "TFile.h"
+
+#include "tfComponent.h"
+#include "tableCache.h"
+
+// Same histogram as BinnedTF (fixed-width bins), but interpolated with Catmull-Rom cubic splines
+// between the bin centres, in both Egen and delta: the TF is continuous, with a continuous derivative,
+// which avoids the discontinuities of the binned TF in the integrand.
+// The contents are a flat table (copied from the histogram, or used in place from a table cache),
+// so that an evaluation is a few multiplications and 16 table reads.
+class SplineTF: public TFComponent{
+  public:
+
+  SplineTF(const std::string particleName, const std::string histName, TFile* file);
+  // The values of the table are not copied: the cache must outlive the TF
+  SplineTF(const std::string particleName, const TableView &table);
+
+  inline double Evaluate(const double &Erec, const double &Egen) const override;
+  inline double GetDeltaMin(const double &Erec) const override { return std::max(_deltaMin, Erec - _EgenMax); }
+  inline double GetDeltaMax(const double &Erec) const override { return std::min(_deltaMax, Erec - _EgenMin); }
+  // Cumulative distribution of the bins of the Egen slice containing Erec
+  void FillSampler(const double &Erec, DeltaSampler &sampler) const override;
+
+  private:
+
+  void SetTable(const TableView &table);
+
+  // Weights of the 4 nodes around t in [0,1]
+  static inline void CatmullRom(const double t, double *w);
+
+  std::string _particleName;
+  double _deltaMin, _deltaMax;
+  double _EgenMin, _EgenMax;
+  int _nEgen, _nDelta;
+  double _EgenWidth, _deltaWidth;
+  // _values[iEgen*_nDelta + iDelta], pointing to _ownValues or to a table cache
+  const double *_values;
+  std::vector<double> _ownValues;
+  std::vector<double> _cdfs;
+};
+
+inline void SplineTF::CatmullRom(const double t, double *w){
+  const double t2 = t*t;
+  const double t3 = t2*t;
+  w[0] = 0.5*(-t3 + 2.*t2 - t);
+  w[1] = 0.5*(3.*t3 - 5.*t2 + 2.);
+  w[2] = 0.5*(-3.*t3 + 4.*t2 + t);
+  w[3] = 0.5*(t3 - t2);
+}
+
+inline double SplineTF::Evaluate(const double &Erec, const double &Egen) const {
+  const double delta = Erec - Egen;
+
+  if(Egen < _EgenMin || Egen > _EgenMax || delta > _deltaMax || delta < _deltaMin)
+    return 0.;
+
+  // Position relative to the bin centres. Outside of the outer centres, the nodes are clamped to the border bins.
+  const double u = (Egen - _EgenMin)/_EgenWidth - 0.5;
+  const double v = (delta - _deltaMin)/_deltaWidth - 0.5;
+  const int i = static_cast<int>(std::floor(u));
+  const int j = static_cast<int>(std::floor(v));
+
+  double wu[4], wv[4];
+  CatmullRom(u - i, wu);
+  CatmullRom(v - j, wv);
+
+  int rows[4], columns[4];
+  for(int k = 0; k < 4; ++k){
+    rows[k] = std::min(std::max(i - 1 + k, 0), _nEgen - 1) * _nDelta;
+    columns[k] = std::min(std::max(j - 1 + k, 0), _nDelta - 1);
+  }
+
+  double value = 0.;
+  for(int k = 0; k < 4; ++k){
+    const double *row = &_values[rows[k]];
+    value += wu[k] * (wv[0]*row[columns[0]] + wv[1]*row[columns[1]] + wv[2]*row[columns[2]] + wv[3]*row[columns[3]]);
+  }
+
+  // The cubic interpolation can undershoot next to empty bins
+  return std::max(value, 0.);
+}
+
+#endif
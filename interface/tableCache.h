@@ -0,0 +1,120 @@
+#ifndef _INC_TABLECACHE
+#define _INC_TABLECACHE
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+
+// Binary cache of the tables needed at startup (TF histograms, PDFs at a fixed scale), written once by
+// tools/compile_cache and memory-mapped read-only by the jobs: all the processes on a node share the same
+// copy of the file in the page cache, and reading it needs neither ROOT nor LHAPDF.
+//
+// Layout (native endianness, all blocks aligned to 8 bytes):
+//   TableCacheHeader
+//   nTables x TableCacheEntry
+//   data: the values of each table, as doubles
+// The checksum (64-bit FNV-1a) covers everything after the header. A file with another version is rejected.
+
+struct TableCacheHeader{
+  char magic[8];
+  uint32_t version;
+  uint32_t nTables;
+  uint64_t size;
+  uint64_t checksum;
+};
+
+struct TableCacheEntry{
+  char name[112];
+  int32_t nx, ny;
+  double xMin, xMax, yMin, yMax;
+  // Position of the values from the beginning of the file, in bytes
+  uint64_t offset;
+};
+
+// Table of nx*ny values over [xMin,xMax]x[yMin,yMax], values[ix*ny + iy].
+// For TF histograms, the values are the contents of fixed-width bins (x = Egen, y = delta);
+// for PDFs, they are nodes of a 1D grid (see PdfTable).
+struct TableView{
+  int nx, ny;
+  double xMin, xMax, yMin, yMax;
+  const double *values;
+};
+
+class TableCache{
+  public:
+
+  static const uint32_t version = 1;
+
+  // Map the file, and check its format, version and checksum (exits on errors)
+  TableCache(const std::string &fileName);
+  ~TableCache();
+
+  // True if the file starts with the magic string of a table cache
+  static bool IsCacheFile(const std::string &fileName);
+
+  // Returns false if there is no such table
+  bool GetTable(const std::string &name, TableView &table) const;
+
+  // Write the tables to a cache file, returns false on errors
+  static bool Write(const std::string &fileName, const std::vector<std::string> &names, const std::vector<TableView> &tables);
+
+  private:
+
+  std::string _fileName;
+  const char *_data;
+  size_t _size;
+  std::map<std::string, TableView> _tables;
+};
+
+// PDF at a fixed scale, from the tables "pdf:NAME:MEMBER:PID" of a cache: x*f(x) on nodes equally spaced in log(x)
+// (the table x range is log(x)), interpolated with cubic Catmull-Rom splines. Read-only, can be shared by all threads.
+class PdfTable{
+  public:
+
+  // Partons included in the cache
+  static const std::vector<int> pids;
+
+  // Returns false if the cache has no tables for this PDF
+  bool Load(const TableCache &cache, const std::string &pdfName, const int member = 0);
+
+  // x*f(x) at the scale of the cache, 0 outside the x range
+  inline double xfx(const int pid, const double x) const;
+  inline double GetQ2() const { return _q2; }
+
+  static std::string GetTableName(const std::string &pdfName, const int member, const int pid);
+
+  private:
+
+  // Index of the pids in the tables: -6..6, gluon as 0 or 21
+  static inline int GetIndex(const int pid) { return pid == 21 ? 6 : pid + 6; }
+
+  double _q2;
+  TableView _tables[13];
+  bool _hasTable[13];
+};
+
+inline double PdfTable::xfx(const int pid, const double x) const {
+  const int index = GetIndex(pid);
+  if(index < 0 || index > 12 || !_hasTable[index] || !(x > 0.))
+    return 0.;
+
+  const TableView &table = _tables[index];
+  const double logX = std::log(x);
+  if(logX < table.xMin || logX > table.xMax)
+    return 0.;
+
+  const double u = (logX - table.xMin)/(table.xMax - table.xMin)*(table.nx - 1);
+  const int i = std::min(static_cast<int>(u), table.nx - 2);
+  const double t = u - i;
+  const double t2 = t*t, t3 = t2*t;
+
+  // Catmull-Rom, with the border nodes repeated
+  const double *v = table.values;
+  const double v0 = v[std::max(i - 1, 0)], v1 = v[i], v2 = v[i + 1], v3 = v[std::min(i + 2, table.nx - 1)];
+  return 0.5*( (-t3 + 2.*t2 - t)*v0 + (3.*t3 - 5.*t2 + 2.)*v1 + (-3.*t3 + 4.*t2 + t)*v2 + (t3 - t2)*v3 );
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef _INC_TFCOMPONENT
+#define _INC_TFCOMPONENT
+
+#include <vector>
+#include <algorithm>
+
+// Importance sampling of delta = Erec - Egen for one event: piecewise constant density q(delta) on [rangeMin, rangeMax],
+// sampled by inverse CDF (the TF analogue of flattenBW). The integrand TF/q is then nearly flat in delta.
+class DeltaSampler{
+  public:
+
+  // q uniform on [rangeMin, rangeMax]
+  void SetUniform(const double rangeMin, const double rangeMax);
+  // q proportional to the slice of a binned TF, given by its cumulative distribution: cdf[0..nBins] at the bin edges
+  // histMin + k*width, restricted to [rangeMin, rangeMax]. A fraction uniformFraction of the probability is spread
+  // uniformly over the range, so that q > 0 wherever the TF of another Egen can be non-zero.
+  void SetFromCDF(const double *cdf, const int nBins, const double histMin, const double width,
+                  const double rangeMin, const double rangeMax, const double uniformFraction = 0.1);
+
+  // Map u in [0,1] to delta, and return the density q(delta)
+  inline double Sample(const double u, double &delta) const;
+
+  // Cumulative distributions of the slices of a binned TF: values[i*nBins + j] is bin j of slice i (bin width width),
+  // the result has nBins+1 entries per slice, normalised to 1 (slices with no content are left at 0)
+  static std::vector<double> ComputeCDFs(const double *values, const int nSlices, const int nBins, const double width);
+
+  private:
+
+  // Segment edges, and cumulative probability at the edges (from 0 to 1)
+  std::vector<double> _edges, _cumulative;
+};
+
+inline double DeltaSampler::Sample(const double u, double &delta) const {
+  // Segment k such that _cumulative[k] <= u < _cumulative[k+1]
+  const size_t k = std::upper_bound(_cumulative.begin() + 1, _cumulative.end() - 1, u) - _cumulative.begin() - 1;
+  const double probability = _cumulative[k+1] - _cumulative[k];
+  const double width = _edges[k+1] - _edges[k];
+
+  delta = _edges[k] + (u - _cumulative[k])/probability * width;
+  return probability/width;
+}
+
+// Transfer function of one type of particle: probability density of delta = Erec - Egen, for a given Egen.
+// The energy is integrated over the range [Erec - deltaMax, Erec - deltaMin], outside of which the TF vanishes.
+class TFComponent{
+  public:
+
+  // Implementations of the components which can be chosen in TransferFunction::DefineComponent
+  enum Type {
+    BINNED,           // histogram from the TF file (BinnedTF)
+    SPLINE,           // same histogram, interpolated between the bin centres (SplineTF)
+    DOUBLE_GAUSSIAN   // parametric double-Gaussian, parameters from a text file (DoubleGaussianTF)
+  };
+
+  virtual ~TFComponent() {}
+
+  virtual double Evaluate(const double &Erec, const double &Egen) const = 0;
+  virtual double GetDeltaMin(const double &Erec) const = 0;
+  virtual double GetDeltaMax(const double &Erec) const = 0;
+  inline double GetDeltaRange(const double &Erec) const { return GetDeltaMax(Erec) - GetDeltaMin(Erec); }
+
+  // Per event: sampling density of delta approximating the TF at Egen = Erec, over the integration range.
+  // Uniform by default.
+  virtual void FillSampler(const double &Erec, DeltaSampler &sampler) const { sampler.SetUniform(GetDeltaMin(Erec), GetDeltaMax(Erec)); }
+};
+
+#endif
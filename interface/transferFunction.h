@@ -8,15 +8,21 @@
 
 #include "TFile.h"
 
-#include "binnedTF.h"
+#include "tfComponent.h"
+#include "tableCache.h"
 
 class TransferFunction{
   public:
 
   TransferFunction(const std::string file);
+  // Histograms taken from a table cache (see tools/compile_cache), which must outlive the TF
+  TransferFunction(const TableCache &cache);
   ~TransferFunction();
 
-  void DefineComponent(const std::string particleName, const std::string histName);
+  // name is the histogram in the TF file for the BINNED and SPLINE types, or the parameter file for DOUBLE_GAUSSIAN
+  void DefineComponent(const std::string particleName, const std::string name, const TFComponent::Type type = TFComponent::BINNED);
+  // Resolve a component once (e.g. per event), instead of looking it up by name at every evaluation
+  const TFComponent* GetComponent(const std::string &particleName) const;
 
   inline double Evaluate(const std::string &particleName, const double &Erec, const double &Egen);
   inline double GetDeltaRange(const std::string &particleName, const double &Erec);
@@ -26,8 +32,9 @@ class TransferFunction{
   private:
 
   TFile* _file;
+  const TableCache* _cache;
 
-  std::map< std::string, BinnedTF* > _TF;
+  std::map< std::string, TFComponent* > _TF;
 };
 
 inline double TransferFunction::Evaluate(const std::string &particleName, const double &Erec, const double &Egen){
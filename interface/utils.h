@@ -5,12 +5,17 @@
 #define _USE_MATH_DEFINES // include M_PI constant
 #include <cmath>
 
+#include "isaTarget.h"
+
 #define SQ(x) (x*x)
 #define CB(x) (x*x*x)
 #define QU(x) (x*x*x*x)
 
 //#define M_PI 3.1415927410125732421875
 
+// Compiled for each ISA level (see isaTarget.h)
+ISA_NAMESPACE_BEGIN
+
 // Set option flags for CUBA integrator
 // 
 // smoothing only used by Suave
@@ -129,6 +134,27 @@ bool solve2Quads(const double a20, const double a02, const double a11, const dou
                 bool verbose = false
                 );
 
+// Refines a solution (e1,e2) of the system of solve2Quads with a few Newton iterations,
+// stopping when the residual doesn't decrease anymore.
+// Returns the residual: largest value of both conics, relative to the sum of the absolute values of their terms.
+double polish2Quads(const double a20, const double a02, const double a11, const double a10, const double a01, const double a00,
+                    const double b20, const double b02, const double b11, const double b10, const double b01, const double b00,
+                    double &e1, double &e2,
+                    const int maxIterations = 4
+                    );
+
+// Same as solve2Quads, but the solutions are polished (polish2Quads), and only the finite ones
+// with a residual below maxResidual are kept. nRejected is set to the number of solutions dropped.
+// If solutions were dropped, or if the E1^2 coefficients are tiny compared to the other terms, the system
+// is solved again eliminating E2^2 instead of E1^2, and the result with most distinct solutions is kept.
+// Returns false if there are no solutions, or if some coefficients are not finite.
+bool solve2QuadsPolished(const double a20, const double a02, const double a11, const double a10, const double a01, const double a00,
+                         const double b20, const double b02, const double b11, const double b10, const double b01, const double b00,
+                         std::vector<double>& E1, std::vector<double>& E2,
+                         int &nRejected,
+                         const double maxResidual = 1e-8
+                         );
+
 // Solves the system:
 // a11*E1*E2 + a10*E1 + a01*E2 + a00 = 0
 // b11*E1*E2 + b10*E1 + b01*E2 + b00 = 0
@@ -154,4 +180,6 @@ bool solve2Linear(const double a10, const double a01, const double a00,
 
 double BreitWigner(const double s, const double m, const double g);
 
+ISA_NAMESPACE_END
+
 #endif
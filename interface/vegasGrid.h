@@ -0,0 +1,95 @@
+#ifndef _INC_VEGASGRID
+#define _INC_VEGASGRID
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+// Tools shared by the built-in integrators (qmcIntegrator.h, vegasIntegrator.h)
+
+// Same signature as the CUBA integrands, so that the same integrand can be used with all integrators
+// core is the index of the calling thread (0 for single-threaded integrators)
+// The integrand is called with *nVec points at once: x[point*nDim + i], f[point*nComp + c], weight[point]
+typedef int (*SamplingIntegrand)(const int *nDim, const double *x, const int *nComp, double *f, void *userData, const int *nVec, const int *core, const double *weight);
+
+// Vegas importance sampling grid: separable piecewise-linear map from the unit hypercube to itself,
+// with nBins bins per dimension. Refining the grid moves the bin edges so that all the bins
+// have the same (damped) contribution to the variance.
+class VegasGrid{
+  public:
+
+  VegasGrid(const int nDim = 0, const int nBins = 64);
+
+  // Uniform grid
+  void Reset();
+
+  // Map y in [0,1]^d to x through the grid, returns the jacobian; bins[d] is the bin used in dimension d
+  inline double Map(const double *y, double *x, int *bins) const;
+  // Same for a block of n points stored as structure of arrays (y[d*n + k]: dimension d of point k).
+  // The loops have no branches and contiguous accesses (except the gather of the edges), so that the compiler can vectorize them.
+  void MapBlock(const int n, const double *y, double *x, int *bins, double *jacobian) const;
+
+  // binVariance[d*nBins + b] is the accumulated squared integrand for bin b of dimension d
+  void Refine(const std::vector<double> &binVariance, const double alpha = 1.5);
+
+  // Text file: "VegasGrid nDim nBins", followed by the nBins+1 edges of each dimension on one line.
+  // Load returns false if the file can't be read, or doesn't match the dimensions of the grid.
+  bool Save(const std::string &fileName) const;
+  bool Load(const std::string &fileName);
+
+  inline int GetDimension() const { return _nDim; }
+  inline int GetNumberOfBins() const { return _nBins; }
+  inline const std::vector<double>& GetEdges() const { return _edges; }
+
+  private:
+
+  int _nDim, _nBins;
+  // (nBins+1) edges per dimension, and nBins widths per dimension
+  std::vector<double> _edges, _widths;
+};
+
+inline double VegasGrid::Map(const double *y, double *x, int *bins) const {
+  double jacobian = 1.;
+
+  for(int d = 0; d < _nDim; ++d){
+    const double *edges = &_edges[(_nBins+1)*d];
+    const double t = y[d]*_nBins;
+    const int bin = std::min(static_cast<int>(t), _nBins-1);
+    const double width = _widths[_nBins*d + bin];
+    x[d] = edges[bin] + (t - bin)*width;
+    jacobian *= _nBins*width;
+    bins[d] = bin;
+  }
+
+  return jacobian;
+}
+
+// Combination of the results of successive iterations, weighted by their inverse variance.
+// Iterations with a vanishing variance (e.g. no point where the integrand is non-zero) are left out of the combination
+// as soon as another iteration has a finite variance. The result is only exact if all the iterations have a vanishing
+// variance and the same mean.
+class IterationResults{
+  public:
+
+  IterationResults(): _sumWeights(0.), _sumWeighted(0.), _nExact(0), _exactMin(0.), _exactMax(0.), _exactSum(0.) {}
+
+  void Add(const double mean, const double variance);
+  double GetResult() const;
+  double GetError() const;
+  // Chi-square probability that the iterations are not consistent (as in CUBA, should be < 0.95)
+  double GetProb() const;
+  // True if all the iterations have a vanishing variance and the same mean: the integrator should then sample more
+  // points before trusting the result, since a peaked integrand can be missed by the first iterations
+  inline bool IsExact() const { return _sumWeights == 0. && _nExact > 0 && _exactMin == _exactMax; }
+
+  private:
+
+  std::vector<double> _means, _variances;
+  double _sumWeights, _sumWeighted;
+  // Iterations with a vanishing variance: number, range and sum of their means
+  int _nExact;
+  double _exactMin, _exactMax, _exactSum;
+};
+
+#endif
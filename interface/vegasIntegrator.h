@@ -0,0 +1,77 @@
+#ifndef _INC_VEGASINTEGRATOR
+#define _INC_VEGASINTEGRATOR
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "vegasGrid.h"
+
+// Vegas+ integrator (G.P. Lepage, J. Comput. Phys. 439 (2021) 110386):
+// Vegas importance sampling grid, combined with adaptive stratified sampling. The grid-mapped hypercube
+// is divided into nStrat^d sub-cubes, and the number of points in each sub-cube is proportional to
+// (its standard deviation)^beta, estimated in the previous iteration.
+//
+// The sub-cubes are processed in batches by a pool of threads, each thread taking the next free batch,
+// so that the load is balanced whatever the cost of the integrand. The integrand receives the thread index
+// as "core" argument, and must be thread-safe for different thread indices.
+// The random numbers only depend on the seed, iteration and sub-cube, and all sums are done in a fixed order,
+// so the results do not depend on the number of threads.
+class VegasIntegrator{
+  public:
+
+  VegasIntegrator(const int nDim, const int nThreads = 1, const uint64_t seed = 1);
+
+  // Integrate until error < max(relAccuracy*|result|, absAccuracy) for all components, or maxEval evaluations.
+  // nStart is the number of evaluations per iteration. The grid is adapted using the sum of the absolute values of the components.
+  // prob is the chi-square probability that the iterations are not consistent (as in CUBA, should be < 0.95).
+  // Returns the number of evaluations.
+  int Integrate(SamplingIntegrand integrand, void *userData, const int nComp, const int maxEval, const int nStart, const double relAccuracy, const double absAccuracy, double *result, double *error, double *prob);
+
+  // Grid at the end of the last integration
+  inline const VegasGrid& GetGrid() const { return _grid; }
+  // Grid used at the start of each integration (uniform by default), e.g. loaded from a file with VegasGrid::Load
+  inline void SetInitialGrid(const VegasGrid &grid) { _initialGrid = grid; }
+  inline const VegasGrid& GetInitialGrid() const { return _initialGrid; }
+  inline int GetNumberOfThreads() const { return _nThreads; }
+  // The random numbers of the n-th integration after setting the seed only depend on the seed and n
+  inline void SetSeed(const uint64_t seed) { _seed = seed; _nCalls = 0; }
+
+  private:
+
+  // Accumulators for a batch of sub-cubes
+  struct BatchResults{
+    std::vector<double> binVariance;
+  };
+
+  // Sample the sub-cubes first to last-1, filling the per-cube sums and the batch accumulators
+  void SampleCubes(const int first, const int last, const int thread, BatchResults &batch);
+
+  static const double _beta;
+  // Number of iterations which are not included in the result (if more iterations are done)
+  static const int _nWarmupIterations = 3;
+  // Number of batches in each iteration: more batches give a better balance of the load.
+  // It must not depend on the number of threads, since the grid accumulators are summed per batch.
+  static const int _nBatches = 128;
+  // Maximal number of points mapped through the grid at once
+  static const int _blockSize = 64;
+
+  int _nDim;
+  int _nThreads;
+  uint64_t _seed;
+  uint64_t _nCalls;
+  VegasGrid _grid, _initialGrid;
+
+  // State of the current iteration
+  SamplingIntegrand _integrand;
+  void *_userData;
+  int _nComp;
+  int _nStrat;
+  uint64_t _iterationSeed;
+  // Number of points per sub-cube
+  std::vector<int> _nPoints;
+  // Per sub-cube: sum and sum of squares of f*jacobian for each component, and of the sum over the components of |f*jacobian|
+  std::vector<double> _sums, _sums2, _sumsAbs, _sumsAbs2;
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef _INC_WEIGHTCACHE
+#define _INC_WEIGHTCACHE
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "MEPermutations.h"
+
+// 128-bit hash of a sequence of values (two independent splitmix64 chains over 64-bit words)
+class ContentHash{
+  public:
+
+  ContentHash(): _h1(0x6a09e667f3bcc908ULL), _h2(0xbb67ae8584caa73bULL) {}
+
+  void Add(const void *data, const size_t size);
+  inline void Add(const uint64_t value) { AddWord(value); }
+  void Add(const double value);
+  // Length first, so that consecutive strings can't be confused
+  void Add(const std::string &value);
+  // 32 hexadecimal digits
+  std::string GetHex() const;
+
+  private:
+
+  void AddWord(const uint64_t word);
+
+  uint64_t _h1, _h2;
+};
+
+// Hash of the content of a file (e.g. TF file), empty if it can't be read
+std::string HashFile(const std::string &fileName);
+
+// Persistent cache of event weights on the local disk, so that reruns and resubmissions don't integrate again the
+// events already done. The key is a hash of the four-vectors of all the permutations of the event, and of a
+// configuration string describing everything else the weights depend on (process, TF file content, PDF, integrator
+// settings...), built by the driver, and of the version of the code (codeVersion, and the git revision of the build
+// when compiled with the makefile), so that the weights of an older build are not reused. Each entry is a small file DIR/xx/<key>, written to a temporary file and
+// renamed, so that several local processes can share the cache without locks (readers never see partial entries).
+class WeightCache{
+  public:
+
+  struct Result{
+    bool weighted;
+    double weight, error;
+    // CPU time of the original integration (s)
+    double time;
+    std::vector<double> memberWeights, memberErrors;
+  };
+
+  // To be bumped by changes of the code which change the weights, in case the git revision is not known
+  static const int codeVersion = 1;
+
+  WeightCache(const std::string &directory, const std::string &configuration);
+
+  // Git revision of the build (MEM_BUILD_ID, set by the makefile), empty if unknown
+  static std::string GetBuildId();
+
+  // eventID is only part of the key if it determines the random numbers (reproducible mode), otherwise pass -1
+  std::string GetKey(const MEPermutations &permutations, const long eventID) const;
+  bool Lookup(const std::string &key, Result &result);
+  void Store(const std::string &key, const Result &result);
+
+  inline long GetHits() const { return _nHits; }
+  inline long GetMisses() const { return _nMisses; }
+
+  private:
+
+  std::string GetPath(const std::string &key) const;
+
+  std::string _directory;
+  std::string _configurationHash;
+  long _nHits, _nMisses, _nStored;
+};
+
+#endif
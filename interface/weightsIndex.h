@@ -0,0 +1,94 @@
+#ifndef _INC_WEIGHTSINDEX
+#define _INC_WEIGHTSINDEX
+
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstddef>
+
+// Indexed binary file of merged weights, written by tools/merge_weights from the per-job outputs.
+// There is one fixed-size record per entry of the range [firstEntry, firstEntry + nEntries), so that the record of
+// an entry is found directly from its position, and missing entries are kept (status WEIGHTS_MISSING).
+//
+// Layout (native endianness):
+//   WeightsIndexHeader
+//   nEntries x WeightsIndexRecord
+// The checksum (64-bit FNV-1a) covers the records. A file with another version is rejected.
+
+struct WeightsIndexHeader{
+  char magic[8];
+  uint32_t version;
+  uint32_t recordSize;
+  int64_t firstEntry;
+  uint64_t nEntries;
+  // Entries without weight in any input, and entries found more than once (only the first one is kept)
+  uint64_t nMissing;
+  uint64_t nDuplicates;
+  uint64_t checksum;
+};
+
+enum WeightsStatus { WEIGHTS_MISSING = 0, WEIGHTS_NOT_WEIGHTED = 1, WEIGHTS_WEIGHTED = 2 };
+
+struct WeightsIndexRecord{
+  double weight, error;
+  // CPU time of the event (s)
+  double time;
+  int32_t status;
+  // Position of the input file the weight comes from (in the arguments of merge_weights), -1 if missing
+  int32_t input;
+};
+
+// Writes the records one entry after the other, without keeping them in memory
+class WeightsIndexWriter{
+  public:
+
+  // Exits if the file can't be created
+  WeightsIndexWriter(const std::string &fileName, const long firstEntry);
+
+  // Record of the next entry
+  void Add(const WeightsIndexRecord &record);
+  inline void AddDuplicate() { ++_header.nDuplicates; }
+  // Writes the header, returns false on errors
+  bool Close();
+
+  inline long GetNextEntry() const { return _header.firstEntry + _header.nEntries; }
+
+  private:
+
+  std::string _fileName;
+  std::ofstream _file;
+  WeightsIndexHeader _header;
+};
+
+// Read-only view of an index file (memory-mapped)
+class WeightsIndex{
+  public:
+
+  static const uint32_t version = 1;
+
+  // Map the file, and check its format, version and checksum (exits on errors)
+  WeightsIndex(const std::string &fileName);
+  ~WeightsIndex();
+
+  inline long GetFirstEntry() const { return _header->firstEntry; }
+  inline long GetNumberOfEntries() const { return _header->nEntries; }
+  inline long GetNumberOfMissing() const { return _header->nMissing; }
+  inline long GetNumberOfDuplicates() const { return _header->nDuplicates; }
+
+  // nullptr if the entry is outside the range of the file
+  inline const WeightsIndexRecord* Get(const long entry) const {
+    if(entry < _header->firstEntry || entry >= static_cast<long>(_header->firstEntry + _header->nEntries))
+      return nullptr;
+    return _records + (entry - _header->firstEntry);
+  }
+
+  private:
+
+  std::string _fileName;
+  const char *_data;
+  size_t _size;
+  const WeightsIndexHeader *_header;
+  const WeightsIndexRecord *_records;
+};
+
+#endif
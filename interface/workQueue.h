@@ -0,0 +1,96 @@
+#ifndef _INC_WORKQUEUE
+#define _INC_WORKQUEUE
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <cstdio>
+#include <mutex>
+
+// Dynamic distribution of events to several local worker processes, through a Unix socket.
+// The protocol is line-based:
+//   worker -> coordinator: "GET" (ask for events), "RESULT entry weight error time status"
+//   coordinator -> worker: "CHUNK n entry_1 ... entry_n", "WAIT" (retry later), "DONE"
+// Chunks are sized dynamically: large at the beginning, down to single events at the end of the queue.
+// With predicted costs (see costModel.h), the events are handed out longest first, and the chunks are sized by predicted cost.
+// If a worker disconnects before sending back all its results, the missing events are handed out again, up to
+// maxAttempts times in total: an event which makes every worker crash is then recorded as failed. If all the workers
+// have left and none connects within idleTimeout seconds, the remaining events are recorded as failed.
+
+// Status of an event in the results: weighted, not weighted (not selected, or rejected by the pre-screening),
+// or failed (no weight, e.g. entry outside of the input)
+enum QueueStatus { QUEUE_WEIGHTED = 0, QUEUE_NOT_WEIGHTED = 1, QUEUE_FAILED = 2 };
+const char* GetQueueStatusName(const QueueStatus status);
+// Returns false for unknown names
+bool ParseQueueStatus(const std::string &name, QueueStatus &status);
+
+class WorkQueueCoordinator{
+  public:
+
+  // Events first to last (included) are distributed, with at most maxChunk events at a time
+  // The results are written to resultFile, one line "entry weight error time status" per event, as they arrive
+  WorkQueueCoordinator(const std::string &socketPath, const long first, const long last, const long maxChunk, const std::string &resultFile);
+  ~WorkQueueCoordinator();
+
+  // Predicted cost of the events (events without a prediction get the average cost), to be set before Run
+  void SetPredictedCosts(const std::map<long, double> &costs);
+
+  // Serve the workers until all the events are done or failed
+  void Run();
+  inline long GetNumberOfFailed() const { return _nFailed; }
+
+  private:
+
+  struct WorkerState{
+    std::string buffer;
+    std::set<long> assigned;
+  };
+
+  void ProcessLine(const int fd, const std::string &line);
+  void Disconnect(const int fd);
+  void Send(const int fd, const std::string &message);
+  double GetCost(const long entry) const;
+  void WriteResult(const long entry, const double weight, const double error, const double time, const QueueStatus status);
+
+  static const int maxAttempts = 3;
+  static const int idleTimeout = 60;
+
+  std::string _socketPath;
+  int _listenFd;
+  FILE* _results;
+  long _maxChunk;
+  long _nEvents, _nDone, _nAssigned, _nFailed;
+  // Number of workers which have connected so far
+  long _nConnections;
+  // Number of times each event has been handed out
+  std::map<long, int> _attempts;
+  std::deque<long> _pending;
+  std::map<long, double> _costs;
+  double _defaultCost, _pendingCost;
+  std::map<int, WorkerState> _workers;
+};
+
+class WorkQueueClient{
+  public:
+
+  WorkQueueClient(const std::string &socketPath);
+  ~WorkQueueClient();
+
+  // Get the next events to process, returns false when the queue is empty
+  // NextChunk and SendResult can be called from two different threads (e.g. event reader and writer)
+  bool NextChunk(std::vector<long> &entries);
+  void SendResult(const long entry, const double weight, const double error, const double time, const QueueStatus status);
+
+  private:
+
+  std::string ReadLine();
+  bool Send(const std::string &message);
+
+  int _fd;
+  std::string _buffer;
+  std::mutex _sendMutex;
+};
+
+#endif
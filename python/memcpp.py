@@ -0,0 +1,212 @@
+"""ctypes bindings of the MEMcpp C API (interface/MEMcpp.h, library built with `make ttbar_lib`).
+
+The numpy arrays are passed to the library without copies if they are contiguous and have the
+expected type (float64, int32 for the jet multiplicities and b-tagging words, int64 for the IDs);
+other arrays are converted first. The results are written directly into numpy arrays.
+
+    import numpy as np
+    from memcpp import MEMcpp
+    mem = MEMcpp("TF.root", integrator="native", nThreads=4)
+    res = mem.compute(positron=(pt, eta, phi, e), muon=(...), jets=(pt, eta, phi, e),
+                      nJets=nj, jetBTag=btag, met=(met, met_phi))
+    res["weight"], res["error"], res["status"], ...
+
+Jet arrays are 2D (events x jetStride), and only the first nJets[i] jets of event i are used.
+"""
+
+import ctypes
+import os
+
+import numpy as np
+
+_double_p = ctypes.POINTER(ctypes.c_double)
+_int32_p = ctypes.POINTER(ctypes.c_int32)
+_int64_p = ctypes.POINTER(ctypes.c_int64)
+_uint64_p = ctypes.POINTER(ctypes.c_uint64)
+
+INTEGRATORS = {"vegas": 0, "sobol": 1, "lattice": 2, "native": 3}
+TF_TYPES = {"binned": 0, "spline": 1, "gaussian": 2}
+STATUS = {0: "not_selected", 1: "weighted", 2: "prescreened"}
+
+
+class _Config(ctypes.Structure):
+    _fields_ = [
+        ("tfFile", ctypes.c_char_p),
+        ("pdfName", ctypes.c_char_p),
+        ("paramCard", ctypes.c_char_p),
+        ("integrator", ctypes.c_int),
+        ("nThreads", ctypes.c_int),
+        ("prune", ctypes.c_double),
+        ("preScreenPoints", ctypes.c_int),
+        ("preScreenMinWeight", ctypes.c_double),
+        ("seed", ctypes.c_uint64),
+        ("tfSampling", ctypes.c_int),
+        ("tfTypes", ctypes.c_int * 3),
+        ("tfFiles", ctypes.c_char_p * 3),
+        ("leptonPtMin", ctypes.c_double),
+        ("leptonEtaMax", ctypes.c_double),
+        ("jetPtMin", ctypes.c_double),
+        ("jetEtaMax", ctypes.c_double),
+        ("bTagMask", ctypes.c_uint),
+        ("maxJets", ctypes.c_uint),
+    ]
+
+
+class _Events(ctypes.Structure):
+    _fields_ = [
+        ("nEvents", ctypes.c_long),
+        ("positronPt", _double_p), ("positronEta", _double_p), ("positronPhi", _double_p), ("positronE", _double_p),
+        ("muonPt", _double_p), ("muonEta", _double_p), ("muonPhi", _double_p), ("muonE", _double_p),
+        ("jetStride", ctypes.c_int),
+        ("nJets", _int32_p),
+        ("jetPt", _double_p), ("jetEta", _double_p), ("jetPhi", _double_p), ("jetE", _double_p),
+        ("jetBTag", _int32_p),
+        ("metPt", _double_p), ("metPhi", _double_p),
+        ("ids", _int64_p),
+    ]
+
+
+class _Results(ctypes.Structure):
+    _fields_ = [
+        ("weight", _double_p), ("error", _double_p), ("time", _double_p),
+        ("status", _int32_p),
+        ("counters", _uint64_p),
+    ]
+
+
+def _load_library(path):
+    if path is None:
+        path = os.environ.get("MEMCPP_LIBRARY", os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "ttbar", "libME_ttbar.so"))
+    lib = ctypes.CDLL(path)
+    lib.memcpp_default_config.argtypes = [ctypes.POINTER(_Config)]
+    lib.memcpp_default_config.restype = None
+    lib.memcpp_create.argtypes = [ctypes.POINTER(_Config)]
+    lib.memcpp_create.restype = ctypes.c_void_p
+    lib.memcpp_destroy.argtypes = [ctypes.c_void_p]
+    lib.memcpp_destroy.restype = None
+    lib.memcpp_compute.argtypes = [ctypes.c_void_p, ctypes.POINTER(_Events), ctypes.POINTER(_Results)]
+    lib.memcpp_compute.restype = ctypes.c_int
+    lib.memcpp_n_counters.argtypes = []
+    lib.memcpp_n_counters.restype = ctypes.c_int
+    lib.memcpp_counter_name.argtypes = [ctypes.c_int]
+    lib.memcpp_counter_name.restype = ctypes.c_char_p
+    return lib
+
+
+def _array(values, dtype, ndim, n, name):
+    # No copy if the array is already contiguous and of the right type
+    array = np.ascontiguousarray(values, dtype=dtype)
+    if array.ndim != ndim or array.shape[0] != n:
+        raise ValueError("%s: expected a %dD array with %d rows, got shape %s" % (name, ndim, n, array.shape))
+    return array
+
+
+class MEMcpp(object):
+    """Weight computation for the ttbar (e+ mu-) process.
+
+    The keyword arguments are the fields of MEMcppConfig (see interface/MEMcpp.h); integrator can be given
+    by name, and tfTypes as names ("binned", "spline", "gaussian:FILE") for the electron, muon and jet TFs.
+    """
+
+    def __init__(self, tfFile, library=None, **options):
+        self._lib = _load_library(library)
+        self._handle = None
+
+        config = _Config()
+        self._lib.memcpp_default_config(ctypes.byref(config))
+        # Keep the encoded strings alive as long as the configuration
+        self._strings = [tfFile.encode()]
+        config.tfFile = self._strings[-1]
+
+        for name, value in options.items():
+            if name == "integrator" and not isinstance(value, int):
+                value = INTEGRATORS[value]
+            if name == "tfTypes":
+                for i, tfType in enumerate(value):
+                    if tfType.startswith("gaussian:"):
+                        self._strings.append(tfType[9:].encode())
+                        config.tfFiles[i] = self._strings[-1]
+                        tfType = "gaussian"
+                    config.tfTypes[i] = TF_TYPES[tfType]
+                continue
+            if isinstance(value, str):
+                self._strings.append(value.encode())
+                value = self._strings[-1]
+            if not hasattr(config, name):
+                raise ValueError("unknown option %s" % name)
+            setattr(config, name, value)
+
+        self._bTagMask = config.bTagMask
+        self._handle = self._lib.memcpp_create(ctypes.byref(config))
+        if not self._handle:
+            raise RuntimeError("invalid MEMcpp configuration")
+
+        self.counterNames = [self._lib.memcpp_counter_name(k).decode() for k in range(self._lib.memcpp_n_counters())]
+
+    def close(self):
+        if self._handle:
+            self._lib.memcpp_destroy(self._handle)
+            self._handle = None
+
+    def __del__(self):
+        self.close()
+
+    def compute(self, positron, muon, jets, nJets, met, jetBTag=None, ids=None, counters=False):
+        """Compute the weights of a batch of events.
+
+        positron, muon: (pt, eta, phi, E) arrays of shape (n,); jets: (pt, eta, phi, E) arrays of shape (n, jetStride);
+        nJets: (n,) number of jets of each event; met: (pt, phi); jetBTag: (n, jetStride) b-tagging words
+        (needed unless bTagMask = 0); ids: (n,) event IDs for the reproducible mode.
+        Returns a dictionary of numpy arrays: weight, error, time, status, and counters (n x stage counters) if requested.
+        """
+        n = len(nJets)
+        keep = []
+
+        def pointer(values, dtype, ndim, name, ctype):
+            array = _array(values, dtype, ndim, n, name)
+            keep.append(array)
+            return array.ctypes.data_as(ctype)
+
+        events = _Events()
+        events.nEvents = n
+        for prefix, vectors in (("positron", positron), ("muon", muon)):
+            for component, values in zip(("Pt", "Eta", "Phi", "E"), vectors):
+                setattr(events, prefix + component, pointer(values, np.float64, 1, prefix + component, _double_p))
+
+        jetArrays = [_array(values, np.float64, 2, n, "jet" + component) for component, values in zip(("Pt", "Eta", "Phi", "E"), jets)]
+        stride = jetArrays[0].shape[1]
+        if any(array.shape != (n, stride) for array in jetArrays):
+            raise ValueError("the jet arrays must have the same shape")
+        keep.extend(jetArrays)
+        events.jetStride = stride
+        events.jetPt, events.jetEta, events.jetPhi, events.jetE = [array.ctypes.data_as(_double_p) for array in jetArrays]
+        events.nJets = pointer(nJets, np.int32, 1, "nJets", _int32_p)
+        if jetBTag is not None:
+            bTag = _array(jetBTag, np.int32, 2, n, "jetBTag")
+            if bTag.shape != (n, stride):
+                raise ValueError("jetBTag must have the shape of the jet arrays")
+            keep.append(bTag)
+            events.jetBTag = bTag.ctypes.data_as(_int32_p)
+        elif self._bTagMask:
+            raise ValueError("jetBTag is needed if bTagMask is not 0")
+        events.metPt = pointer(met[0], np.float64, 1, "metPt", _double_p)
+        events.metPhi = pointer(met[1], np.float64, 1, "metPhi", _double_p)
+        if ids is not None:
+            events.ids = pointer(ids, np.int64, 1, "ids", _int64_p)
+
+        out = {
+            "weight": np.zeros(n), "error": np.zeros(n), "time": np.zeros(n),
+            "status": np.zeros(n, dtype=np.int32),
+        }
+        results = _Results()
+        results.weight = out["weight"].ctypes.data_as(_double_p)
+        results.error = out["error"].ctypes.data_as(_double_p)
+        results.time = out["time"].ctypes.data_as(_double_p)
+        results.status = out["status"].ctypes.data_as(_int32_p)
+        if counters:
+            out["counters"] = np.zeros((n, len(self.counterNames)), dtype=np.uint64)
+            results.counters = out["counters"].ctypes.data_as(_uint64_p)
+
+        if self._lib.memcpp_compute(self._handle, ctypes.byref(events), ctypes.byref(results)) != 0:
+            raise RuntimeError("memcpp_compute failed")
+        return out
@@ -0,0 +1,239 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstring>
+#include <stdlib.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "LHCOReader.h"
+
+using namespace std;
+
+// Skip spaces and tabs, but not end-of-lines
+static inline void skipBlanks(const char* &p, const char* end){
+  while(p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+    ++p;
+}
+
+// Go to the beginning of the next line
+static inline void skipLine(const char* &p, const char* end){
+  const char* eol = static_cast<const char*>( memchr(p, '\n', end - p) );
+  p = eol ? eol + 1 : end;
+}
+
+// Parse a number of the form [+-]digits[.digits][(e|E)[+-]digits] starting at p
+// Returns false (leaving p untouched) if no number is found before the end of the line
+static bool parseNumber(const char* &p, const char* end, double &x){
+  skipBlanks(p, end);
+  const char* q = p;
+  
+  bool negative = false;
+  if(q < end && (*q == '-' || *q == '+')){
+    negative = *q == '-';
+    ++q;
+  }
+
+  double mantissa = 0.;
+  int nDigits = 0;
+  while(q < end && *q >= '0' && *q <= '9'){
+    mantissa = 10.*mantissa + (*q - '0');
+    ++q; ++nDigits;
+  }
+  
+  int exponent = 0;
+  if(q < end && *q == '.'){
+    ++q;
+    while(q < end && *q >= '0' && *q <= '9'){
+      mantissa = 10.*mantissa + (*q - '0');
+      --exponent;
+      ++q; ++nDigits;
+    }
+  }
+
+  if(!nDigits)
+    return false;
+
+  if(q < end && (*q == 'e' || *q == 'E' || *q == 'd' || *q == 'D')){
+    const char* r = q + 1;
+    bool negativeExp = false;
+    if(r < end && (*r == '-' || *r == '+')){
+      negativeExp = *r == '-';
+      ++r;
+    }
+    if(r < end && *r >= '0' && *r <= '9'){
+      int exp = 0;
+      while(r < end && *r >= '0' && *r <= '9'){
+        exp = 10*exp + (*r - '0');
+        ++r;
+      }
+      exponent += negativeExp ? -exp : exp;
+      q = r;
+    }
+  }
+
+  if(exponent < 0)
+    x = mantissa / pow(10., -exponent);
+  else if(exponent > 0)
+    x = mantissa * pow(10., exponent);
+  else
+    x = mantissa;
+  if(negative)
+    x = -x;
+  p = q;
+  
+  return true;
+}
+
+std::vector<const LHCOObject*> LHCOEvent::GetObjects(const int type, const int charge, const bool bTagged) const {
+  std::vector<const LHCOObject*> selected;
+  
+  for(const LHCOObject &object: objects){
+    if(object.type != type)
+      continue;
+    if(charge && object.GetCharge() != charge)
+      continue;
+    if(bTagged && !object.IsBTagged())
+      continue;
+    selected.push_back(&object);
+  }
+
+  return selected;
+}
+
+LHCOReader::LHCOReader(const std::string &file):
+  _fileName(file),
+  _fd(-1),
+  _data(nullptr),
+  _size(0),
+  _pos(nullptr){
+
+  _fd = open(file.c_str(), O_RDONLY);
+  if(_fd < 0){
+    cerr << "Error opening LHCO file " << file << ".\n";
+    exit(1);
+  }
+
+  struct stat fileStat;
+  if(fstat(_fd, &fileStat) < 0){
+    cerr << "Error reading LHCO file " << file << ".\n";
+    exit(1);
+  }
+  _size = fileStat.st_size;
+
+  if(_size){
+    void* map = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+    if(map == MAP_FAILED){
+      cerr << "Error mapping LHCO file " << file << " in memory.\n";
+      exit(1);
+    }
+    madvise(map, _size, MADV_SEQUENTIAL);
+    _data = static_cast<const char*>(map);
+  }
+  _pos = _data;
+
+  IndexEvents();
+  
+  cout << "Opened LHCO file " << file << " with " << GetEntries() << " events." << endl;
+}
+
+LHCOReader::~LHCOReader(){
+  if(_data)
+    munmap( const_cast<char*>(_data), _size );
+  if(_fd >= 0)
+    close(_fd);
+}
+
+void LHCOReader::IndexEvents(){
+  const char* p = _data;
+  const char* end = _data + _size;
+
+  while(p < end){
+    const char* lineStart = p;
+    skipBlanks(p, end);
+    
+    // Event headers are the lines starting with a "0" index
+    if(p < end - 1 && p[0] == '0' && (p[1] == ' ' || p[1] == '\t'))
+      _eventOffsets.push_back(lineStart - _data);
+    
+    skipLine(p, end);
+  }
+}
+
+bool LHCOReader::ReadEntry(const long entry, LHCOEvent &event){
+  if(entry < 0 || entry >= GetEntries())
+    return false;
+
+  _pos = _data + _eventOffsets[entry];
+  return NextEvent(event);
+}
+
+bool LHCOReader::NextEvent(LHCOEvent &event){
+  const char* end = _data + _size;
+  
+  event.objects.clear();
+  bool inEvent = false;
+
+  while(_pos < end){
+    const char* line = _pos;
+    const char* p = _pos;
+    
+    skipBlanks(p, end);
+    
+    // Skip comments and empty lines
+    if(p == end || *p == '#' || *p == '\n'){
+      skipLine(p, end);
+      _pos = p;
+      continue;
+    }
+
+    double index;
+    if(!parseNumber(p, end, index)){
+      cerr << "Error in LHCO file " << _fileName << ": unable to parse line at offset " << line - _data << ".\n";
+      exit(1);
+    }
+
+    if(index == 0.){
+      // Event header: stop here if we have already read an event
+      if(inEvent)
+        return true;
+      
+      double number = 0., trigger = 0.;
+      parseNumber(p, end, number);
+      parseNumber(p, end, trigger);
+      event.number = number;
+      event.trigger = trigger;
+      inEvent = true;
+    
+    }else if(inEvent){
+      double values[9] = { 0. };
+      int nValues = 0;
+      while(nValues < 9 && parseNumber(p, end, values[nValues]))
+        ++nValues;
+      
+      if(nValues < 5){
+        cerr << "Error in LHCO file " << _fileName << ": incomplete object at offset " << line - _data << ".\n";
+        exit(1);
+      }
+
+      LHCOObject object;
+      object.type = values[0];
+      object.eta = values[1];
+      object.phi = values[2];
+      object.pt = values[3];
+      object.jmas = values[4];
+      object.ntrk = values[5];
+      object.btag = values[6];
+      object.hadem = values[7];
+      event.objects.push_back(object);
+    }
+
+    skipLine(p, end);
+    _pos = p;
+  }
+
+  return inEvent;
+}
@@ -1,6 +1,7 @@
 #include "Math/Vector4D.h"
 
 #include "MEEvent.h"
+#include "fourVector.h"
 
 void MEEvent::SetVectors(const ROOT::Math::PtEtaPhiEVector &ep, const ROOT::Math::PtEtaPhiEVector &mum, const ROOT::Math::PtEtaPhiEVector &b, const ROOT::Math::PtEtaPhiEVector &bbar, const ROOT::Math::PtEtaPhiEVector &met){
   _p3 = ep;
@@ -8,4 +9,16 @@ void MEEvent::SetVectors(const ROOT::Math::PtEtaPhiEVector &ep, const ROOT::Math
   _p4 = b;
   _p6 = bbar;
   _Met = met;
+
+  // Conversion to the integrand-side vectors is only done here
+  _vectors[0] = ToFourVector(_p3);
+  _vectors[1] = ToFourVector(_p4);
+  _vectors[2] = ToFourVector(_p5);
+  _vectors[3] = ToFourVector(_p6);
+  _MetVector = ToFourVector(_Met);
+
+  for(int i = 0; i < 4; ++i)
+    _kinematics[i].Compute(_vectors[i]);
+
+  _ISR = -(_vectors[0] + _vectors[1] + _vectors[2] + _vectors[3] + _MetVector);
 }
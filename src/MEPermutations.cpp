@@ -0,0 +1,24 @@
+#include <vector>
+#include <utility>
+
+#include "Math/Vector4D.h"
+
+#include "MEPermutations.h"
+#include "MEEvent.h"
+
+void MEPermutations::SetObjects(const ROOT::Math::PtEtaPhiEVector &ep, const ROOT::Math::PtEtaPhiEVector &mum, const std::vector<ROOT::Math::PtEtaPhiEVector> &jets, const ROOT::Math::PtEtaPhiEVector &met){
+  _events.clear();
+  _assignments.clear();
+
+  for(size_t i = 0; i < jets.size(); ++i){
+    for(size_t j = 0; j < jets.size(); ++j){
+      if(i == j)
+        continue;
+
+      MEEvent event;
+      event.SetVectors(ep, mum, jets[i], jets[j], met);
+      _events.push_back(event);
+      _assignments.push_back( std::make_pair(i, j) );
+    }
+  }
+}
@@ -11,12 +11,16 @@
 
 #include "Math/Vector4D.h"
 #include "TH1D.h"
+#include "TStopwatch.h"
 
 #include "MEWeight.h"
+#include "cppProcessME.h"
 #include "MEEvent.h"
 #include "jacobianD.h"
 #include "transferFunction.h"
 #include "utils.h"
+#include "qmcIntegrator.h"
+#include "quasiRandom.h"
 
 #define VEGAS
 //#define SUAVE
@@ -24,14 +28,56 @@
 using namespace std;
 
 MEWeight::MEWeight(CPPProcess &process, const std::string pdfName, const std::string fileTF):
-  _process(process),
-  _pdf( LHAPDF::mkPDF(pdfName, 0) ),
+  MEWeight(*new CPPProcessME(process, GetFinalState()), pdfName, fileTF){
+  _ownedMatrixElements.push_back(_matrixElements[0]);
+}
+
+MEWeight::MEWeight(MatrixElement &matrixElement, const std::string pdfName, const std::string fileTF):
+  _pdfName(pdfName),
+  _matrixElements(1, &matrixElement),
+  _batches(1, MEBatch(2 + GetFinalState().size())),
+  _counters(1),
   _recEvent( new MEEvent() ),
-  _TF( new TransferFunction(fileTF) ){
+  _TF(nullptr),
+  _tfSampling(true),
+  _cache(nullptr),
+  _pdfTable(nullptr),
+  _pruneThreshold(0.),
+  _preScreenPoints(0),
+  _preScreenMinWeight(0.),
+  _runSeed(0),
+  _eventID(0),
+  _integrator(CUBA_VEGAS),
+  _compareIntegrators(false),
+  _sobolIntegrator(nullptr),
+  _latticeIntegrator(nullptr),
+  _vegasIntegrator(nullptr){
 
   cout << "Initializing Matrix Element computation with:" << endl;
   cout << "PDF " << pdfName << endl;
   cout << "TF file " << fileTF << endl;
+
+  if(TableCache::IsCacheFile(fileTF)){
+    _cache = new TableCache(fileTF);
+    _TF = new TransferFunction(*_cache);
+
+    _pdfTable = new PdfTable();
+    if(_pdfTable->Load(*_cache, pdfName)){
+      // The Q^2 given to tools/compile_cache may be rounded
+      if(fabs(_pdfTable->GetQ2() - GetPdfScale()) > 1e-6*GetPdfScale()){
+        cerr << "Error: the PDF tables of the table cache are computed at Q^2 = " << _pdfTable->GetQ2() << ", but the integrand uses Q^2 = " << GetPdfScale() << "." << endl;
+        exit(1);
+      }
+      cout << "PDF tables at Q^2 = " << _pdfTable->GetQ2() << " taken from the table cache" << endl;
+    }else{
+      delete _pdfTable; _pdfTable = nullptr;
+    }
+  }else{
+    _TF = new TransferFunction(fileTF);
+  }
+
+  // The cached PDF tables are shared by all threads, otherwise each thread has its own LHAPDF instance
+  _pdfs.push_back( _pdfTable ? nullptr : LHAPDF::mkPDF(pdfName, 0) );
 }
 
 MEEvent* MEWeight::GetEvent(){
@@ -42,8 +88,109 @@ void MEWeight::SetEvent(const ROOT::Math::PtEtaPhiEVector &ep, const ROOT::Math:
   _recEvent->SetVectors(ep, mum, b, bbar, met);
 }
 
-void MEWeight::AddTF(const std::string particleName, const std::string histName){
-  _TF->DefineComponent(particleName, histName);
+void MEWeight::AddTF(const std::string particleName, const std::string name, const TFComponent::Type type){
+  _TF->DefineComponent(particleName, name, type);
+}
+
+void MEWeight::SetIntegrator(const IntegratorType type, const bool compare){
+  _integrator = type;
+  _compareIntegrators = compare;
+
+  if( (type == QMC_SOBOL || compare) && !_sobolIntegrator )
+    _sobolIntegrator = new QMCIntegrator(8, QMCIntegrator::SOBOL);
+  if( (type == QMC_LATTICE || compare) && !_latticeIntegrator )
+    _latticeIntegrator = new QMCIntegrator(8, QMCIntegrator::LATTICE);
+  if( (type == NATIVE_VEGAS || compare) && !_vegasIntegrator )
+    _vegasIntegrator = new VegasIntegrator(8, _matrixElements.size());
+}
+
+void MEWeight::AddThreadProcess(CPPProcess &process){
+  _ownedMatrixElements.push_back( new CPPProcessME(process, GetFinalState()) );
+  AddThreadProcess(*_ownedMatrixElements.back());
+}
+
+void MEWeight::AddThreadProcess(MatrixElement &matrixElement){
+  if(_vegasIntegrator){
+    cerr << "Error: the process instances for the integration threads must be added before choosing the integrator." << endl;
+    exit(1);
+  }
+
+  _matrixElements.push_back(&matrixElement);
+  _pdfs.push_back( _pdfTable ? nullptr : LHAPDF::mkPDF(_pdfName, 0) );
+  if(_pdfMembers.size())
+    _pdfMembers.push_back( LHAPDF::PDFSet(_pdfName).mkPDFs() );
+  _batches.push_back( MEBatch(2 + GetFinalState().size()) );
+  _counters.push_back( StageCounters() );
+}
+
+void MEWeight::SetPdfMembers(const bool allMembers){
+  for(auto &members: _pdfMembers){
+    for(auto &pdf: members){
+      delete pdf; pdf = nullptr;
+    }
+  }
+  _pdfMembers.clear();
+  if(!allMembers)
+    return;
+
+  if(_pdfTable){
+    cerr << "Error: the PDF members can't be used with the PDF tables of a table cache (only the central member is cached)." << endl;
+    exit(1);
+  }
+
+  for(size_t thread = 0; thread < _matrixElements.size(); ++thread)
+    _pdfMembers.push_back( LHAPDF::PDFSet(_pdfName).mkPDFs() );
+  cout << "Integrating the " << _pdfMembers[0].size() << " members of PDF set " << _pdfName << endl;
+}
+
+void MEWeight::Integrand(const int nPoints, const int nDim, const double* psPoints, const int nComp, double *values, const int thread){
+  MEBatch &batch = _batches[thread];
+  batch.Clear();
+  fill(values, values + nPoints*nComp, 0.);
+
+  // The kinematics are computed once per event stage, the members are filled in IntegrandMatrixElements
+  const int nStages = nComp/GetNumberOfPdfMembers();
+  for(int point = 0; point < nPoints; ++point){
+    for(int i = 0; i < nStages; ++i)
+      IntegrandKinematics(&psPoints[point*nDim], _stages[i], point*nStages + i, batch, thread);
+  }
+
+  if(batch.Size())
+    IntegrandMatrixElements(batch, values, thread);
+}
+
+StageCounters MEWeight::GetStageCounters() const {
+  StageCounters total;
+  for(const StageCounters &counters: _counters)
+    total += counters;
+  return total;
+}
+
+void MEWeight::ResetStageCounters(){
+  for(StageCounters &counters: _counters)
+    counters.Reset();
+}
+
+bool MEWeight::LoadVegasGrid(const std::string &fileName){
+  if(!_vegasIntegrator){
+    cerr << "Warning: the native Vegas integrator is not used, not loading grid " << fileName << "." << endl;
+    return false;
+  }
+
+  VegasGrid grid(8);
+  if(!grid.Load(fileName))
+    return false;
+  
+  cout << "Using Vegas grid from " << fileName << " as starting grid." << endl;
+  _vegasIntegrator->SetInitialGrid(grid);
+  return true;
+}
+
+bool MEWeight::SaveVegasGrid(const std::string &fileName) const {
+  if(!_vegasIntegrator)
+    return false;
+  
+  return _vegasIntegrator->GetGrid().Save(fileName);
 }
 
 void MEWeight::AddInitialState(int pid1, int pid2){
@@ -74,23 +221,259 @@ double MEWeight::ComputeWeight(double &error){
   
   cout << "Initializing integration..." << endl;
 
+  SetComponents( vector<const MEEvent*>(1, _recEvent), vector<size_t>(1, 0) );
+  
+  vector<double> weights, errors;
+  IntegrateComponents(weights, errors);
+
+  // Central PDF member (see GetMemberWeights for the others)
+  error = errors[0];
+  return weights[0];
+}
+
+bool MEWeight::ComputeWeights(const MEPermutations &permutations, std::vector<double> &weights, std::vector<double> &errors){
+
+  cout << "Initializing integration of " << permutations.GetNumberOfPermutations() << " permutations..." << endl;
+
+  vector<const MEEvent*> components;
+  vector<size_t> indices;
+  for(size_t i = 0; i < permutations.GetNumberOfPermutations(); ++i){
+    components.push_back( &permutations.GetPermutation(i) );
+    indices.push_back(i);
+  }
+  SetComponents(components, indices);
+
+  return IntegrateComponents(weights, errors);
+}
+
+void MEWeight::SetComponents(const std::vector<const MEEvent*> &components, const std::vector<size_t> &indices){
+  _components = components;
+  _componentIndices = indices;
+  
+  _stages.resize(_components.size());
+  for(size_t i = 0; i < _components.size(); ++i)
+    PrepareEvent(*_components[i], _stages[i]);
+}
+
+uint64_t MEWeight::GetIntegrationSeed(const int pass) const {
+  if(!_runSeed)
+    return 0;
+
+  uint64_t seed = mixSeed(_runSeed ^ mixSeed(static_cast<uint64_t>(_eventID)));
+  for(const size_t index: _componentIndices)
+    seed = mixSeed(seed ^ mixSeed(index + 1));
+  seed = mixSeed(seed ^ mixSeed(1000 + pass));
+  
+  // 0 means "not reproducible"
+  return seed ? seed : 1;
+}
+
+bool MEWeight::IntegrateComponents(std::vector<double> &weights, std::vector<double> &errors){
+
+  const double relAccuracy = 0.005;
+  // Budget of the full integration (evaluations, and evaluations of the first iteration), lowered from the quick
+  // estimate with the pre-screening, but not below minMaxEval
+  int maxEval = 360000, nStart = 20000;
+  const int minMaxEval = 40000;
+  
+  const vector<const MEEvent*> allComponents = _components;
+  const vector<size_t> allIndices = _componentIndices;
+  const size_t nComp = allComponents.size();
+  const size_t nMembers = GetNumberOfPdfMembers();
+  
+  weights.assign(nComp, 0.);
+  errors.assign(nComp, 0.);
+  _memberWeights.assign(nComp*nMembers, 0.);
+  _memberErrors.assign(nComp*nMembers, 0.);
+  
+  if(!nComp)
+    return false;
+
+  // One integral per component and PDF member: [component*nMembers + member]
+  vector<double> mcResults(nComp*nMembers, 0.), mcErrors(nComp*nMembers, 0.), probs(nComp*nMembers, 0.);
+  
+  // Indices of the components which are to be integrated fully
+  vector<size_t> selected;
+  double absAccuracy = 0.;
+
+  if(_preScreenPoints > 0 || (_pruneThreshold > 0. && nComp > 1)){
+    // A single iteration with a small number of (Sobol) points
+    const int nPoints = _preScreenPoints > 0 ? _preScreenPoints : 10000;
+    
+    cout << "Computing quick estimate using " << nPoints << " points..." << endl;
+    
+    Integrate(nPoints, nPoints, 0, relAccuracy, 0., GetIntegrationSeed(0), mcResults.data(), mcErrors.data(), probs.data());
+    
+    double maxEstimate = 0., sumEstimate = 0.;
+    for(size_t i = 0; i < nComp*nMembers; ++i){
+      if(std::isnan(mcResults[i]))
+        mcResults[i] = 0.;
+      if(std::isnan(mcErrors[i]))
+        mcErrors[i] = 0.;
+    }
+    // Estimates of the central member
+    for(size_t i = 0; i < nComp; ++i){
+      maxEstimate = max(maxEstimate, mcResults[i*nMembers]);
+      sumEstimate += mcResults[i*nMembers];
+    }
+
+    if(_preScreenPoints > 0){
+      if(sumEstimate <= _preScreenMinWeight){
+        cout << "Pre-screening: estimated weight = " << sumEstimate << " is below threshold " << _preScreenMinWeight << ", skipping integration." << endl << endl;
+        for(size_t i = 0; i < nComp; ++i){
+          weights[i] = mcResults[i*nMembers];
+          errors[i] = mcErrors[i*nMembers];
+        }
+        _memberWeights = mcResults;
+        _memberErrors = mcErrors;
+        return false;
+      }
+      
+      // The precision is defined with respect to the estimated total weight, 
+      // so that components with a small contribution do not drive the number of evaluations
+      absAccuracy = relAccuracy * sumEstimate;
+
+      // Without adaptation, component i needs nPoints*(error/target)^2 points to reach its target: twice that for
+      // the worst component, as the error of a quick estimate is itself uncertain (the grid adaptation only helps)
+      double needed = 0.;
+      for(size_t i = 0; i < nComp; ++i){
+        const double target = max(relAccuracy*fabs(mcResults[i*nMembers]), absAccuracy);
+        if(target > 0.)
+          needed = max(needed, nPoints*SQ(mcErrors[i*nMembers]/target));
+      }
+      maxEval = static_cast<int>(min<double>(maxEval, max<double>(minMaxEval, 2.*needed)));
+      // At least 4 iterations
+      nStart = min(nStart, maxEval/4);
+      cout << "Pre-screening: budget of the full integration " << maxEval << " evaluations, " << nStart << " in the first iteration" << endl;
+    }
+
+    for(size_t i = 0; i < nComp; ++i){
+      if(mcResults[i*nMembers] > _pruneThreshold * maxEstimate){
+        selected.push_back(i);
+      }else{
+        cout << "Pruning component " << i << ": estimate = " << mcResults[i*nMembers] << " +- " << mcErrors[i*nMembers] << endl;
+        weights[i] = mcResults[i*nMembers];
+        errors[i] = mcErrors[i*nMembers];
+        copy(&mcResults[i*nMembers], &mcResults[(i + 1)*nMembers], &_memberWeights[i*nMembers]);
+        copy(&mcErrors[i*nMembers], &mcErrors[(i + 1)*nMembers], &_memberErrors[i*nMembers]);
+      }
+    }
+  }else{
+    for(size_t i = 0; i < nComp; ++i)
+      selected.push_back(i);
+  }
+
+  if(!selected.size())
+    return true;
+  
+  vector<const MEEvent*> selectedComponents;
+  vector<size_t> selectedIndices;
+  for(const size_t i: selected){
+    selectedComponents.push_back( allComponents[i] );
+    selectedIndices.push_back( allIndices[i] );
+  }
+  SetComponents(selectedComponents, selectedIndices);
+  
+  Integrate(maxEval, nStart, 3, relAccuracy, absAccuracy, GetIntegrationSeed(1), mcResults.data(), mcErrors.data(), probs.data());
+
+  for(size_t j = 0; j < selected.size(); ++j){
+    for(size_t member = 0; member < nMembers; ++member){
+      _memberWeights[selected[j]*nMembers + member] = std::isnan(mcResults[j*nMembers + member]) ? 0. : mcResults[j*nMembers + member];
+      _memberErrors[selected[j]*nMembers + member] = std::isnan(mcErrors[j*nMembers + member]) ? 0. : mcErrors[j*nMembers + member];
+    }
+    weights[selected[j]] = _memberWeights[selected[j]*nMembers];
+    errors[selected[j]] = _memberErrors[selected[j]*nMembers];
+  }
+
+  return true;
+}
+
+int MEWeight::Integrate(const int maxEval, const int nStart, const char verbosity, const double relAccuracy, const double absAccuracy, const uint64_t seed, double *mcResult, double *error, double *prob){
+
+  const int nComp = _components.size()*GetNumberOfPdfMembers();
+  // Only the central member is printed
+  const int step = GetNumberOfPdfMembers();
+
+  cout << "Starting integration..." << endl << endl;
+
+  int neval = 0;
+  
+  if(_compareIntegrators){
+    const IntegratorType types[4] = { CUBA_VEGAS, QMC_SOBOL, QMC_LATTICE, NATIVE_VEGAS };
+    const string names[4] = { "CUBA Vegas", "QMC Sobol", "QMC lattice", "Native Vegas" };
+    vector<double> tempResult(nComp), tempError(nComp), tempProb(nComp);
+    
+    for(int t = 0; t < 4; ++t){
+      TStopwatch chrono;
+      chrono.Start();
+      const int tempNeval = RunIntegrator(types[t], maxEval, nStart, verbosity, relAccuracy, absAccuracy, seed, tempResult.data(), tempError.data(), tempProb.data());
+      chrono.Stop();
+      
+      for(int i = 0; i < nComp; i += step)
+        cout << "Integrator comparison: " << names[t] << ": mcResult[" << i << "]= " << tempResult[i] << " +- " << tempError[i] << " in " << tempNeval << " evaluations, CPU time " << chrono.CpuTime() << " s. Chi-square prob. = " << tempProb[i] << endl;
+
+      if(types[t] == _integrator){
+        copy(tempResult.begin(), tempResult.end(), mcResult);
+        copy(tempError.begin(), tempError.end(), error);
+        copy(tempProb.begin(), tempProb.end(), prob);
+        neval = tempNeval;
+      }
+    }
+  }else{
+    neval = RunIntegrator(_integrator, maxEval, nStart, verbosity, relAccuracy, absAccuracy, seed, mcResult, error, prob);
+  }
+  
+  cout << "Integration done." << endl;
+
+  for(int i = 0; i < nComp; i += step)
+    cout << " mcResult[" << i << "]= " << mcResult[i] << " +- " << error[i] << " in " << neval << " evaluations. Chi-square prob. = " << prob[i] << endl;
+  cout << endl;
+
+  return neval;
+}
+
+int MEWeight::RunIntegrator(const IntegratorType type, const int maxEval, const int nStart, const char verbosity, const double relAccuracy, const double absAccuracy, const uint64_t seed, double *mcResult, double *error, double *prob){
+
+  // One component per event/permutation and PDF member
+  const int nComp = _components.size()*GetNumberOfPdfMembers();
+
+  if(type == QMC_SOBOL){
+    if(seed)
+      _sobolIntegrator->SetSeed(seed);
+    return _sobolIntegrator->Integrate(CUBAIntegrand, (void*) this, nComp, maxEval, nStart, relAccuracy, absAccuracy, mcResult, error, prob);
+  }
+  if(type == QMC_LATTICE){
+    if(seed)
+      _latticeIntegrator->SetSeed(seed);
+    return _latticeIntegrator->Integrate(CUBAIntegrand, (void*) this, nComp, maxEval, nStart, relAccuracy, absAccuracy, mcResult, error, prob);
+  }
+  if(type == NATIVE_VEGAS){
+    if(seed)
+      _vegasIntegrator->SetSeed(seed);
+    return _vegasIntegrator->Integrate(CUBAIntegrand, (void*) this, nComp, maxEval, nStart, relAccuracy, absAccuracy, mcResult, error, prob);
+  }
+
+  // CUBA's Vegas refines its grid on the first component only: with several components, a leading component with the
+  // sum of |f| over all of them is added (as the native Vegas refines on), and dropped from the results
+  const bool summed = nComp > 1;
+  const int cubaComp = summed ? nComp + 1 : nComp;
+  vector<double> cubaResult(cubaComp), cubaError(cubaComp), cubaProb(cubaComp);
+
   int neval, nfail;
 #ifdef SUAVE 
   int nsubregions;
 #endif
-  double mcResult=0, prob=0;
   
-  char verbosity = 3; // 0-3
   bool subregion = false; // true = only last set of samples is used for final evaluation of integral
   bool smoothing = false;
   bool retainStateFile = false; // false => delete state file when integration ends
   bool takeOnlyGridFromFile = true; // false => full state taken from file (if present), true => only grid is taken (e.g. to use it for another integrand)
   unsigned int level = 0; 
+  // Reproducible mode: Mersenne Twister with the derived seed (CUBA only takes an int)
+  const int cubaSeed = seed ? static_cast<int>(seed & 0x7fffffff) | 1 : 0;
 
   unsigned int flags = setFlags(verbosity, subregion, retainStateFile, level, smoothing, takeOnlyGridFromFile);
 
-  cout << "Starting integration..." << endl << endl;
-
   cubacores(0, 0);           // This is mandatory if the integrand wants to *modify* something in the MEWeight object passed as argument
 #ifdef VEGAS
   Vegas
@@ -100,18 +483,18 @@ double MEWeight::ComputeWeight(double &error){
 #endif
   (
     8,                      // (int) dimensions of the integrated volume
-    1,                      // (int) dimensions of the integrand
-    (integrand_t) CUBAIntegrand,  // (integrand_t) integrand (cast to integrand_t)
+    cubaComp,               // (int) dimensions of the integrand (one component per event/permutation and PDF member, and their sum)
+    (integrand_t) (summed ? CUBASummedIntegrand : CUBAIntegrand),  // (integrand_t) integrand (cast to integrand_t)
     (void*) this,           // (void*) pointer to additional arguments passed to integrand
-    1,                      // (int) maximum number of points given the integrand in each invocation (=> SIMD) ==> PS points = vector of sets of points (x[ndim][nvec]), integrand returns vector of vector values (f[ncomp][nvec])
-    0.005,                  // (double) requested relative accuracy  /
-    0.,                     // (double) requested absolute accuracy /-> error < max(rel*value,abs)
+    cubaBatchPoints,        // (int) maximum number of points given the integrand in each invocation (=> SIMD) ==> PS points = vector of sets of points (x[nvec][ndim]), integrand returns vector of vector values (f[nvec][ncomp])
+    relAccuracy,            // (double) requested relative accuracy  /
+    absAccuracy,            // (double) requested absolute accuracy /-> error < max(rel*value,abs)
     flags,                  // (int) various control flags in binary format, see setFlags function
-    0,                      // (int) seed (seed==0 => SOBOL; seed!=0 && control flag "level"==0 => Mersenne Twister)
+    cubaSeed,               // (int) seed (seed==0 => SOBOL; seed!=0 && control flag "level"==0 => Mersenne Twister)
     0,                      // (int) minimum number of integrand evaluations
-    360000,                 // (int) maximum number of integrand evaluations (approx.!)
+    maxEval,                // (int) maximum number of integrand evaluations (approx.!)
 #ifdef VEGAS
-    20000,                  // (int) number of integrand evaluations per interations (to start)
+    nStart,                 // (int) number of integrand evaluations per interations (to start)
     0,                      // (int) increase in number of integrand evaluations per interations
     10000,                   // (int) batch size for sampling
     0,                      // (int) grid number, 1-10 => up to 10 grids can be stored, and re-used for other integrands (provided they are not too different)
@@ -128,38 +511,69 @@ double MEWeight::ComputeWeight(double &error){
 #endif
     &neval,                 // (int*) actual number of evaluations done
     &nfail,                 // 0=desired accuracy was reached; -1=dimensions out of range; >0=accuracy was not reached
-    &mcResult,              // (double*) integration result ([ncomp])
-    &error,                 // (double*) integration error ([ncomp])
-    &prob                   // (double*) Chi-square p-value that error is not reliable (ie should be <0.95) ([ncomp])
+    cubaResult.data(),      // (double*) integration result ([ncomp])
+    cubaError.data(),       // (double*) integration error ([ncomp])
+    cubaProb.data()         // (double*) Chi-square p-value that error is not reliable (ie should be <0.95) ([ncomp])
   );
-  
-  cout << "Integration done." << endl;
 
-  cout << " mcResult= " << mcResult << " +- " << error << " in " << neval << " evaluations. Chi-square prob. = " << prob << endl << endl;
+  const int first = summed ? 1 : 0;
+  copy(cubaResult.begin() + first, cubaResult.end(), mcResult);
+  copy(cubaError.begin() + first, cubaError.end(), error);
+  copy(cubaProb.begin() + first, cubaProb.end(), prob);
 
-  if(std::isnan(error))
-  error = 0.;
-  if(std::isnan(mcResult))
-  mcResult = 0.;
-  return mcResult;
+  return neval;
 }
 
 MEWeight::~MEWeight(){
+  for(auto &matrixElement: _ownedMatrixElements){
+    delete matrixElement; matrixElement = nullptr;
+  }
   cout << "Deleting PDF" << endl;
-  delete _pdf; _pdf = nullptr;
+  for(auto &pdf: _pdfs){
+    delete pdf; pdf = nullptr;
+  }
+  SetPdfMembers(false);
   cout << "Deleting myEvent" << endl;
   delete _recEvent; _recEvent = nullptr;
   cout << "Deleting myTF" << endl;
   delete _TF; _TF = nullptr;
+  delete _pdfTable; _pdfTable = nullptr;
+  delete _cache; _cache = nullptr;
+  delete _sobolIntegrator; _sobolIntegrator = nullptr;
+  delete _latticeIntegrator; _latticeIntegrator = nullptr;
+  delete _vegasIntegrator; _vegasIntegrator = nullptr;
 }
 
-// Wrapper function passed to CUBA, simply calls MEWeight::Integrand (where the MEWeight instance is passed as "input" to the wrapper), passing the PS point and the weight
+// Wrapper function passed to CUBA, simply calls MEWeight::Integrand (where the MEWeight instance is passed as "input" to the wrapper), passing the nVec PS points
 int CUBAIntegrand(const int *nDim, const double* psPoint, const int *nComp, double *value, void *inputs, const int *nVec, const int *core, const double *weight){
   //cout << endl << endl << endl << "########## Starting phase-space point ############" << endl << endl;
 
   //cout << "Inputs = [" << Xarg[0] << "," << Xarg[1] << "," << Xarg[2] << "," << Xarg[3] << "," << Xarg[4] << "," << Xarg[5] << "," << Xarg[6] << "," << Xarg[7] << "]" << endl;
   
-  *value = static_cast<MEWeight*>(inputs)->Integrand(psPoint, weight);
+  MEWeight* myWeight = static_cast<MEWeight*>(inputs);
+
+  // The built-in integrators pass the thread index as core (CUBA only calls it from the main process here)
+  const int thread = (*core >= 0 && *core < myWeight->GetNumberOfThreads()) ? *core : 0;
+
+  myWeight->Integrand(*nVec, *nDim, psPoint, *nComp, value, thread);
+
+  return 0;
+}
+
+int CUBASummedIntegrand(const int *nDim, const double* psPoint, const int *nComp, double *value, void *inputs, const int *nVec, const int *core, const double *weight){
+  const int nEventComp = *nComp - 1;
+  vector<double> eventValues(*nVec * nEventComp);
+  CUBAIntegrand(nDim, psPoint, &nEventComp, eventValues.data(), inputs, nVec, core, weight);
+
+  for(int point = 0; point < *nVec; ++point){
+    const double *f = &eventValues[point*nEventComp];
+    double *v = &value[point*(*nComp)];
+    v[0] = 0.;
+    for(int c = 0; c < nEventComp; ++c){
+      v[0] += fabs(f[c]);
+      v[c + 1] = f[c];
+    }
+  }
 
   return 0;
 }
@@ -1,7 +1,10 @@
 #include <string>
 #include <iostream>
+#include <vector>
+#include <algorithm>
 
 #include "binnedTF.h"
+#include "tableCache.h"
 #include "utils.h"
 
 #include "TH2.h"
@@ -9,24 +12,63 @@
 
 BinnedTF::BinnedTF(const std::string particleName, const std::string histName, TFile* file) : _particleName(particleName) {
 
-  _TF = dynamic_cast<TH2D*>( file->Get(histName.c_str()) );
-  if(!_TF){
+  TableView table;
+  if(!ReadHistogram(file, histName, _ownValues, table)){
     std::cerr << "Error when defining binned TF for particle " << particleName << ": unable to retrieve " << histName << " from file " << file->GetPath() << ".\n";
     exit(1);
   }
 
   std::cout << "Creating TF component for " << particleName << " from histogram " << histName << ".\n";
 
-  _deltaMin = _TF->GetYaxis()->GetXmin();
-  _deltaMax = _TF->GetYaxis()->GetXmax();
+  SetTable(table);
+}
+
+BinnedTF::BinnedTF(const std::string particleName, const TableView &table) : _particleName(particleName) {
+  std::cout << "Creating TF component for " << particleName << " from table cache.\n";
+
+  SetTable(table);
+}
+
+void BinnedTF::SetTable(const TableView &table){
+  _EgenMin = table.xMin;
+  _EgenMax = table.xMax;
+  _deltaMin = table.yMin;
+  _deltaMax = table.yMax;
   _deltaRange = _deltaMax - _deltaMin; 
-  _EgenMax = _TF->GetXaxis()->GetXmax();
-  _EgenMin = _TF->GetXaxis()->GetXmin();
- 
+  _nEgen = table.nx;
+  _nDelta = table.ny;
+  _values = table.values;
+
+  _cdfs = DeltaSampler::ComputeCDFs(_values, _nEgen, _nDelta, _deltaRange/_nDelta);
+
   std::cout << "Delta range is " << _deltaRange << ", min. and max. values are " << _EgenMin << ", " <<_EgenMax << std::endl << std::endl;
 }
 
-BinnedTF::~BinnedTF(){
-  delete _TF; _TF = nullptr;
+bool BinnedTF::ReadHistogram(TFile* file, const std::string &histName, std::vector<double> &values, TableView &table){
+  TH2D* hist = dynamic_cast<TH2D*>( file->Get(histName.c_str()) );
+  if(!hist)
+    return false;
+
+  table.nx = hist->GetXaxis()->GetNbins();
+  table.ny = hist->GetYaxis()->GetNbins();
+  table.xMin = hist->GetXaxis()->GetXmin();
+  table.xMax = hist->GetXaxis()->GetXmax();
+  table.yMin = hist->GetYaxis()->GetXmin();
+  table.yMax = hist->GetYaxis()->GetXmax();
+
+  values.resize(table.nx*table.ny);
+  for(int i = 0; i < table.nx; ++i){
+    for(int j = 0; j < table.ny; ++j)
+      values[i*table.ny + j] = hist->GetBinContent(i+1, j+1);
+  }
+  table.values = values.data();
+
+  delete hist; hist = nullptr;
+
+  return true;
 }
 
+void BinnedTF::FillSampler(const double &Erec, DeltaSampler &sampler) const {
+  const int slice = std::min(std::max(static_cast<int>((Erec - _EgenMin)/(_EgenMax - _EgenMin)*_nEgen), 0), _nEgen - 1);
+  sampler.SetFromCDF(&_cdfs[slice*(_nDelta+1)], _nDelta, _deltaMin, _deltaRange/_nDelta, GetDeltaMin(Erec), GetDeltaMax(Erec));
+}
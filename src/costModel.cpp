@@ -0,0 +1,213 @@
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <algorithm>
+
+#include "TFile.h"
+#include "TTree.h"
+
+#include "costModel.h"
+#include "workQueue.h"
+
+using namespace std;
+
+CostModel::CostModel():
+  _coefficients(nFeatures, 0.),
+  _resolution(0.){
+}
+
+std::vector<double> CostModel::GetFeatures(const MEPermutations &permutations){
+  const MEEvent &event = permutations.GetPermutation(0);
+  const FourVector visibles = event.GetVector(3) + event.GetVector(4) + event.GetVector(5) + event.GetVector(6);
+  const double visibleMass2 = visibles.e*visibles.e - visibles.px*visibles.px - visibles.py*visibles.py - visibles.pz*visibles.pz;
+  const FourVector &ISR = event.GetISR();
+
+  return {
+    1.,
+    log(permutations.GetNumberOfPermutations()),
+    log(event.GetP3().E() + event.GetP5().E()),
+    log(event.GetP4().E() + event.GetP6().E()),
+    log(1. + event.GetMet().Pt()),
+    log(1. + sqrt(ISR.px*ISR.px + ISR.py*ISR.py)),
+    log(1. + sqrt(max(visibleMass2, 0.)))
+  };
+}
+
+void CostModel::AddSample(const std::vector<double> &features, const double time){
+  if(time <= 0.)
+    return;
+  _samples.push_back(features);
+  _logTimes.push_back(log(time));
+}
+
+bool CostModel::Fit(const double ridge){
+  const size_t n = _samples.size();
+  if(n < 2*nFeatures){
+    cerr << "Error: not enough events (" << n << ") to fit the cost model." << endl;
+    return false;
+  }
+
+  // Normal equations (X^T X + ridge*n*I) c = X^T y, solved by Gaussian elimination with partial pivoting
+  vector< vector<double> > a(nFeatures, vector<double>(nFeatures + 1, 0.));
+  for(size_t k = 0; k < n; ++k){
+    for(int i = 0; i < nFeatures; ++i){
+      for(int j = 0; j < nFeatures; ++j)
+        a[i][j] += _samples[k][i]*_samples[k][j];
+      a[i][nFeatures] += _samples[k][i]*_logTimes[k];
+    }
+  }
+  // The constant term is not regularised
+  for(int i = 1; i < nFeatures; ++i)
+    a[i][i] += ridge*n;
+
+  for(int col = 0; col < nFeatures; ++col){
+    int pivot = col;
+    for(int row = col + 1; row < nFeatures; ++row){
+      if(fabs(a[row][col]) > fabs(a[pivot][col]))
+        pivot = row;
+    }
+    if(a[pivot][col] == 0.){
+      cerr << "Error: the cost model features are degenerate." << endl;
+      return false;
+    }
+    swap(a[col], a[pivot]);
+    for(int row = 0; row < nFeatures; ++row){
+      if(row == col)
+        continue;
+      const double factor = a[row][col]/a[col][col];
+      for(int j = col; j <= nFeatures; ++j)
+        a[row][j] -= factor*a[col][j];
+    }
+  }
+  for(int i = 0; i < nFeatures; ++i)
+    _coefficients[i] = a[i][nFeatures]/a[i][i];
+
+  double sum2 = 0.;
+  for(size_t k = 0; k < n; ++k){
+    double prediction = 0.;
+    for(int i = 0; i < nFeatures; ++i)
+      prediction += _coefficients[i]*_samples[k][i];
+    sum2 += (_logTimes[k] - prediction)*(_logTimes[k] - prediction);
+  }
+  _resolution = sqrt(sum2/n);
+
+  return true;
+}
+
+double CostModel::Predict(const std::vector<double> &features) const {
+  double logTime = 0.;
+  for(int i = 0; i < nFeatures; ++i)
+    logTime += _coefficients[i]*features[i];
+  return exp(logTime);
+}
+
+bool CostModel::Save(const std::string &fileName) const {
+  ofstream file(fileName);
+  file.precision(17);
+  file << "# MEMcpp cost model: log(time) = sum of coefficient*feature" << endl;
+  file << "features " << nFeatures << endl;
+  file << "coefficients";
+  for(const double coefficient: _coefficients)
+    file << " " << coefficient;
+  file << endl;
+  file << "resolution " << _resolution << endl;
+  
+  if(!file){
+    cerr << "Error writing cost model " << fileName << "." << endl;
+    return false;
+  }
+  return true;
+}
+
+bool CostModel::Load(const std::string &fileName){
+  ifstream file(fileName);
+  if(!file){
+    cerr << "Error opening cost model " << fileName << "." << endl;
+    return false;
+  }
+
+  int n = 0;
+  string line, key;
+  bool hasCoefficients = false;
+  while(getline(file, line)){
+    istringstream stream(line);
+    if(!(stream >> key) || key[0] == '#')
+      continue;
+    if(key == "features"){
+      stream >> n;
+    }else if(key == "coefficients"){
+      for(double &coefficient: _coefficients)
+        stream >> coefficient;
+      hasCoefficients = !stream.fail();
+    }else if(key == "resolution"){
+      stream >> _resolution;
+    }
+  }
+
+  if(n != nFeatures || !hasCoefficients){
+    cerr << "Error: " << fileName << " is not a cost model with " << nFeatures << " features." << endl;
+    return false;
+  }
+  return true;
+}
+
+bool ReadRecordedTimes(const std::string &fileName, std::map<long, double> &times){
+  if(fileName.size() > 5 && fileName.compare(fileName.size() - 5, 5, ".root") == 0){
+    TFile file(fileName.c_str());
+    TTree* tree = file.IsZombie() ? nullptr : dynamic_cast<TTree*>(file.Get("Delphes"));
+    if(!tree || !tree->GetBranch("Entry") || !tree->GetBranch("Weight_TT_cpp_me")){
+      cerr << "Error: " << fileName << " does not contain the Entry and Weight_TT_cpp_me branches." << endl;
+      return false;
+    }
+    long entry;
+    double time;
+    tree->SetBranchStatus("*", 0);
+    tree->SetBranchStatus("Entry", 1);
+    tree->SetBranchStatus("Weight_TT_cpp_me", 1);
+    tree->SetBranchAddress("Entry", &entry);
+    tree->SetBranchAddress("Weight_TT_cpp_me", &time);
+    for(long i = 0; i < tree->GetEntries(); ++i){
+      tree->GetEntry(i);
+      times[entry] = time;
+    }
+    return true;
+  }
+
+  ifstream file(fileName);
+  if(!file){
+    cerr << "Error opening " << fileName << "." << endl;
+    return false;
+  }
+  // Lines "entry weight error time status" (the status is missing in older files); failed events have no time
+  string line;
+  while(getline(file, line)){
+    istringstream stream(line);
+    long entry;
+    double weight, error, time;
+    string statusName;
+    QueueStatus status;
+    if(!(stream >> entry >> weight >> error >> time))
+      continue;
+    if(stream >> statusName && ParseQueueStatus(statusName, status) && status == QUEUE_FAILED)
+      continue;
+    times[entry] = time;
+  }
+  return true;
+}
+
+bool ReadPredictedCosts(const std::string &fileName, std::map<long, double> &costs){
+  ifstream file(fileName);
+  if(!file){
+    cerr << "Error opening predicted costs " << fileName << "." << endl;
+    return false;
+  }
+  long entry;
+  double cost;
+  while(file >> entry >> cost)
+    costs[entry] = cost;
+  return true;
+}
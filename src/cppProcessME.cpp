@@ -0,0 +1,57 @@
+#include <vector>
+#include <map>
+#include <utility>
+#include <algorithm>
+#define _USE_MATH_DEFINES // include M_PI constant
+#include <cmath>
+
+#include "cppProcessME.h"
+
+using namespace std;
+
+CPPProcessME::CPPProcessME(CPPProcess &process, const std::vector<int> &finalPIDs):
+  _process(process),
+  _initialMomenta(2, vector<double>(4)){
+
+  for(const int pid: finalPIDs)
+    _finalState.push_back( make_pair(pid, vector<double>(4)) );
+
+  // The initial states are found by evaluating a dummy point: partons along z and final-state particles
+  // balanced in the transverse plane
+  const size_t nParticles = 2 + finalPIDs.size();
+  vector<double> momenta(4*nParticles, 0.);
+  momenta[0] = momenta[3] = 500.;
+  momenta[4] = 500.; momenta[7] = -500.;
+  for(size_t i = 0; i < finalPIDs.size(); ++i){
+    const double energy = 1000./finalPIDs.size();
+    const double phi = 2.*M_PI*i/finalPIDs.size();
+    double *p = &momenta[4*(i + 2)];
+    p[0] = energy; p[1] = energy*cos(phi); p[2] = energy*sin(phi);
+  }
+
+  for(int i = 0; i < 2; ++i)
+    copy(&momenta[4*i], &momenta[4*i + 4], _initialMomenta[i].begin());
+  for(size_t i = 0; i < _finalState.size(); ++i)
+    copy(&momenta[4*(i + 2)], &momenta[4*(i + 2) + 4], _finalState[i].second.begin());
+  for(auto const &me: _process.sigmaKin(_initialMomenta, _finalState))
+    _initialStates.push_back(me.first);
+}
+
+void CPPProcessME::Evaluate(const int nPoints, const double *momenta, double *values){
+  const size_t nStates = _initialStates.size();
+  const size_t nParticles = 2 + _finalState.size();
+
+  for(int point = 0; point < nPoints; ++point){
+    const double *p = &momenta[4*nParticles*point];
+    for(int i = 0; i < 2; ++i)
+      copy(&p[4*i], &p[4*i + 4], _initialMomenta[i].begin());
+    for(size_t i = 0; i < _finalState.size(); ++i)
+      copy(&p[4*(i + 2)], &p[4*(i + 2) + 4], _finalState[i].second.begin());
+
+    map< pair<int, int>, double > matrixElements = _process.sigmaKin(_initialMomenta, _finalState);
+    for(size_t s = 0; s < nStates; ++s){
+      auto me = matrixElements.find(_initialStates[s]);
+      values[point*nStates + s] = me != matrixElements.end() ? me->second : 0.;
+    }
+  }
+}
@@ -0,0 +1,84 @@
+#include <string>
+#include <iostream>
+#include <stdlib.h>
+
+#include "cpuDispatch.h"
+
+using namespace std;
+
+static const char* isaNames[N_ISA_LEVELS] = { "generic", "sse4", "avx2", "avx512" };
+
+// Kernels of the compiled variants. Filled during the static initialisation, so only accessed through this function.
+static ISAKernels* getRegistry(){
+  static ISAKernels registry[N_ISA_LEVELS] = {};
+  return registry;
+}
+
+static bool isRegistered(const ISALevel level){
+  return getRegistry()[level].computeTransformD != nullptr;
+}
+
+bool RegisterISAKernels(const ISALevel level, const ISAKernels &kernels){
+  getRegistry()[level] = kernels;
+  return true;
+}
+
+ISALevel DetectISALevel(){
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512bw"))
+    return ISA_AVX512;
+  if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return ISA_AVX2;
+  if(__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt"))
+    return ISA_SSE4;
+#endif
+  return ISA_GENERIC;
+}
+
+const char* GetISAName(const ISALevel level){
+  return isaNames[level];
+}
+
+bool ParseISALevel(const std::string &name, ISALevel &level){
+  for(int i = 0; i < N_ISA_LEVELS; ++i){
+    if(name == isaNames[i]){
+      level = static_cast<ISALevel>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Highest level both compiled and supported
+static ISALevel getDefaultLevel(){
+  int level = DetectISALevel();
+  while(level > ISA_GENERIC && !isRegistered(static_cast<ISALevel>(level)))
+    --level;
+  return static_cast<ISALevel>(level);
+}
+
+static ISALevel& getSelectedLevel(){
+  static ISALevel level = getDefaultLevel();
+  return level;
+}
+
+void SelectISALevel(const ISALevel level){
+  if(!isRegistered(level)){
+    cerr << "Error: the " << GetISAName(level) << " kernels are not compiled in this build." << endl;
+    exit(1);
+  }
+  if(level > DetectISALevel()){
+    cerr << "Error: the " << GetISAName(level) << " kernels are not supported by this CPU (best level: " << GetISAName(DetectISALevel()) << ")." << endl;
+    exit(1);
+  }
+  getSelectedLevel() = level;
+}
+
+ISALevel GetISALevel(){
+  return getSelectedLevel();
+}
+
+const ISAKernels& GetISAKernels(){
+  return getRegistry()[getSelectedLevel()];
+}
@@ -0,0 +1,80 @@
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <stdlib.h>
+
+#include "doubleGaussianTF.h"
+
+using namespace std;
+
+DoubleGaussianTF::DoubleGaussianTF(const std::string particleName, const std::string paramFile):
+  _particleName(particleName),
+  _nSigma(5.){
+
+  ifstream file(paramFile);
+  if(!file.is_open()){
+    cerr << "Error when defining double-Gaussian TF for particle " << particleName << ": unable to open " << paramFile << ".\n";
+    exit(1);
+  }
+
+  const string names[N_PARAMETERS] = { "mean1", "sigma1", "mean2", "sigma2", "amplitude" };
+  bool defined[N_PARAMETERS] = { false };
+
+  string line;
+  while(getline(file, line)){
+    if(line.empty() || line[0] == '#')
+      continue;
+
+    istringstream fields(line);
+    string name;
+    fields >> name;
+
+    if(name == "nsigma"){
+      fields >> _nSigma;
+    }else{
+      const int parameter = find(names, names + N_PARAMETERS, name) - names;
+      if(parameter == N_PARAMETERS){
+        cerr << "Error when defining double-Gaussian TF for particle " << particleName << ": unknown parameter " << name << " in " << paramFile << ".\n";
+        exit(1);
+      }
+      fields >> _a[parameter] >> _b[parameter] >> _c[parameter];
+      defined[parameter] = true;
+    }
+
+    if(fields.fail()){
+      cerr << "Error when defining double-Gaussian TF for particle " << particleName << ": invalid line \"" << line << "\" in " << paramFile << ".\n";
+      exit(1);
+    }
+  }
+
+  for(int i = 0; i < N_PARAMETERS; ++i){
+    if(!defined[i]){
+      cerr << "Error when defining double-Gaussian TF for particle " << particleName << ": parameter " << names[i] << " missing in " << paramFile << ".\n";
+      exit(1);
+    }
+  }
+
+  cout << "Creating double-Gaussian TF component for " << particleName << " from " << paramFile << ".\n";
+  cout << "Integration range is " << _nSigma << " widths around the means" << endl << endl;
+}
+
+double DoubleGaussianTF::GetDeltaMin(const double &Erec) const {
+  const double Egen = max(Erec, 0.);
+  const double sqrtEgen = sqrt(Egen);
+
+  return min( GetParameter(MEAN1, sqrtEgen, Egen) - _nSigma*fabs(GetParameter(SIGMA1, sqrtEgen, Egen)),
+              GetParameter(MEAN2, sqrtEgen, Egen) - _nSigma*fabs(GetParameter(SIGMA2, sqrtEgen, Egen)) );
+}
+
+double DoubleGaussianTF::GetDeltaMax(const double &Erec) const {
+  const double Egen = max(Erec, 0.);
+  const double sqrtEgen = sqrt(Egen);
+
+  const double deltaMax = max( GetParameter(MEAN1, sqrtEgen, Egen) + _nSigma*fabs(GetParameter(SIGMA1, sqrtEgen, Egen)),
+                               GetParameter(MEAN2, sqrtEgen, Egen) + _nSigma*fabs(GetParameter(SIGMA2, sqrtEgen, Egen)) );
+  // Egen > 0
+  return min(deltaMax, Erec);
+}
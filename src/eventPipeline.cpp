@@ -0,0 +1,121 @@
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <iostream>
+#include <stdlib.h>
+
+#include "eventPipeline.h"
+
+using namespace std;
+
+SlotRing::SlotRing(const size_t capacity):
+  _head(0),
+  _tail(0){
+
+  // One element is always left empty to distinguish a full ring from an empty one
+  size_t size = 2;
+  while(size < capacity + 1)
+    size *= 2;
+  _slots.resize(size);
+  _mask = size - 1;
+}
+
+bool SlotRing::TryPush(const size_t slot){
+  const size_t tail = _tail.load(memory_order_relaxed);
+  const size_t next = (tail + 1) & _mask;
+  if(next == _head.load(memory_order_acquire))
+    return false;
+
+  _slots[tail] = slot;
+  _tail.store(next, memory_order_release);
+  return true;
+}
+
+bool SlotRing::TryPop(size_t &slot){
+  const size_t head = _head.load(memory_order_relaxed);
+  if(head == _tail.load(memory_order_acquire))
+    return false;
+
+  slot = _slots[head];
+  _head.store((head + 1) & _mask, memory_order_release);
+  return true;
+}
+
+// Spin, then sleep for 1, 2, 4, ... up to 1000 microseconds between the tries
+static void backOff(unsigned int &tries){
+  if(tries < 64){
+    this_thread::yield();
+  }else{
+    const unsigned int shift = min(tries - 64, 10u);
+    this_thread::sleep_for( chrono::microseconds( min(1u << shift, 1000u) ) );
+  }
+  ++tries;
+}
+
+void SlotRing::Push(const size_t slot){
+  unsigned int tries = 0;
+  while(!TryPush(slot))
+    backOff(tries);
+}
+
+size_t SlotRing::Pop(){
+  size_t slot;
+  unsigned int tries = 0;
+  while(!TryPop(slot))
+    backOff(tries);
+  return slot;
+}
+
+EventPipeline::EventPipeline(const size_t nSlots):
+  _nSlots(nSlots){
+
+  if(_nSlots < 1){
+    cerr << "Error: the event pipeline needs at least one slot." << endl;
+    exit(1);
+  }
+}
+
+size_t EventPipeline::Run(const function<bool(size_t)> &read, const function<void(size_t)> &compute, const function<void(size_t)> &write){
+  // Index used to signal the end of the events
+  const size_t end = _nSlots;
+
+  // free -> reader -> ready -> compute -> done -> writer -> free
+  SlotRing freeSlots(_nSlots), readySlots(_nSlots + 1), doneSlots(_nSlots + 1);
+  for(size_t i = 0; i < _nSlots; ++i)
+    freeSlots.Push(i);
+
+  thread reader([&](){
+    while(true){
+      const size_t slot = freeSlots.Pop();
+      if(!read(slot))
+        break;
+      readySlots.Push(slot);
+    }
+    readySlots.Push(end);
+  });
+
+  thread writer([&](){
+    size_t slot;
+    while( (slot = doneSlots.Pop()) != end ){
+      write(slot);
+      freeSlots.Push(slot);
+    }
+  });
+
+  size_t nEvents = 0;
+  size_t slot;
+  while( (slot = readySlots.Pop()) != end ){
+    compute(slot);
+    doneSlots.Push(slot);
+    ++nEvents;
+  }
+  doneSlots.Push(end);
+
+  reader.join();
+  writer.join();
+
+  return nEvents;
+}
@@ -0,0 +1,63 @@
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include "Math/Vector4D.h"
+
+#include "eventSelection.h"
+#include "MEPermutations.h"
+
+using namespace std;
+
+static bool ptSorter(const ROOT::Math::PtEtaPhiEVector &i, const ROOT::Math::PtEtaPhiEVector &j) { return i.Pt() > j.Pt(); }
+
+EventSelection::EventSelection(const SelectionCuts &cuts):
+  _cuts(cuts),
+  _hasMet(false){
+}
+
+void EventSelection::Clear(){
+  _positrons.clear();
+  _muons.clear();
+  _jets.clear();
+  _hasMet = false;
+}
+
+bool EventSelection::PassLeptonCuts(const ROOT::Math::PtEtaPhiEVector &p4) const {
+  return p4.Pt() > _cuts.leptonPtMin && abs(p4.Eta()) < _cuts.leptonEtaMax;
+}
+
+void EventSelection::AddElectron(const ROOT::Math::PtEtaPhiEVector &p4, const int charge){
+  if(charge > 0 && PassLeptonCuts(p4))
+    _positrons.push_back(p4);
+}
+
+void EventSelection::AddMuon(const ROOT::Math::PtEtaPhiEVector &p4, const int charge){
+  if(charge < 0 && PassLeptonCuts(p4))
+    _muons.push_back(p4);
+}
+
+void EventSelection::AddJet(const ROOT::Math::PtEtaPhiEVector &p4, const bool bTagged){
+  if(_cuts.requireBTag && !bTagged)
+    return;
+  if(p4.Pt() > _cuts.jetPtMin && abs(p4.Eta()) < _cuts.jetEtaMax)
+    _jets.push_back(p4);
+}
+
+bool EventSelection::BuildPermutations(MEPermutations &permutations) const {
+  if(!_positrons.size() || !_muons.size() || _jets.size() < 2 || !_hasMet)
+    return false;
+
+  const ROOT::Math::PtEtaPhiEVector positron = *min_element(_positrons.begin(), _positrons.end(), ptSorter);
+  const ROOT::Math::PtEtaPhiEVector muon = *min_element(_muons.begin(), _muons.end(), ptSorter);
+
+  vector<ROOT::Math::PtEtaPhiEVector> jets(_jets);
+  sort(jets.begin(), jets.end(), ptSorter);
+  if(_cuts.maxJets && jets.size() > _cuts.maxJets)
+    jets.resize(_cuts.maxJets);
+
+  permutations.SetObjects(positron, muon, jets, _met);
+
+  return true;
+}
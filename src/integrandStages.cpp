@@ -0,0 +1,47 @@
+#define _USE_MATH_DEFINES // include M_PI constant
+#include <cmath>
+
+#include "integrandStages.h"
+#include "fourVector.h"
+#include "tfComponent.h"
+#include "utils.h"
+
+void VisibleParticle::Set(const FourVector &rec, const TFComponent* tf, const bool importanceSampling){
+  _kin.Compute(rec);
+  _Erec = rec.e;
+  _TF = tf;
+
+  if(_TF){
+    _deltaMax = _TF->GetDeltaMax(_Erec);
+    _deltaRange = _TF->GetDeltaRange(_Erec);
+  }else{
+    _deltaMax = 0.;
+    _deltaRange = 0.;
+  }
+
+  _importanceSampling = importanceSampling && _deltaRange > 0.;
+  if(_importanceSampling)
+    _TF->FillSampler(_Erec, _sampler);
+
+  // With sin(theta) = Pt/|P|
+  const double sinTheta = _kin.p > 0 ? _kin.pt/_kin.p : 0.;
+  _dPhiFactor = sinTheta/(2.0*CB(2.*M_PI));
+}
+
+StageCounters& StageCounters::operator+=(const StageCounters &other){
+  for(int i = 0; i < N_COUNTERS; ++i)
+    _counts[i] += other._counts[i];
+  for(int i = 0; i < N_STAGES; ++i)
+    _times[i] += other._times[i];
+  return *this;
+}
+
+const char* StageCounters::GetName(const int counter){
+  static const char* names[N_COUNTERS] = { "points", "rejected_visibles", "rejected_invariants", "no_solution", "solutions", "rejected_partons", "rejected_jacobian", "matrix_elements", "rejected_roots" };
+  return names[counter];
+}
+
+const char* StageCounters::GetStageName(const int stage){
+  static const char* names[N_STAGES] = { "visibles", "neutrinos", "kinematics", "matrix_element", "pdf" };
+  return names[stage];
+}
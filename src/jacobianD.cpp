@@ -2,21 +2,25 @@
 #include <vector>
 #include <cmath>
 
-#include "Math/Vector4D.h"
 #include "TMath.h"
 
 #include "utils.h"
 #include "jacobianD.h"
+#include "fourVector.h"
+#include "cpuDispatch.h"
 
 using namespace std;
 
+ISA_TARGET_BEGIN
+
 int ComputeTransformD(const double &s13, const double &s134, const double &s25, const double &s256,
-                      const ROOT::Math::PxPyPzEVector &p3, const ROOT::Math::PxPyPzEVector &p4, const ROOT::Math::PxPyPzEVector &p5, const ROOT::Math::PxPyPzEVector &p6, const ROOT::Math::PxPyPzEVector &Met, const ROOT::Math::PxPyPzEVector &ISR,
-                      std::vector<ROOT::Math::PxPyPzEVector> &p1, std::vector<ROOT::Math::PxPyPzEVector> &p2){
+                      const FourVector &p3, const FourVector &p4, const FourVector &p5, const FourVector &p6, const FourVector &Met, const FourVector &ISR,
+                      std::vector<FourVector> &p1, std::vector<FourVector> &p2,
+                      int &nRejectedRoots){
   // pT = transverse total momentum of the visible particles
   // It will be used to reconstruct neutrinos, but we want to take into account the measured ISR (pt_isr = - pt_met - pt_vis),
   // so we add pt_isr to pt_vis in order to have pt_vis + pt_nu + pt_isr = 0 as it should be.
-  ROOT::Math::PxPyPzEVector pT = p3 + p4 + p5 + p6 + ISR;
+  const FourVector pT = p3 + p4 + p5 + p6 + ISR;
 
   const double p34 = p3.Dot(p4);
   const double p56 = p5.Dot(p6);
@@ -29,17 +33,17 @@ int ComputeTransformD(const double &s13, const double &s134, const double &s25,
   // A2 p1y + B2 p2y + C2 = 0, with C2(E1,E2)
   // ==> express p1x and p1y as functions of E1, E2
   
-  const double A1 = 2.*( -p3.Px() + p3.Pz()*p4.Px()/p4.Pz() );
-  const double A2 = 2.*( p5.Px() - p5.Pz()*p6.Px()/p6.Pz() );
+  const double A1 = 2.*( -p3.px + p3.pz*p4.px/p4.pz );
+  const double A2 = 2.*( p5.px - p5.pz*p6.px/p6.pz );
   
-  const double B1 = 2.*( -p3.Py() + p3.Pz()*p4.Py()/p4.Pz() );
-  const double B2 = 2.*( p5.Py() - p5.Pz()*p6.Py()/p6.Pz() );
+  const double B1 = 2.*( -p3.py + p3.pz*p4.py/p4.pz );
+  const double B2 = 2.*( p5.py - p5.pz*p6.py/p6.pz );
 
   const double Dx = B2*A1 - B1*A2;
   const double Dy = A2*B1 - A1*B2;
 
-  const double X = 2*( pT.Px()*p5.Px() + pT.Py()*p5.Py() - p5.Pz()/p6.Pz()*( 0.5*(s25 - s256 + p66) + p56 + pT.Px()*p6.Px() + pT.Py()*p6.Py() ) ) + p55 - s25;
-  const double Y = p3.Pz()/p4.Pz()*( s13 - s134 + 2*p34 + p44 ) - p33 + s13;
+  const double X = 2*( pT.px*p5.px + pT.py*p5.py - p5.pz/p6.pz*( 0.5*(s25 - s256 + p66) + p56 + pT.px*p6.px + pT.py*p6.py ) ) + p55 - s25;
+  const double Y = p3.pz/p4.pz*( s13 - s134 + 2*p34 + p44 ) - p33 + s13;
 
   // p1x = alpha1 E1 + beta1 E2 + gamma1
   // p1y = ...(2)
@@ -48,29 +52,29 @@ int ComputeTransformD(const double &s13, const double &s134, const double &s25,
   // p2x = ...(5)
   // p2y = ...(6)
   
-  const double alpha1 = -2*B2*(p3.E() - p4.E()*p3.Pz()/p4.Pz())/Dx;
-  const double beta1 = 2*B1*(p5.E() - p6.E()*p5.Pz()/p6.Pz())/Dx;
+  const double alpha1 = -2*B2*(p3.e - p4.e*p3.pz/p4.pz)/Dx;
+  const double beta1 = 2*B1*(p5.e - p6.e*p5.pz/p6.pz)/Dx;
   const double gamma1 = B1*X/Dx + B2*Y/Dx;
 
-  const double alpha2 = -2*A2*(p3.E() - p4.E()*p3.Pz()/p4.Pz())/Dy;
-  const double beta2 = 2*A1*(p5.E() - p6.E()*p5.Pz()/p6.Pz())/Dy;
+  const double alpha2 = -2*A2*(p3.e - p4.e*p3.pz/p4.pz)/Dy;
+  const double beta2 = 2*A1*(p5.e - p6.e*p5.pz/p6.pz)/Dy;
   const double gamma2 = A1*X/Dy + A2*Y/Dy;
 
-  const double alpha3 = (p4.E() - alpha1*p4.Px() - alpha2*p4.Py())/p4.Pz();
-  const double beta3 = -(beta1*p4.Px() + beta2*p4.Py())/p4.Pz();
-  const double gamma3 = ( 0.5*(s13 - s134 + p44) + p34 - gamma1*p4.Px() - gamma2*p4.Py() )/p4.Pz();
+  const double alpha3 = (p4.e - alpha1*p4.px - alpha2*p4.py)/p4.pz;
+  const double beta3 = -(beta1*p4.px + beta2*p4.py)/p4.pz;
+  const double gamma3 = ( 0.5*(s13 - s134 + p44) + p34 - gamma1*p4.px - gamma2*p4.py )/p4.pz;
 
-  const double alpha4 = (alpha1*p6.Px() + alpha2*p6.Py())/p6.Pz();
-  const double beta4 = (p6.E() + beta1*p6.Px() + beta2*p6.Py())/p6.Pz();
-  const double gamma4 = ( 0.5*(s25 - s256 + p66) + p56 + (gamma1 + pT.Px())*p6.Px() + (gamma2 + pT.Py())*p6.Py() )/p6.Pz();
+  const double alpha4 = (alpha1*p6.px + alpha2*p6.py)/p6.pz;
+  const double beta4 = (p6.e + beta1*p6.px + beta2*p6.py)/p6.pz;
+  const double gamma4 = ( 0.5*(s25 - s256 + p66) + p56 + (gamma1 + pT.px)*p6.px + (gamma2 + pT.py)*p6.py )/p6.pz;
 
   const double alpha5 = -alpha1;
   const double beta5 = -beta1;
-  const double gamma5 = -pT.Px() - gamma1;
+  const double gamma5 = -pT.px - gamma1;
 
   const double alpha6 = -alpha2;
   const double beta6 = -beta2;
-  const double gamma6 = -pT.Py() - gamma2;
+  const double gamma6 = -pT.py - gamma2;
 
   // a11 E1^2 + a22 E2^2 + a12 E1E2 + a10 E1 + a01 E2 + a00 = 0
   // id. with bij
@@ -93,7 +97,7 @@ int ComputeTransformD(const double &s13, const double &s134, const double &s25,
   vector<double> E1, E2;
   //cout << "coefs=" << a11 << "," << a22 << "," << a12 << "," << a10 << "," << a01 << "," << a00 << endl;
   //cout << "coefs=" << b11 << "," << b22 << "," << b12 << "," << b10 << "," << b01 << "," << b00 << endl;
-  solve2Quads(a11, a22, a12, a10, a01, a00, b11, b22, b12, b10, b01, b00, E1, E2, false);
+  solve2QuadsPolished(a11, a22, a12, a10, a01, a00, b11, b22, b12, b10, b01, b00, E1, E2, nRejectedRoots);
 
   // For each solution (E1,E2), find the neutrino 4-momenta p1,p2
 
@@ -109,19 +113,17 @@ int ComputeTransformD(const double &s13, const double &s134, const double &s25,
     if(e1 < 0. || e2 < 0.)
       continue;
 
-    ROOT::Math::PxPyPzEVector tempp1, tempp2;
-
-    tempp1.SetCoordinates(
+    const FourVector tempp1 = {
         alpha1*e1 + beta1*e2 + gamma1,
         alpha2*e1 + beta2*e2 + gamma2,
         alpha3*e1 + beta3*e2 + gamma3,
-        e1);
+        e1 };
 
-    tempp2.SetCoordinates(
+    const FourVector tempp2 = {
         alpha5*e1 + beta5*e2 + gamma5,
         alpha6*e1 + beta6*e2 + gamma6,
         alpha4*e1 + beta4*e2 + gamma4,
-        e2);
+        e2 };
 
     p1.push_back(tempp1);
     p2.push_back(tempp2);
@@ -130,37 +132,37 @@ int ComputeTransformD(const double &s13, const double &s134, const double &s25,
   return p1.size();
 }
 
-double computeJacobianD(const std::vector<ROOT::Math::PxPyPzEVector> &p, const double &sqrt_s){
+double computeJacobianD(const FourVector *p, const double &sqrt_s){
   
-  const double E1  = p.at(0).E();
-  const double p1x = p.at(0).Px();
-  const double p1y = p.at(0).Py();
-  const double p1z = p.at(0).Pz();
-
-  const double E2  = p.at(1).E();
-  const double p2x = p.at(1).Px();
-  const double p2y = p.at(1).Py();
-  const double p2z = p.at(1).Pz();
-
-  const double E3  = p.at(2).E();
-  const double p3x = p.at(2).Px();
-  const double p3y = p.at(2).Py();
-  const double p3z = p.at(2).Pz();
-
-  const double E4  = p.at(3).E();
-  const double p4x = p.at(3).Px();
-  const double p4y = p.at(3).Py();
-  const double p4z = p.at(3).Pz();
-
-  const double E5  = p.at(4).E();
-  const double p5x = p.at(4).Px();
-  const double p5y = p.at(4).Py();
-  const double p5z = p.at(4).Pz();
-
-  const double E6  = p.at(5).E();
-  const double p6x = p.at(5).Px();
-  const double p6y = p.at(5).Py();
-  const double p6z = p.at(5).Pz();
+  const double E1  = p[0].e;
+  const double p1x = p[0].px;
+  const double p1y = p[0].py;
+  const double p1z = p[0].pz;
+
+  const double E2  = p[1].e;
+  const double p2x = p[1].px;
+  const double p2y = p[1].py;
+  const double p2z = p[1].pz;
+
+  const double E3  = p[2].e;
+  const double p3x = p[2].px;
+  const double p3y = p[2].py;
+  const double p3z = p[2].pz;
+
+  const double E4  = p[3].e;
+  const double p4x = p[3].px;
+  const double p4y = p[3].py;
+  const double p4z = p[3].pz;
+
+  const double E5  = p[4].e;
+  const double p5x = p[4].px;
+  const double p5y = p[4].py;
+  const double p5z = p[4].pz;
+
+  const double E6  = p[5].e;
+  const double p6x = p[5].px;
+  const double p6y = p[5].py;
+  const double p6z = p[5].pz;
 
   const double E34  = E3 + E4;
   const double p34x = p3x + p4x;
@@ -212,10 +214,14 @@ double computeJacobianD(const std::vector<ROOT::Math::PxPyPzEVector> &p, const d
 
   //std::cout << "jac=" << abs(jac) << std::endl;
   
-  if(abs(inv_jac) < INV_JAC_MIN){
-    std::cout << "Warning: jacobian is close to zero!" << std::endl;
+  if(!(abs(inv_jac) >= INV_JAC_MIN)){
+    // Also catches NaNs
     return -1.;
   }else
     return 1./abs(inv_jac);
 }
 
+ISA_TARGET_END
+
+// Outside of the target pragma: run at startup on any CPU
+static const bool registered = RegisterISAKernels(ISA_LEVEL, { &ISA_NAMESPACE::ComputeTransformD, &ISA_NAMESPACE::computeJacobianD });
@@ -0,0 +1,274 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "jobTelemetry.h"
+
+using namespace std;
+
+// 1 ms to ~28 h, 4 buckets per decade
+const std::vector<double> JobTelemetry::latencyBuckets = [](){
+  vector<double> buckets;
+  for(int i = -12; i <= 20; ++i)
+    buckets.push_back( pow(10., i/4.) );
+  return buckets;
+}();
+
+struct JobTelemetry::Snapshot{
+  double elapsed;
+  long done, selected, total;
+  double cpuTime;
+  // Latencies: sum, quantiles, maximum, and number of events in each bucket (not cumulative)
+  double latencySum, p50, p95, p99, maxLatency;
+  vector<long> bucketCounts;
+  StageCounters counters;
+  long rss, peakRSS;
+};
+
+// Resident set size, and its maximum since the start of the process (bytes)
+static void getRSS(long &rss, long &peakRSS){
+  rss = 0;
+  ifstream statm("/proc/self/statm");
+  long size = 0, resident = 0;
+  if(statm >> size >> resident)
+    rss = resident*sysconf(_SC_PAGESIZE);
+
+  struct rusage usage;
+  peakRSS = getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss*1024L : 0;
+}
+
+static string escape(const string &value){
+  string escaped;
+  for(const char c: value){
+    if(c == '"' || c == '\\')
+      escaped += '\\';
+    escaped += c == '\n' ? ' ' : c;
+  }
+  return escaped;
+}
+
+JobTelemetry::JobTelemetry(const std::string &fileName, const std::string &job, const double interval):
+  _fileName(fileName),
+  _job(job),
+  _interval(interval),
+  _start(chrono::steady_clock::now()),
+  _total(-1),
+  _nSelected(0),
+  _cpuTime(0.),
+  _stop(false){
+
+  _prometheus = fileName.size() > 5 && fileName.compare(fileName.size() - 5, 5, ".prom") == 0;
+  if(_interval <= 0.){
+    cerr << "Error: the telemetry interval must be positive." << endl;
+    exit(1);
+  }
+
+  Write();
+  _thread = thread(&JobTelemetry::Run, this);
+}
+
+JobTelemetry::~JobTelemetry(){
+  {
+    lock_guard<mutex> lock(_stopMutex);
+    _stop = true;
+  }
+  _wakeUp.notify_one();
+  _thread.join();
+
+  Write();
+}
+
+void JobTelemetry::SetTotalEvents(const long total){
+  lock_guard<mutex> lock(_mutex);
+  _total = total;
+}
+
+void JobTelemetry::AddEvent(const double realTime, const double cpuTime, const bool selected, const StageCounters &counters){
+  lock_guard<mutex> lock(_mutex);
+  _latencies.push_back(realTime);
+  _cpuTime += cpuTime;
+  if(selected)
+    ++_nSelected;
+  _counters += counters;
+}
+
+void JobTelemetry::Run(){
+  unique_lock<mutex> lock(_stopMutex);
+  while(!_wakeUp.wait_for(lock, chrono::duration<double>(_interval), [this](){ return _stop; })){
+    lock.unlock();
+    Write();
+    lock.lock();
+  }
+}
+
+void JobTelemetry::TakeSnapshot(Snapshot &snapshot){
+  vector<double> latencies;
+  {
+    lock_guard<mutex> lock(_mutex);
+    latencies = _latencies;
+    snapshot.selected = _nSelected;
+    snapshot.total = _total;
+    snapshot.cpuTime = _cpuTime;
+    snapshot.counters = _counters;
+  }
+
+  snapshot.elapsed = chrono::duration<double>(chrono::steady_clock::now() - _start).count();
+  snapshot.done = latencies.size();
+
+  sort(latencies.begin(), latencies.end());
+  // Nearest-rank quantiles
+  auto quantile = [&latencies](const double q){
+    if(latencies.empty())
+      return 0.;
+    const size_t rank = static_cast<size_t>(ceil(q*latencies.size()));
+    return latencies[max(rank, static_cast<size_t>(1)) - 1];
+  };
+  snapshot.p50 = quantile(0.5);
+  snapshot.p95 = quantile(0.95);
+  snapshot.p99 = quantile(0.99);
+  snapshot.maxLatency = latencies.empty() ? 0. : latencies.back();
+
+  snapshot.latencySum = 0.;
+  snapshot.bucketCounts.assign(latencyBuckets.size() + 1, 0);
+  size_t bucket = 0;
+  for(const double latency: latencies){
+    snapshot.latencySum += latency;
+    while(bucket < latencyBuckets.size() && latency > latencyBuckets[bucket])
+      ++bucket;
+    ++snapshot.bucketCounts[bucket];
+  }
+
+  getRSS(snapshot.rss, snapshot.peakRSS);
+}
+
+std::string JobTelemetry::FormatJSON(const Snapshot &snapshot) const {
+  const double eventsPerHour = snapshot.elapsed > 0. ? 3600.*snapshot.done/snapshot.elapsed : 0.;
+  const long remaining = snapshot.total >= 0 ? max(snapshot.total - snapshot.done, 0L) : -1;
+  const double evaluations = snapshot.counters.Get(StageCounters::POINTS);
+
+  ostringstream json;
+  json.precision(10);
+  json << "{\n";
+  json << "  \"job\": \"" << escape(_job) << "\",\n";
+  json << "  \"elapsed_seconds\": " << snapshot.elapsed << ",\n";
+  json << "  \"events_done\": " << snapshot.done << ",\n";
+  json << "  \"events_selected\": " << snapshot.selected << ",\n";
+  json << "  \"events_total\": " << snapshot.total << ",\n";
+  json << "  \"events_remaining\": " << remaining << ",\n";
+  json << "  \"events_per_hour\": " << eventsPerHour << ",\n";
+  json << "  \"eta_seconds\": " << (remaining >= 0 && eventsPerHour > 0. ? 3600.*remaining/eventsPerHour : -1.) << ",\n";
+  json << "  \"cpu_seconds\": " << snapshot.cpuTime << ",\n";
+  json << "  \"latency_seconds\": { \"mean\": " << (snapshot.done ? snapshot.latencySum/snapshot.done : 0.)
+       << ", \"p50\": " << snapshot.p50 << ", \"p95\": " << snapshot.p95 << ", \"p99\": " << snapshot.p99 << ", \"max\": " << snapshot.maxLatency << " },\n";
+  json << "  \"latency_histogram\": [";
+  for(size_t i = 0; i < snapshot.bucketCounts.size(); ++i){
+    json << (i ? ", " : " ") << "{ \"le\": ";
+    if(i < latencyBuckets.size())
+      json << latencyBuckets[i];
+    else
+      json << "\"+Inf\"";
+    json << ", \"count\": " << snapshot.bucketCounts[i] << " }";
+  }
+  json << " ],\n";
+  json << "  \"evaluations\": " << evaluations << ",\n";
+  json << "  \"evaluations_per_second\": " << (snapshot.elapsed > 0. ? evaluations/snapshot.elapsed : 0.) << ",\n";
+  json << "  \"stage_counters\": {";
+  for(int i = 0; i < StageCounters::N_COUNTERS; ++i)
+    json << (i ? ", " : " ") << "\"" << StageCounters::GetName(i) << "\": " << snapshot.counters.Get(i);
+  json << " },\n";
+  json << "  \"stage_seconds\": {";
+  for(int i = 0; i < StageCounters::N_STAGES; ++i)
+    json << (i ? ", " : " ") << "\"" << StageCounters::GetStageName(i) << "\": " << snapshot.counters.GetTime(i);
+  json << " },\n";
+  json << "  \"rss_bytes\": " << snapshot.rss << ",\n";
+  json << "  \"peak_rss_bytes\": " << snapshot.peakRSS << "\n";
+  json << "}\n";
+
+  return json.str();
+}
+
+std::string JobTelemetry::FormatPrometheus(const Snapshot &snapshot) const {
+  // "job" is reserved for the scrape job
+  const string job = "mem_job=\"" + escape(_job) + "\"";
+  const double evaluations = snapshot.counters.Get(StageCounters::POINTS);
+
+  ostringstream prom;
+  prom.precision(10);
+  auto metric = [&](const string &name, const string &type, const string &help, const double value){
+    prom << "# HELP memcpp_" << name << " " << help << "\n";
+    prom << "# TYPE memcpp_" << name << " " << type << "\n";
+    prom << "memcpp_" << name << "{" << job << "} " << value << "\n";
+  };
+
+  metric("elapsed_seconds", "gauge", "Time since the start of the job.", snapshot.elapsed);
+  metric("events_done_total", "counter", "Events processed.", snapshot.done);
+  metric("events_selected_total", "counter", "Events passing the selection.", snapshot.selected);
+  if(snapshot.total >= 0){
+    const long remaining = max(snapshot.total - snapshot.done, 0L);
+    metric("events_remaining", "gauge", "Events left to process.", remaining);
+    if(snapshot.done && snapshot.elapsed > 0.)
+      metric("eta_seconds", "gauge", "Estimated time until the end of the job.", remaining*snapshot.elapsed/snapshot.done);
+  }
+  metric("events_per_hour", "gauge", "Average throughput of the job.", snapshot.elapsed > 0. ? 3600.*snapshot.done/snapshot.elapsed : 0.);
+  metric("cpu_seconds_total", "counter", "CPU time of the event computations.", snapshot.cpuTime);
+
+  prom << "# HELP memcpp_event_latency_seconds Real time per event.\n";
+  prom << "# TYPE memcpp_event_latency_seconds histogram\n";
+  long cumulative = 0;
+  for(size_t i = 0; i < snapshot.bucketCounts.size(); ++i){
+    cumulative += snapshot.bucketCounts[i];
+    prom << "memcpp_event_latency_seconds_bucket{" << job << ",le=\"";
+    if(i < latencyBuckets.size())
+      prom << latencyBuckets[i];
+    else
+      prom << "+Inf";
+    prom << "\"} " << cumulative << "\n";
+  }
+  prom << "memcpp_event_latency_seconds_sum{" << job << "} " << snapshot.latencySum << "\n";
+  prom << "memcpp_event_latency_seconds_count{" << job << "} " << snapshot.done << "\n";
+
+  prom << "# HELP memcpp_event_latency_quantile_seconds Quantiles of the real time per event.\n";
+  prom << "# TYPE memcpp_event_latency_quantile_seconds gauge\n";
+  prom << "memcpp_event_latency_quantile_seconds{" << job << ",quantile=\"0.5\"} " << snapshot.p50 << "\n";
+  prom << "memcpp_event_latency_quantile_seconds{" << job << ",quantile=\"0.95\"} " << snapshot.p95 << "\n";
+  prom << "memcpp_event_latency_quantile_seconds{" << job << ",quantile=\"0.99\"} " << snapshot.p99 << "\n";
+
+  metric("evaluations_total", "counter", "Integrand evaluations.", evaluations);
+  metric("evaluations_per_second", "gauge", "Integrand evaluations per second of the job.", snapshot.elapsed > 0. ? evaluations/snapshot.elapsed : 0.);
+
+  prom << "# HELP memcpp_stage_counter_total Integrand stage counters.\n";
+  prom << "# TYPE memcpp_stage_counter_total counter\n";
+  for(int i = 0; i < StageCounters::N_COUNTERS; ++i)
+    prom << "memcpp_stage_counter_total{" << job << ",counter=\"" << StageCounters::GetName(i) << "\"} " << snapshot.counters.Get(i) << "\n";
+  prom << "# HELP memcpp_stage_seconds_total Estimated integrand time per stage.\n";
+  prom << "# TYPE memcpp_stage_seconds_total counter\n";
+  for(int i = 0; i < StageCounters::N_STAGES; ++i)
+    prom << "memcpp_stage_seconds_total{" << job << ",stage=\"" << StageCounters::GetStageName(i) << "\"} " << snapshot.counters.GetTime(i) << "\n";
+
+  metric("rss_bytes", "gauge", "Resident memory.", snapshot.rss);
+  metric("peak_rss_bytes", "gauge", "Maximal resident memory.", snapshot.peakRSS);
+
+  return prom.str();
+}
+
+void JobTelemetry::Write(){
+  Snapshot snapshot;
+  TakeSnapshot(snapshot);
+  const string content = _prometheus ? FormatPrometheus(snapshot) : FormatJSON(snapshot);
+
+  // Replaced atomically, so that readers never see a partial file
+  const string tmpName = _fileName + ".tmp";
+  ofstream file(tmpName, ios::trunc);
+  file << content;
+  file.close();
+  if(!file || rename(tmpName.c_str(), _fileName.c_str()) != 0)
+    cerr << "Warning: could not write the telemetry file " << _fileName << "." << endl;
+}
@@ -0,0 +1,137 @@
+#include <vector>
+#include <map>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "qmcIntegrator.h"
+#include "quasiRandom.h"
+#include "vegasGrid.h"
+
+using namespace std;
+
+QMCIntegrator::QMCIntegrator(const int nDim, const Rule rule, const uint64_t seed):
+  _nDim(nDim),
+  _rule(rule),
+  _seed(seed),
+  _grid(nDim),
+  _sobol(nullptr),
+  _nCalls(0){
+
+  if(_rule == SOBOL)
+    _sobol = new SobolSequence(_nDim);
+}
+
+QMCIntegrator::~QMCIntegrator(){
+  delete _sobol; _sobol = nullptr;
+  for(auto &lattice: _lattices){
+    delete lattice.second; lattice.second = nullptr;
+  }
+}
+
+PointSet* QMCIntegrator::GetPointSet(const uint64_t nPoints){
+  if(_rule == SOBOL)
+    return _sobol;
+
+  auto it = _lattices.find(nPoints);
+  if(it == _lattices.end())
+    it = _lattices.insert( make_pair(nPoints, new LatticeRule(_nDim, nPoints)) ).first;
+  return it->second;
+}
+
+int QMCIntegrator::Integrate(SamplingIntegrand integrand, void *userData, const int nComp, const int maxEval, const int nStart, const double relAccuracy, const double absAccuracy, double *result, double *error, double *prob){
+
+  // Start from a uniform grid
+  _grid.Reset();
+  const int nBins = _grid.GetNumberOfBins();
+
+  uint64_t nPoints = 2;
+  while(nPoints*_nReplicates < static_cast<uint64_t>(nStart))
+    nPoints *= 2;
+  // The first iteration is always done: rounded down instead if rounding up would exceed maxEval
+  while(nPoints > 2 && nPoints*_nReplicates > static_cast<uint64_t>(maxEval))
+    nPoints /= 2;
+
+  const int core = 0;
+  vector<double> y(_nDim), x(_blockSize*_nDim), f(_blockSize*nComp), jacobians(_blockSize), weights(_blockSize);
+  vector<int> bins(_blockSize*_nDim);
+  vector<double> binVariance(nBins*_nDim);
+  vector<double> replicates(_nReplicates*nComp);
+  vector<IterationResults> iterations(nComp);
+
+  const uint64_t callSeed = mixSeed(_seed ^ mixSeed(_nCalls++));
+  int nEval = 0;
+
+  for(int iteration = 0; ; ++iteration){
+    if(iteration > 0 && nEval + nPoints*_nReplicates > static_cast<uint64_t>(maxEval))
+      break;
+
+    fill(binVariance.begin(), binVariance.end(), 0.);
+    fill(replicates.begin(), replicates.end(), 0.);
+
+    PointSet *points = GetPointSet(nPoints);
+
+    for(int r = 0; r < _nReplicates; ++r){
+      points->Randomize( mixSeed(callSeed + iteration*_nReplicates + r) );
+
+      for(uint64_t start = 0; start < nPoints; start += _blockSize){
+        const int m = min(static_cast<uint64_t>(_blockSize), nPoints - start);
+        for(int k = 0; k < m; ++k){
+          points->GetPoint(start + k, y.data());
+          jacobians[k] = _grid.Map(y.data(), &x[k*_nDim], &bins[k*_nDim]);
+          weights[k] = jacobians[k]/(nPoints*_nReplicates);
+        }
+
+        integrand(&_nDim, x.data(), &nComp, f.data(), userData, &m, &core, weights.data());
+
+        for(int k = 0; k < m; ++k){
+          double total = 0.;
+          for(int c = 0; c < nComp; ++c){
+            const double value = std::isnan(f[k*nComp + c]) ? 0. : f[k*nComp + c]*jacobians[k];
+            replicates[r*nComp + c] += value;
+            total += fabs(value);
+          }
+          for(int d = 0; d < _nDim; ++d)
+            binVariance[nBins*d + bins[k*_nDim + d]] += total*total;
+        }
+      }
+    }
+    nEval += nPoints*_nReplicates;
+
+    bool converged = true;
+    for(int c = 0; c < nComp; ++c){
+      double mean = 0.;
+      for(int r = 0; r < _nReplicates; ++r)
+        mean += replicates[r*nComp + c]/nPoints;
+      mean /= _nReplicates;
+
+      double variance = 0.;
+      for(int r = 0; r < _nReplicates; ++r)
+        variance += pow(replicates[r*nComp + c]/nPoints - mean, 2);
+      variance /= _nReplicates*(_nReplicates - 1);
+
+      iterations[c].Add(mean, variance);
+      result[c] = iterations[c].GetResult();
+      error[c] = iterations[c].GetError();
+      prob[c] = iterations[c].GetProb();
+
+      if(error[c] > max(relAccuracy*fabs(result[c]), absAccuracy))
+        converged = false;
+      // Only iterations with a vanishing variance (e.g. all the points where the integrand vanishes): the integrand
+      // may be peaked in a region not sampled yet, so keep sampling during the adaptation iterations
+      if(iterations[c].IsExact() && iteration + 1 < _nAdaptIterations)
+        converged = false;
+    }
+
+    if(converged && iteration > 0)
+      break;
+
+    _grid.Refine(binVariance);
+
+    if(iteration + 1 >= _nAdaptIterations)
+      nPoints *= 2;
+  }
+
+  return nEval;
+}
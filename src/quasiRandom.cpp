@@ -0,0 +1,173 @@
+#include <vector>
+#include <iostream>
+#include <cstdint>
+#include <cmath>
+#include <stdlib.h>
+
+#include "quasiRandom.h"
+
+using namespace std;
+
+// Joe-Kuo direction numbers (new-joe-kuo-6.21201) for dimensions 2 to 10: degree s, coefficients a, initial m_1..m_s
+// The first dimension is the van der Corput sequence.
+static const struct { int s; unsigned int a; unsigned int m[5]; } sobolInit[SobolSequence::maxDimension - 1] = {
+  { 1, 0, { 1 } },
+  { 2, 1, { 1, 3 } },
+  { 3, 1, { 1, 3, 1 } },
+  { 3, 2, { 1, 1, 1 } },
+  { 4, 1, { 1, 1, 3, 3 } },
+  { 4, 4, { 1, 3, 5, 13 } },
+  { 5, 2, { 1, 1, 5, 5, 17 } },
+  { 5, 4, { 1, 1, 5, 5, 5 } },
+  { 5, 7, { 1, 1, 7, 11, 19 } }
+};
+
+static inline uint32_t reverseBits(uint32_t x){
+  x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+  x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+  x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+  x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+  return (x >> 16) | (x << 16);
+}
+
+// Nested uniform scrambling: permutation of the reversed bits, where each bit only depends on the lower (i.e. more significant) ones
+static inline uint32_t owenScramble(uint32_t x, const uint32_t seed){
+  x = reverseBits(x);
+  x += seed;
+  x ^= x * 0x6c50b47cu;
+  x ^= x * 0xb82f1e52u;
+  x ^= x * 0xc7afe638u;
+  x ^= x * 0x8d22f6e6u;
+  return reverseBits(x);
+}
+
+SobolSequence::SobolSequence(const int dim):
+  _directions(32*dim, 0),
+  _seeds(dim, 0){
+
+  if(dim < 1 || dim > maxDimension){
+    cerr << "Error: Sobol sequence is only available up to " << maxDimension << " dimensions (requested " << dim << ")." << endl;
+    exit(1);
+  }
+  _dim = dim;
+
+  for(int j = 0; j < 32; ++j)
+    _directions[j] = 1u << (31 - j);
+
+  for(int d = 1; d < _dim; ++d){
+    uint32_t *v = &_directions[32*d];
+    const int s = sobolInit[d-1].s;
+    const unsigned int a = sobolInit[d-1].a;
+
+    for(int j = 0; j < s; ++j)
+      v[j] = sobolInit[d-1].m[j] << (31 - j);
+
+    for(int j = s; j < 32; ++j){
+      v[j] = v[j-s] ^ (v[j-s] >> s);
+      for(int k = 1; k < s; ++k){
+        if((a >> (s - 1 - k)) & 1)
+          v[j] ^= v[j-k];
+      }
+    }
+  }
+
+  Randomize(0);
+}
+
+void SobolSequence::Randomize(const uint64_t seed){
+  for(int d = 0; d < _dim; ++d)
+    _seeds[d] = static_cast<uint32_t>( mixSeed(seed*SobolSequence::maxDimension + d) );
+}
+
+void SobolSequence::GetPoint(const uint64_t i, double *x) const {
+  const uint32_t index = static_cast<uint32_t>(i);
+
+  for(int d = 0; d < _dim; ++d){
+    const uint32_t *v = &_directions[32*d];
+    uint32_t result = 0;
+    for(int j = 0; index >> j; ++j){
+      if((index >> j) & 1)
+        result ^= v[j];
+    }
+    // Center of the 2^-32 interval: never exactly 0 or 1
+    x[d] = (owenScramble(result, _seeds[d]) + 0.5) / 4294967296.;
+  }
+}
+
+LatticeRule::LatticeRule(const int dim, const uint64_t n):
+  _n(n),
+  _z(dim, 1),
+  _shift(dim, 0.){
+
+  if(dim < 1 || n < 2){
+    cerr << "Error: invalid lattice rule (dimension " << dim << ", " << n << " points)." << endl;
+    exit(1);
+  }
+  _dim = dim;
+
+  // Search the Korobov parameter a. P_2 = -1 + 1/n sum_k prod_j (1 + 2 pi^2 B_2({k z_j/n})), with B_2(x) = x^2 - x + 1/6.
+  // For large n, only a subset of the candidates is tried.
+  const uint64_t maxCandidates = 256;
+  const uint64_t step = max<uint64_t>(1, (_n/2) / maxCandidates);
+
+  double bestCriterion = -1.;
+  uint64_t bestA = 1;
+  vector<uint64_t> z(_dim);
+
+  for(uint64_t candidate = 2; candidate <= _n/2; candidate += step){
+    // a must be coprime with n, so that each one-dimensional projection has n distinct points:
+    // take the first such value from the candidate
+    uint64_t a = candidate;
+    for(; a < candidate + step && a <= _n/2; ++a){
+      uint64_t p = a, q = _n;
+      while(q){ const uint64_t r = p % q; p = q; q = r; }
+      if(p == 1)
+        break;
+    }
+    if(a == candidate + step || a > _n/2)
+      continue;
+
+    z[0] = 1;
+    for(int j = 1; j < _dim; ++j)
+      z[j] = (z[j-1]*a) % _n;
+
+    double criterion = 0.;
+    for(uint64_t k = 0; k < _n; ++k){
+      double prod = 1.;
+      for(int j = 0; j < _dim; ++j){
+        const double y = static_cast<double>((k*z[j]) % _n) / _n;
+        prod *= 1. + 2.*M_PI*M_PI*(y*y - y + 1./6.);
+      }
+      criterion += prod;
+      if(bestCriterion >= 0. && criterion/_n - 1. > bestCriterion)
+        break;
+    }
+    criterion = criterion/_n - 1.;
+
+    if(bestCriterion < 0. || criterion < bestCriterion){
+      bestCriterion = criterion;
+      bestA = a;
+    }
+  }
+
+  _z[0] = 1;
+  for(int j = 1; j < _dim; ++j)
+    _z[j] = (_z[j-1]*bestA) % _n;
+}
+
+void LatticeRule::Randomize(const uint64_t seed){
+  for(int d = 0; d < _dim; ++d)
+    _shift[d] = (mixSeed(seed*_dim + d) >> 11) * (1./9007199254740992.);
+}
+
+void LatticeRule::GetPoint(const uint64_t i, double *x) const {
+  for(int d = 0; d < _dim; ++d){
+    double y = static_cast<double>((i*_z[d]) % _n) / _n + _shift[d];
+    if(y >= 1.)
+      y -= 1.;
+    // Avoid the boundary of the unit cube
+    if(y <= 0.)
+      y = 0.5/_n;
+    x[d] = y;
+  }
+}
@@ -0,0 +1,174 @@
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <algorithm>
+
+#include "regression.h"
+#include "integrandStages.h"
+
+using namespace std;
+
+bool WriteRegressionFile(const string &fileName, const vector<RegressionRecord> &records){
+  ofstream file(fileName);
+  if(!file.is_open()){
+    cerr << "Error: could not write regression file " << fileName << "." << endl;
+    return false;
+  }
+
+  file << "# entry status weight error time";
+  for(int i = 0; i < StageCounters::N_COUNTERS; ++i)
+    file << " " << StageCounters::GetName(i);
+  file << endl;
+
+  file.precision(17);
+  for(const RegressionRecord &record: records){
+    file << record.entry << " " << record.status << " " << record.weight << " " << record.error << " " << record.time;
+    for(int i = 0; i < StageCounters::N_COUNTERS; ++i)
+      file << " " << record.counters.Get(i);
+    file << endl;
+  }
+
+  return file.good();
+}
+
+bool ReadRegressionFile(const string &fileName, vector<RegressionRecord> &records){
+  ifstream file(fileName);
+  if(!file.is_open()){
+    cerr << "Error: could not open regression file " << fileName << "." << endl;
+    return false;
+  }
+
+  records.clear();
+  string line;
+  int lineNumber = 0;
+  // Counter of each column after "entry status weight error time" (-1 if unknown to this version), given by the
+  // header; files without header have the counters of this version
+  vector<int> columns;
+  for(int i = 0; i < StageCounters::N_COUNTERS; ++i)
+    columns.push_back(i);
+  while(getline(file, line)){
+    ++lineNumber;
+    if(line.empty())
+      continue;
+    if(line[0] == '#'){
+      istringstream names(line.substr(1));
+      vector<string> header;
+      string name;
+      while(names >> name)
+        header.push_back(name);
+      if(header.size() < 5 || header[0] != "entry")
+        continue;
+      columns.clear();
+      for(size_t column = 5; column < header.size(); ++column){
+        int counter = -1;
+        for(int i = 0; i < StageCounters::N_COUNTERS && counter < 0; ++i){
+          if(header[column] == StageCounters::GetName(i))
+            counter = i;
+        }
+        columns.push_back(counter);
+      }
+      continue;
+    }
+
+    istringstream fields(line);
+    RegressionRecord record;
+    record.countersPresent = 0;
+    fields >> record.entry >> record.status >> record.weight >> record.error >> record.time;
+    for(const int counter: columns){
+      unsigned long long value = 0;
+      fields >> value;
+      if(counter < 0)
+        continue;
+      record.counters.Set(counter, value);
+      record.countersPresent |= 1u << counter;
+    }
+
+    if(fields.fail()){
+      cerr << "Error: invalid line " << lineNumber << " in regression file " << fileName << "." << endl;
+      return false;
+    }
+    records.push_back(record);
+  }
+
+  return true;
+}
+
+int CompareRegression(const vector<RegressionRecord> &reference, const vector<RegressionRecord> &current, const RegressionTolerances &tolerances){
+  map<long, const RegressionRecord*> currentRecords;
+  for(const RegressionRecord &record: current)
+    currentRecords[record.entry] = &record;
+
+  int nFailed = 0;
+  double maxPull = 0.;
+  // Counters not compared because they are missing in one of the files
+  unsigned int countersSkipped = 0;
+
+  for(const RegressionRecord &ref: reference){
+    const auto it = currentRecords.find(ref.entry);
+    if(it == currentRecords.end()){
+      cout << "Regression: event " << ref.entry << " FAILED: not processed." << endl;
+      ++nFailed;
+      continue;
+    }
+    const RegressionRecord &cur = *it->second;
+    vector<string> problems;
+
+    if(cur.status != ref.status)
+      problems.push_back("status " + to_string(cur.status) + " instead of " + to_string(ref.status));
+
+    const double combinedError = sqrt(cur.error*cur.error + ref.error*ref.error);
+    const double weightDiff = fabs(cur.weight - ref.weight);
+    if(combinedError > 0.)
+      maxPull = max(maxPull, weightDiff/combinedError);
+    if(weightDiff > max(tolerances.weightRel*fabs(ref.weight), tolerances.weightSigma*combinedError)){
+      ostringstream problem;
+      problem.precision(10);
+      problem << "weight " << cur.weight << " +- " << cur.error << " instead of " << ref.weight << " +- " << ref.error;
+      problems.push_back(problem.str());
+    }
+
+    if(fabs(cur.error - ref.error) > tolerances.errorRel*ref.error){
+      ostringstream problem;
+      problem << "error " << cur.error << " instead of " << ref.error;
+      problems.push_back(problem.str());
+    }
+
+    for(int i = 0; i < StageCounters::N_COUNTERS; ++i){
+      if(!(ref.countersPresent & cur.countersPresent & (1u << i))){
+        countersSkipped |= 1u << i;
+        continue;
+      }
+      const double value = cur.counters.Get(i);
+      const double refValue = ref.counters.Get(i);
+      if(fabs(value - refValue) > tolerances.countersRel*refValue){
+        ostringstream problem;
+        problem << StageCounters::GetName(i) << " " << cur.counters.Get(i) << " instead of " << ref.counters.Get(i);
+        problems.push_back(problem.str());
+      }
+    }
+
+    if(problems.size()){
+      ++nFailed;
+      cout << "Regression: event " << ref.entry << " FAILED:";
+      for(const string &problem: problems)
+        cout << " " << problem << ";";
+      cout << endl;
+    }
+  }
+
+  if(countersSkipped){
+    cout << "Regression: counters not compared (missing in one of the files):";
+    for(int i = 0; i < StageCounters::N_COUNTERS; ++i){
+      if(countersSkipped & (1u << i))
+        cout << " " << StageCounters::GetName(i);
+    }
+    cout << endl;
+  }
+  cout << "Regression: " << reference.size() - nFailed << "/" << reference.size() << " events passed, largest weight deviation " << maxPull << " sigma." << endl;
+
+  return nFailed;
+}
@@ -0,0 +1,51 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+#include "splineTF.h"
+#include "binnedTF.h"
+#include "tableCache.h"
+
+#include "TH2.h"
+#include "TFile.h"
+
+SplineTF::SplineTF(const std::string particleName, const std::string histName, TFile* file) : _particleName(particleName) {
+
+  TableView table;
+  if(!BinnedTF::ReadHistogram(file, histName, _ownValues, table)){
+    std::cerr << "Error when defining spline TF for particle " << particleName << ": unable to retrieve " << histName << " from file " << file->GetPath() << ".\n";
+    exit(1);
+  }
+
+  std::cout << "Creating spline TF component for " << particleName << " from histogram " << histName << ".\n";
+
+  SetTable(table);
+}
+
+SplineTF::SplineTF(const std::string particleName, const TableView &table) : _particleName(particleName) {
+  std::cout << "Creating spline TF component for " << particleName << " from table cache.\n";
+
+  SetTable(table);
+}
+
+void SplineTF::SetTable(const TableView &table){
+  _EgenMin = table.xMin;
+  _EgenMax = table.xMax;
+  _deltaMin = table.yMin;
+  _deltaMax = table.yMax;
+  _nEgen = table.nx;
+  _nDelta = table.ny;
+  _EgenWidth = (_EgenMax - _EgenMin)/_nEgen;
+  _deltaWidth = (_deltaMax - _deltaMin)/_nDelta;
+  _values = table.values;
+
+  _cdfs = DeltaSampler::ComputeCDFs(_values, _nEgen, _nDelta, _deltaWidth);
+
+  std::cout << "Delta range is " << _deltaMax - _deltaMin << ", min. and max. values are " << _EgenMin << ", " << _EgenMax << std::endl << std::endl;
+}
+
+void SplineTF::FillSampler(const double &Erec, DeltaSampler &sampler) const {
+  const int slice = std::min(std::max(static_cast<int>((Erec - _EgenMin)/_EgenWidth), 0), _nEgen - 1);
+  sampler.SetFromCDF(&_cdfs[slice*(_nDelta+1)], _nDelta, _deltaMin, _deltaWidth, GetDeltaMin(Erec), GetDeltaMax(Erec));
+}
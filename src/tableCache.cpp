@@ -0,0 +1,191 @@
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cerrno>
+#include <stdlib.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "tableCache.h"
+
+using namespace std;
+
+static const char cacheMagic[8] = { 'M', 'E', 'M', 'C', 'A', 'C', 'H', 'E' };
+
+static uint64_t fnv1a(const char *data, const size_t size){
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for(size_t i = 0; i < size; ++i){
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+TableCache::TableCache(const std::string &fileName):
+  _fileName(fileName),
+  _data(nullptr),
+  _size(0){
+
+  const int fd = open(fileName.c_str(), O_RDONLY);
+  struct stat status;
+  if(fd < 0 || fstat(fd, &status) < 0){
+    cerr << "Error opening table cache " << fileName << ": " << strerror(errno) << ".\n";
+    exit(1);
+  }
+  _size = status.st_size;
+
+  if(_size < sizeof(TableCacheHeader)){
+    cerr << "Error: " << fileName << " is not a table cache (too small).\n";
+    exit(1);
+  }
+
+  void *data = mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(data == MAP_FAILED){
+    cerr << "Error mapping table cache " << fileName << ": " << strerror(errno) << ".\n";
+    exit(1);
+  }
+  _data = static_cast<const char*>(data);
+
+  const TableCacheHeader *header = reinterpret_cast<const TableCacheHeader*>(_data);
+  if(memcmp(header->magic, cacheMagic, sizeof(cacheMagic)) != 0){
+    cerr << "Error: " << fileName << " is not a table cache.\n";
+    exit(1);
+  }
+  if(header->version != version){
+    cerr << "Error: table cache " << fileName << " has version " << header->version << ", expected " << version << ". Please recompile it with tools/compile_cache.\n";
+    exit(1);
+  }
+  if(header->size != _size || _size < sizeof(TableCacheHeader) + header->nTables*sizeof(TableCacheEntry)){
+    cerr << "Error: table cache " << fileName << " is truncated.\n";
+    exit(1);
+  }
+  if(fnv1a(_data + sizeof(TableCacheHeader), _size - sizeof(TableCacheHeader)) != header->checksum){
+    cerr << "Error: wrong checksum for table cache " << fileName << ".\n";
+    exit(1);
+  }
+
+  const TableCacheEntry *entries = reinterpret_cast<const TableCacheEntry*>(_data + sizeof(TableCacheHeader));
+  for(uint32_t i = 0; i < header->nTables; ++i){
+    const TableCacheEntry &entry = entries[i];
+    const uint64_t nValues = static_cast<uint64_t>(entry.nx)*entry.ny;
+    if(entry.nx < 1 || entry.ny < 1 || entry.offset % sizeof(double) || entry.offset + nValues*sizeof(double) > _size){
+      cerr << "Error: invalid table " << i << " in table cache " << fileName << ".\n";
+      exit(1);
+    }
+
+    const string name(entry.name, strnlen(entry.name, sizeof(entry.name)));
+    _tables[name] = { entry.nx, entry.ny, entry.xMin, entry.xMax, entry.yMin, entry.yMax, reinterpret_cast<const double*>(_data + entry.offset) };
+  }
+
+  cout << "Mapped table cache " << fileName << " (version " << version << ", " << _tables.size() << " tables, " << _size << " bytes)" << endl;
+}
+
+TableCache::~TableCache(){
+  if(_data)
+    munmap(const_cast<char*>(_data), _size);
+  _data = nullptr;
+}
+
+bool TableCache::IsCacheFile(const std::string &fileName){
+  ifstream file(fileName, ios::binary);
+  char magic[sizeof(cacheMagic)];
+  if(!file.read(magic, sizeof(magic)))
+    return false;
+  return memcmp(magic, cacheMagic, sizeof(cacheMagic)) == 0;
+}
+
+bool TableCache::GetTable(const std::string &name, TableView &table) const {
+  const auto it = _tables.find(name);
+  if(it == _tables.end())
+    return false;
+  table = it->second;
+  return true;
+}
+
+bool TableCache::Write(const std::string &fileName, const std::vector<std::string> &names, const std::vector<TableView> &tables){
+  // Directory, then the values of each table
+  vector<TableCacheEntry> entries(tables.size());
+  uint64_t offset = sizeof(TableCacheHeader) + tables.size()*sizeof(TableCacheEntry);
+
+  for(size_t i = 0; i < tables.size(); ++i){
+    TableCacheEntry &entry = entries[i];
+    memset(&entry, 0, sizeof(entry));
+    if(names[i].size() >= sizeof(entry.name)){
+      cerr << "Error: table name " << names[i] << " is too long for the table cache.\n";
+      return false;
+    }
+    strncpy(entry.name, names[i].c_str(), sizeof(entry.name) - 1);
+    entry.nx = tables[i].nx;
+    entry.ny = tables[i].ny;
+    entry.xMin = tables[i].xMin;
+    entry.xMax = tables[i].xMax;
+    entry.yMin = tables[i].yMin;
+    entry.yMax = tables[i].yMax;
+    entry.offset = offset;
+    offset += static_cast<uint64_t>(entry.nx)*entry.ny*sizeof(double);
+  }
+
+  string body(reinterpret_cast<const char*>(entries.data()), entries.size()*sizeof(TableCacheEntry));
+  for(const TableView &table: tables)
+    body.append(reinterpret_cast<const char*>(table.values), static_cast<size_t>(table.nx)*table.ny*sizeof(double));
+
+  TableCacheHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+  header.version = version;
+  header.nTables = tables.size();
+  header.size = sizeof(TableCacheHeader) + body.size();
+  header.checksum = fnv1a(body.data(), body.size());
+
+  // Write to a temporary file and rename it, so that running jobs never map a partially written cache
+  const string tmpName = fileName + ".tmp";
+  ofstream file(tmpName, ios::binary | ios::trunc);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(body.data(), body.size());
+  file.close();
+  if(!file || rename(tmpName.c_str(), fileName.c_str()) != 0){
+    cerr << "Error writing table cache " << fileName << ".\n";
+    return false;
+  }
+
+  return true;
+}
+
+const std::vector<int> PdfTable::pids = { -5, -4, -3, -2, -1, 1, 2, 3, 4, 5, 21 };
+
+std::string PdfTable::GetTableName(const std::string &pdfName, const int member, const int pid){
+  ostringstream name;
+  name << "pdf:" << pdfName << ":" << member << ":" << pid;
+  return name.str();
+}
+
+bool PdfTable::Load(const TableCache &cache, const std::string &pdfName, const int member){
+  bool found = false;
+  _q2 = 0.;
+
+  for(int index = 0; index < 13; ++index)
+    _hasTable[index] = false;
+
+  for(const int pid: pids){
+    const int index = GetIndex(pid);
+    _hasTable[index] = cache.GetTable(GetTableName(pdfName, member, pid), _tables[index]);
+    if(_hasTable[index]){
+      if(found && _tables[index].yMin != _q2){
+        cerr << "Error: the PDF tables of " << pdfName << " in the table cache have different scales.\n";
+        exit(1);
+      }
+      _q2 = _tables[index].yMin;
+      found = true;
+    }
+  }
+
+  return found;
+}
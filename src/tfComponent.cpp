@@ -0,0 +1,77 @@
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "tfComponent.h"
+
+using namespace std;
+
+void DeltaSampler::SetUniform(const double rangeMin, const double rangeMax){
+  _edges.assign({ rangeMin, rangeMax });
+  _cumulative.assign({ 0., 1. });
+}
+
+void DeltaSampler::SetFromCDF(const double *cdf, const int nBins, const double histMin, const double width,
+                              const double rangeMin, const double rangeMax, const double uniformFraction){
+  const double range = rangeMax - rangeMin;
+  if(!(range > 0.)){
+    SetUniform(rangeMin, rangeMax);
+    return;
+  }
+
+  // Cumulative distribution of the slice at any delta (linear inside the bins)
+  auto cdfAt = [&](const double delta){
+    const double t = (delta - histMin)/width;
+    if(t <= 0.)
+      return cdf[0];
+    if(t >= nBins)
+      return cdf[nBins];
+    const int bin = static_cast<int>(t);
+    return cdf[bin] + (t - bin)*(cdf[bin+1] - cdf[bin]);
+  };
+
+  // Segments: the bins inside the range, cut at the range boundaries
+  _edges.clear();
+  _edges.push_back(rangeMin);
+  for(int k = max(static_cast<int>(floor((rangeMin - histMin)/width)) + 1, 0); k < nBins; ++k){
+    const double edge = histMin + k*width;
+    if(edge >= rangeMax)
+      break;
+    if(edge > rangeMin)
+      _edges.push_back(edge);
+  }
+  _edges.push_back(rangeMax);
+
+  const double content = cdfAt(rangeMax) - cdfAt(rangeMin);
+  if(!(content > 0.)){
+    SetUniform(rangeMin, rangeMax);
+    return;
+  }
+
+  _cumulative.resize(_edges.size());
+  _cumulative[0] = 0.;
+  for(size_t k = 0; k + 1 < _edges.size(); ++k){
+    const double probability = (1. - uniformFraction)*(cdfAt(_edges[k+1]) - cdfAt(_edges[k]))/content + uniformFraction*(_edges[k+1] - _edges[k])/range;
+    _cumulative[k+1] = _cumulative[k] + probability;
+  }
+  // Remove the rounding errors
+  for(double &c: _cumulative)
+    c /= _cumulative.back();
+}
+
+vector<double> DeltaSampler::ComputeCDFs(const double *values, const int nSlices, const int nBins, const double width){
+  vector<double> cdfs(nSlices*(nBins+1), 0.);
+
+  for(int i = 0; i < nSlices; ++i){
+    double *cdf = &cdfs[i*(nBins+1)];
+    for(int j = 0; j < nBins; ++j)
+      cdf[j+1] = cdf[j] + max(values[i*nBins + j], 0.)*width;
+    if(cdf[nBins] > 0.){
+      const double norm = cdf[nBins];
+      for(int j = 0; j <= nBins; ++j)
+        cdf[j] /= norm;
+    }
+  }
+
+  return cdfs;
+}
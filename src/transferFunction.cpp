@@ -5,9 +5,14 @@
 #include "TFile.h"
 
 #include "transferFunction.h"
+#include "tfComponent.h"
 #include "binnedTF.h"
+#include "splineTF.h"
+#include "doubleGaussianTF.h"
+#include "tableCache.h"
 
-TransferFunction::TransferFunction(const std::string file){
+TransferFunction::TransferFunction(const std::string file):
+  _cache(nullptr){
   _file = new TFile(file.c_str(), "READ");
   
   if( _file->IsZombie() ){
@@ -16,6 +21,11 @@ TransferFunction::TransferFunction(const std::string file){
   }
 }
 
+TransferFunction::TransferFunction(const TableCache &cache):
+  _file(nullptr),
+  _cache(&cache){
+}
+
 TransferFunction::~TransferFunction(){
   for(auto &i: _TF){
     delete i.second; i.second = nullptr;
@@ -23,14 +33,42 @@ TransferFunction::~TransferFunction(){
   delete _file; _file = nullptr;
 }
   
-void TransferFunction::DefineComponent(const std::string particleName, const std::string histName){
+void TransferFunction::DefineComponent(const std::string particleName, const std::string name, const TFComponent::Type type){
   if( _TF.find(particleName) != _TF.end() ){
     std::cerr << "Error: TF component for " << particleName << " is already defined!" << std::endl;
     exit(1);
   }
 
-  std::cout << "Adding TF component for " << particleName << " from histogram " << histName << ".\n";
+  // From the table cache, the histograms are used in place
+  TableView table;
+  if(_cache && type != TFComponent::DOUBLE_GAUSSIAN && !_cache->GetTable(name, table)){
+    std::cerr << "Error: histogram " << name << " for TF component " << particleName << " is not in the table cache." << std::endl;
+    exit(1);
+  }
 
-  _TF[particleName] = new BinnedTF(particleName, histName, _file);
+  switch(type){
+    case TFComponent::BINNED:
+      std::cout << "Adding TF component for " << particleName << " from histogram " << name << ".\n";
+      _TF[particleName] = _cache ? new BinnedTF(particleName, table) : new BinnedTF(particleName, name, _file);
+      break;
+    case TFComponent::SPLINE:
+      std::cout << "Adding spline TF component for " << particleName << " from histogram " << name << ".\n";
+      _TF[particleName] = _cache ? new SplineTF(particleName, table) : new SplineTF(particleName, name, _file);
+      break;
+    case TFComponent::DOUBLE_GAUSSIAN:
+      std::cout << "Adding double-Gaussian TF component for " << particleName << " with parameters " << name << ".\n";
+      _TF[particleName] = new DoubleGaussianTF(particleName, name);
+      break;
+  }
 }
 
+
+const TFComponent* TransferFunction::GetComponent(const std::string &particleName) const {
+  const auto it = _TF.find(particleName);
+  if( it == _TF.end() ){
+    std::cerr << "Error: TF component for " << particleName << " is not defined!" << std::endl;
+    exit(1);
+  }
+
+  return it->second;
+}
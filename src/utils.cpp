@@ -1,4 +1,5 @@
 #include <vector>
+#include <algorithm>
 #include <iostream>
 #define _USE_MATH_DEFINES // include M_PI constant
 #include <cmath>
@@ -8,6 +9,8 @@
 
 using namespace std;
 
+ISA_TARGET_BEGIN
+
 unsigned int setFlags(char verbosity, bool subregion, bool retainStateFile, unsigned int level, bool smoothing, bool takeOnlyGridFromFile){
   unsigned int flags = 0;
 
@@ -273,6 +276,140 @@ bool solve2Quads(const double a20, const double a02, const double a11, const dou
   return true;
 }
 
+// Value of the conic a20*x^2 + a02*y^2 + a11*x*y + a10*x + a01*y + a00, and its residual relative to the size of the terms
+static inline double conicResidual(const double a20, const double a02, const double a11, const double a10, const double a01, const double a00,
+                                   const double x, const double y){
+  const double value = a20*SQ(x) + a02*SQ(y) + a11*x*y + a10*x + a01*y + a00;
+  const double scale = fabs(a20*SQ(x)) + fabs(a02*SQ(y)) + fabs(a11*x*y) + fabs(a10*x) + fabs(a01*y) + fabs(a00);
+  if(scale == 0.)
+    return 0.;
+  return fabs(value)/scale;
+}
+
+double polish2Quads(const double a20, const double a02, const double a11, const double a10, const double a01, const double a00,
+                    const double b20, const double b02, const double b11, const double b10, const double b01, const double b00,
+                    double &e1, double &e2,
+                    const int maxIterations){
+
+  double residual = max(conicResidual(a20, a02, a11, a10, a01, a00, e1, e2), conicResidual(b20, b02, b11, b10, b01, b00, e1, e2));
+
+  for(int i = 0; i < maxIterations && residual > 0.; ++i){
+    const double f = a20*SQ(e1) + a02*SQ(e2) + a11*e1*e2 + a10*e1 + a01*e2 + a00;
+    const double g = b20*SQ(e1) + b02*SQ(e2) + b11*e1*e2 + b10*e1 + b01*e2 + b00;
+    const double f1 = 2.*a20*e1 + a11*e2 + a10;
+    const double f2 = 2.*a02*e2 + a11*e1 + a01;
+    const double g1 = 2.*b20*e1 + b11*e2 + b10;
+    const double g2 = 2.*b02*e2 + b11*e1 + b01;
+
+    const double det = f1*g2 - f2*g1;
+    if(det == 0. || !std::isfinite(det))
+      break;
+
+    const double new1 = e1 - (f*g2 - g*f2)/det;
+    const double new2 = e2 - (g*f1 - f*g1)/det;
+    const double newResidual = max(conicResidual(a20, a02, a11, a10, a01, a00, new1, new2), conicResidual(b20, b02, b11, b10, b01, b00, new1, new2));
+
+    // Keep the best point: near a tangency Newton's method can move away from the intersection
+    if(!(newResidual < residual))
+      break;
+    e1 = new1;
+    e2 = new2;
+    residual = newResidual;
+  }
+
+  return residual;
+}
+
+// Polish the solutions found by solve2Quads, and keep only the finite ones with a small enough residual.
+// Double roots are kept twice, as in solve2Quads.
+static int polishSolutions(const double a20, const double a02, const double a11, const double a10, const double a01, const double a00,
+                           const double b20, const double b02, const double b11, const double b10, const double b01, const double b00,
+                           const std::vector<double>& E1, const std::vector<double>& E2,
+                           std::vector<double>& polished1, std::vector<double>& polished2,
+                           const double maxResidual){
+  int nRejected = 0;
+
+  for(size_t i = 0; i < E1.size() && i < E2.size(); ++i){
+    double e1 = E1[i], e2 = E2[i];
+    const double residual = polish2Quads(a20, a02, a11, a10, a01, a00, b20, b02, b11, b10, b01, b00, e1, e2);
+
+    if(!std::isfinite(e1) || !std::isfinite(e2) || !(residual <= maxResidual)){
+      ++nRejected;
+      continue;
+    }
+
+    polished1.push_back(e1);
+    polished2.push_back(e2);
+  }
+
+  return nRejected;
+}
+
+// Below this relative size of the E1^2 coefficients, solve2QuadsPolished also eliminates E2^2
+static const double minCondition = 1e-4;
+
+// Number of different solutions (up to the precision of the polishing)
+static int countDistinct(const std::vector<double>& E1, const std::vector<double>& E2){
+  int nDistinct = 0;
+  for(size_t i = 0; i < E1.size(); ++i){
+    bool found = false;
+    for(size_t j = 0; j < i && !found; ++j)
+      found = fabs(E1[i] - E1[j]) <= 1e-6*fabs(E1[i]) && fabs(E2[i] - E2[j]) <= 1e-6*fabs(E2[i]);
+    if(!found)
+      ++nDistinct;
+  }
+  return nDistinct;
+}
+
+bool solve2QuadsPolished(const double a20, const double a02, const double a11, const double a10, const double a01, const double a00,
+                         const double b20, const double b02, const double b11, const double b10, const double b01, const double b00,
+                         std::vector<double>& E1, std::vector<double>& E2,
+                         int &nRejected,
+                         const double maxResidual){
+
+  nRejected = 0;
+
+  const double coefs[12] = { a20, a02, a11, a10, a01, a00, b20, b02, b11, b10, b01, b00 };
+  for(int i = 0; i < 12; ++i){
+    if(!std::isfinite(coefs[i]))
+      return false;
+  }
+
+  vector<double> raw1, raw2, polished1, polished2;
+  solve2Quads(a20, a02, a11, a10, a01, a00, b20, b02, b11, b10, b01, b00, raw1, raw2, false);
+  nRejected = polishSolutions(a20, a02, a11, a10, a01, a00, b20, b02, b11, b10, b01, b00, raw1, raw2, polished1, polished2, maxResidual);
+
+  // Eliminating E1^2 is ill-conditioned if its coefficients are tiny compared to the other terms of both conics
+  // (solve2Quads swaps E1 and E2 itself if they vanish exactly): some solutions have a huge E1, and a root can be
+  // lost, polishing to another one
+  const double scaleA = fabs(a20) + fabs(a02) + fabs(a11) + fabs(a10) + fabs(a01) + fabs(a00);
+  const double scaleB = fabs(b20) + fabs(b02) + fabs(b11) + fabs(b10) + fabs(b01) + fabs(b00);
+  const double condition1 = max(fabs(a20)/scaleA, fabs(b20)/scaleB);
+  const double condition2 = max(fabs(a02)/scaleA, fabs(b02)/scaleB);
+  const bool illConditioned = condition1 > 0. && condition1 < minCondition && condition2 > condition1;
+
+  if(nRejected || illConditioned){
+    // Eliminate E2^2 instead of E1^2, and keep whichever gives more distinct solutions
+    // (a lost root polishes to another one), or more solutions if equal
+    vector<double> swapped1, swapped2, swappedPolished1, swappedPolished2;
+    solve2Quads(a02, a20, a11, a01, a10, a00, b02, b20, b11, b01, b10, b00, swapped2, swapped1, false);
+    const int nSwappedRejected = polishSolutions(a20, a02, a11, a10, a01, a00, b20, b02, b11, b10, b01, b00, swapped1, swapped2, swappedPolished1, swappedPolished2, maxResidual);
+
+    const int nDistinct = countDistinct(polished1, polished2);
+    const int nSwappedDistinct = countDistinct(swappedPolished1, swappedPolished2);
+    if(nSwappedDistinct > nDistinct || (nSwappedDistinct == nDistinct && swappedPolished1.size() > polished1.size())){
+      polished1.swap(swappedPolished1);
+      polished2.swap(swappedPolished2);
+      nRejected = nSwappedRejected;
+    }
+  }
+
+  E1.insert(E1.end(), polished1.begin(), polished1.end());
+  E2.insert(E2.end(), polished2.begin(), polished2.end());
+
+  return polished1.size() > 0;
+}
+
 bool solve2QuadsDeg(const double a11, const double a10, const double a01, const double a00,
                     const double b11, const double b10, const double b01, const double b00,
                     vector<double>& E1, vector<double>& E2, 
@@ -385,3 +522,4 @@ double BreitWigner(const double s, const double m, const double g){
   return k/(pow(s-m*m,2.) + pow(m*g,2.));
 }
 
+ISA_TARGET_END
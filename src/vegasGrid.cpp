@@ -0,0 +1,206 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+
+#include "TMath.h"
+
+#include "vegasGrid.h"
+
+using namespace std;
+
+VegasGrid::VegasGrid(const int nDim, const int nBins):
+  _nDim(nDim),
+  _nBins(nBins),
+  _edges((nBins+1)*nDim, 0.),
+  _widths(nBins*nDim, 0.){
+
+  Reset();
+}
+
+void VegasGrid::Reset(){
+  for(int d = 0; d < _nDim; ++d){
+    for(int b = 0; b <= _nBins; ++b)
+      _edges[(_nBins+1)*d + b] = static_cast<double>(b)/_nBins;
+    for(int b = 0; b < _nBins; ++b)
+      _widths[_nBins*d + b] = 1./_nBins;
+  }
+}
+
+void VegasGrid::MapBlock(const int n, const double *y, double *x, int *bins, double *jacobian) const {
+  for(int k = 0; k < n; ++k)
+    jacobian[k] = 1.;
+
+  for(int d = 0; d < _nDim; ++d){
+    const double *edges = &_edges[(_nBins+1)*d];
+    const double *widths = &_widths[_nBins*d];
+    const double *yd = &y[d*n];
+    double *xd = &x[d*n];
+    int *binsd = &bins[d*n];
+
+    for(int k = 0; k < n; ++k){
+      const double t = yd[k]*_nBins;
+      const int bin = std::min(static_cast<int>(t), _nBins-1);
+      const double width = widths[bin];
+      xd[k] = edges[bin] + (t - bin)*width;
+      jacobian[k] *= _nBins*width;
+      binsd[k] = bin;
+    }
+  }
+}
+
+void VegasGrid::Refine(const vector<double> &binVariance, const double alpha){
+  // Smoothen the contributions of the bins, damp them, and move the edges
+  // so that all new bins have the same (damped) contribution
+  vector<double> smooth(_nBins), importance(_nBins);
+  vector<double> newEdges(_nBins+1);
+
+  for(int d = 0; d < _nDim; ++d){
+    const double *var = &binVariance[_nBins*d];
+    double *edges = &_edges[(_nBins+1)*d];
+
+    smooth[0] = (3.*var[0] + var[1])/4.;
+    for(int b = 1; b < _nBins-1; ++b)
+      smooth[b] = (var[b-1] + 2.*var[b] + var[b+1])/4.;
+    smooth[_nBins-1] = (var[_nBins-2] + 3.*var[_nBins-1])/4.;
+
+    double sum = 0.;
+    for(int b = 0; b < _nBins; ++b)
+      sum += smooth[b];
+    if(!(sum > 0.))
+      continue;
+
+    double sumImportance = 0.;
+    for(int b = 0; b < _nBins; ++b){
+      const double fraction = smooth[b]/sum;
+      if(fraction <= 0.)
+        importance[b] = 0.;
+      else if(fraction >= 1.)
+        importance[b] = 1.;
+      else
+        importance[b] = pow((fraction - 1.)/log(fraction), alpha);
+      sumImportance += importance[b];
+    }
+
+    const double average = sumImportance/_nBins;
+    double accumulated = 0.;
+    int j = 0;
+    newEdges[0] = 0.;
+    for(int b = 1; b < _nBins; ++b){
+      const double target = b*average;
+      while(j < _nBins-1 && accumulated + importance[j] < target){
+        accumulated += importance[j];
+        ++j;
+      }
+      const double fraction = importance[j] > 0. ? min(1., (target - accumulated)/importance[j]) : 0.;
+      newEdges[b] = edges[j] + fraction*(edges[j+1] - edges[j]);
+    }
+    newEdges[_nBins] = 1.;
+
+    copy(newEdges.begin(), newEdges.end(), edges);
+    for(int b = 0; b < _nBins; ++b)
+      _widths[_nBins*d + b] = edges[b+1] - edges[b];
+  }
+}
+
+bool VegasGrid::Save(const string &fileName) const {
+  ofstream file(fileName);
+  if(!file.is_open()){
+    cerr << "Warning: could not write Vegas grid to " << fileName << "." << endl;
+    return false;
+  }
+
+  file.precision(17);
+  file << "VegasGrid " << _nDim << " " << _nBins << endl;
+  for(int d = 0; d < _nDim; ++d){
+    for(int b = 0; b <= _nBins; ++b)
+      file << (b ? " " : "") << _edges[(_nBins+1)*d + b];
+    file << endl;
+  }
+
+  return file.good();
+}
+
+bool VegasGrid::Load(const string &fileName){
+  ifstream file(fileName);
+  string header;
+  int nDim = 0, nBins = 0;
+  if(!(file >> header >> nDim >> nBins) || header != "VegasGrid"){
+    cerr << "Warning: " << fileName << " is not a Vegas grid file." << endl;
+    return false;
+  }
+  if(nDim != _nDim || nBins != _nBins){
+    cerr << "Warning: Vegas grid in " << fileName << " has " << nDim << " dimensions and " << nBins << " bins, expected " << _nDim << " and " << _nBins << "." << endl;
+    return false;
+  }
+
+  vector<double> edges(_edges.size());
+  for(double &edge: edges){
+    if(!(file >> edge)){
+      cerr << "Warning: Vegas grid in " << fileName << " is incomplete." << endl;
+      return false;
+    }
+  }
+  for(int d = 0; d < _nDim; ++d){
+    for(int b = 0; b < _nBins; ++b){
+      if(!(edges[(_nBins+1)*d + b + 1] >= edges[(_nBins+1)*d + b])){
+        cerr << "Warning: Vegas grid in " << fileName << " has decreasing edges." << endl;
+        return false;
+      }
+    }
+  }
+
+  _edges = edges;
+  for(int d = 0; d < _nDim; ++d){
+    for(int b = 0; b < _nBins; ++b)
+      _widths[_nBins*d + b] = _edges[(_nBins+1)*d + b + 1] - _edges[(_nBins+1)*d + b];
+  }
+
+  return true;
+}
+
+void IterationResults::Add(const double mean, const double variance){
+  _means.push_back(mean);
+  _variances.push_back(variance);
+
+  if(variance <= 0.){
+    _exactMin = _nExact ? min(_exactMin, mean) : mean;
+    _exactMax = _nExact ? max(_exactMax, mean) : mean;
+    _exactSum += mean;
+    ++_nExact;
+    return;
+  }
+
+  _sumWeights += 1./variance;
+  _sumWeighted += mean/variance;
+}
+
+double IterationResults::GetResult() const {
+  if(_sumWeights > 0.)
+    return _sumWeighted/_sumWeights;
+  return _nExact ? _exactSum/_nExact : 0.;
+}
+
+double IterationResults::GetError() const {
+  if(_sumWeights > 0.)
+    return sqrt(1./_sumWeights);
+  // Only iterations with a vanishing variance: their spread
+  return 0.5*(_exactMax - _exactMin);
+}
+
+double IterationResults::GetProb() const {
+  const int nIterations = _means.size() - _nExact;
+  if(nIterations < 2)
+    return 0.;
+
+  const double result = GetResult();
+  double chi2 = 0.;
+  for(size_t k = 0; k < _means.size(); ++k){
+    if(_variances[k] > 0.)
+      chi2 += pow(_means[k] - result, 2)/_variances[k];
+  }
+
+  return 1. - TMath::Prob(chi2, nIterations - 1);
+}
@@ -0,0 +1,203 @@
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <atomic>
+
+#include "vegasIntegrator.h"
+#include "vegasGrid.h"
+#include "quasiRandom.h"
+
+using namespace std;
+
+const double VegasIntegrator::_beta = 0.75;
+
+VegasIntegrator::VegasIntegrator(const int nDim, const int nThreads, const uint64_t seed):
+  _nDim(nDim),
+  _nThreads(max(1, nThreads)),
+  _seed(seed),
+  _nCalls(0),
+  _grid(nDim),
+  _initialGrid(nDim),
+  _integrand(nullptr),
+  _userData(nullptr),
+  _nComp(0),
+  _nStrat(1),
+  _iterationSeed(0){
+}
+
+void VegasIntegrator::SampleCubes(const int first, const int last, const int thread, BatchResults &batch){
+  const int nBins = _grid.GetNumberOfBins();
+  const double cubeVolume = pow(_nStrat, -_nDim);
+  vector<double> y(_blockSize*_nDim), x(_blockSize*_nDim), jacobians(_blockSize), points(_blockSize*_nDim), weights(_blockSize), f(_blockSize*_nComp);
+  vector<int> bins(_blockSize*_nDim), coordinates(_nDim);
+
+  for(int h = first; h < last; ++h){
+    int index = h;
+    for(int d = 0; d < _nDim; ++d){
+      coordinates[d] = index % _nStrat;
+      index /= _nStrat;
+    }
+
+    // The random numbers only depend on the iteration, the sub-cube and the point
+    const uint64_t cubeSeed = mixSeed(_iterationSeed + h);
+    const int n = _nPoints[h];
+
+    for(int start = 0; start < n; start += _blockSize){
+      const int m = min(_blockSize, n - start);
+
+      for(int d = 0; d < _nDim; ++d){
+        for(int k = 0; k < m; ++k){
+          const double u = ((mixSeed(cubeSeed + static_cast<uint64_t>(start + k)*_nDim + d) >> 11) + 0.5) * (1./9007199254740992.);
+          y[d*m + k] = (coordinates[d] + u)/_nStrat;
+        }
+      }
+
+      _grid.MapBlock(m, y.data(), x.data(), bins.data(), jacobians.data());
+
+      // The whole block is passed to the integrand, with the points as rows
+      for(int k = 0; k < m; ++k){
+        for(int d = 0; d < _nDim; ++d)
+          points[k*_nDim + d] = x[d*m + k];
+        weights[k] = jacobians[k]*cubeVolume/n;
+      }
+
+      _integrand(&_nDim, points.data(), &_nComp, f.data(), _userData, &m, &thread, weights.data());
+
+      for(int k = 0; k < m; ++k){
+        double absSum = 0.;
+        for(int c = 0; c < _nComp; ++c){
+          const double value = std::isnan(f[k*_nComp + c]) ? 0. : f[k*_nComp + c]*jacobians[k];
+          _sums[h*_nComp + c] += value;
+          _sums2[h*_nComp + c] += value*value;
+          absSum += fabs(value);
+        }
+        _sumsAbs[h] += absSum;
+        _sumsAbs2[h] += absSum*absSum;
+
+        // Contribution of the point to the variance, used to refine the grid
+        const double contribution = absSum*cubeVolume;
+        for(int d = 0; d < _nDim; ++d)
+          batch.binVariance[nBins*d + bins[d*m + k]] += contribution*contribution/n;
+      }
+    }
+  }
+}
+
+int VegasIntegrator::Integrate(SamplingIntegrand integrand, void *userData, const int nComp, const int maxEval, const int nStart, const double relAccuracy, const double absAccuracy, double *result, double *error, double *prob){
+
+  _integrand = integrand;
+  _userData = userData;
+  _nComp = nComp;
+  _grid = _initialGrid;
+  const int nBins = _grid.GetNumberOfBins();
+
+  // As in Lepage's implementation, about 4 points per sub-cube on average (at least 2 are needed for the variance)
+  _nStrat = max(1, static_cast<int>(floor(pow(nStart/4., 1./_nDim))));
+  int nCubes = 1;
+  for(int d = 0; d < _nDim; ++d)
+    nCubes *= _nStrat;
+  const double cubeVolume = 1./nCubes;
+
+  _nPoints.assign(nCubes, max(2, nStart/nCubes));
+  _sums.resize(nCubes*nComp);
+  _sums2.resize(nCubes*nComp);
+  _sumsAbs.resize(nCubes);
+  _sumsAbs2.resize(nCubes);
+
+  // Batch b contains the sub-cubes b*nCubes/nBatches to (b+1)*nCubes/nBatches-1
+  const int nBatches = min(nCubes, _nBatches);
+  vector<BatchResults> batches(nBatches);
+  vector<double> binVariance(nBins*_nDim);
+  vector<double> allocation(nCubes);
+  vector<IterationResults> iterations(nComp);
+
+  const uint64_t callSeed = mixSeed(_seed ^ mixSeed(_nCalls++));
+  int nEval = 0;
+
+  for(int iteration = 0; ; ++iteration){
+    int iterationEval = 0;
+    for(const int n: _nPoints)
+      iterationEval += n;
+    if(iteration > 0 && nEval + iterationEval > maxEval)
+      break;
+
+    _iterationSeed = mixSeed(callSeed ^ mixSeed(iteration));
+    fill(_sums.begin(), _sums.end(), 0.);
+    fill(_sums2.begin(), _sums2.end(), 0.);
+    fill(_sumsAbs.begin(), _sumsAbs.end(), 0.);
+    fill(_sumsAbs2.begin(), _sumsAbs2.end(), 0.);
+    for(BatchResults &batch: batches)
+      batch.binVariance.assign(nBins*_nDim, 0.);
+
+    // Each thread takes the next batch which has not been processed yet
+    atomic<int> nextBatch(0);
+    auto worker = [&](const int thread){
+      for(int b = nextBatch++; b < nBatches; b = nextBatch++)
+        SampleCubes(static_cast<long>(b)*nCubes/nBatches, static_cast<long>(b+1)*nCubes/nBatches, thread, batches[b]);
+    };
+
+    if(_nThreads == 1){
+      worker(0);
+    }else{
+      vector<thread> threads;
+      for(int t = 0; t < _nThreads; ++t)
+        threads.emplace_back(worker, t);
+      for(thread &t: threads)
+        t.join();
+    }
+    nEval += iterationEval;
+
+    // The first iterations, with a poorly adapted grid, often have underestimated errors, which would bias
+    // the weighted average: they are only used to adapt the grid and allocation, unless no other iteration follows
+    if(iteration == _nWarmupIterations)
+      iterations.assign(nComp, IterationResults());
+
+    // All the sums are done in the order of the sub-cubes and batches
+    bool converged = true;
+    for(int c = 0; c < nComp; ++c){
+      double mean = 0., variance = 0.;
+      for(int h = 0; h < nCubes; ++h){
+        const int n = _nPoints[h];
+        const double cubeMean = _sums[h*nComp + c]/n;
+        mean += cubeVolume*cubeMean;
+        variance += cubeVolume*cubeVolume*max(0., _sums2[h*nComp + c]/n - cubeMean*cubeMean)/(n - 1);
+      }
+
+      iterations[c].Add(mean, variance);
+      result[c] = iterations[c].GetResult();
+      error[c] = iterations[c].GetError();
+      prob[c] = iterations[c].GetProb();
+
+      if(error[c] > max(relAccuracy*fabs(result[c]), absAccuracy))
+        converged = false;
+    }
+
+    if(converged && iteration >= _nWarmupIterations)
+      break;
+
+    // Refine the grid
+    fill(binVariance.begin(), binVariance.end(), 0.);
+    for(const BatchResults &batch: batches){
+      for(size_t i = 0; i < binVariance.size(); ++i)
+        binVariance[i] += batch.binVariance[i];
+    }
+    _grid.Refine(binVariance);
+
+    // New allocation of the points to the sub-cubes, proportional to sigma^beta
+    double sumAllocation = 0.;
+    for(int h = 0; h < nCubes; ++h){
+      const int n = _nPoints[h];
+      const double cubeMean = _sumsAbs[h]/n;
+      const double sigma = cubeVolume*sqrt(max(0., _sumsAbs2[h]/n - cubeMean*cubeMean));
+      allocation[h] = pow(sigma, _beta);
+      sumAllocation += allocation[h];
+    }
+    for(int h = 0; h < nCubes; ++h)
+      _nPoints[h] = sumAllocation > 0. ? max(2, static_cast<int>(nStart*allocation[h]/sumAllocation)) : max(2, nStart/nCubes);
+  }
+
+  return nEval;
+}
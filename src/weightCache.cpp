@@ -0,0 +1,171 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <algorithm>
+#include <stdlib.h>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "weightCache.h"
+#include "quasiRandom.h"
+
+using namespace std;
+
+#ifndef MEM_BUILD_ID
+#define MEM_BUILD_ID ""
+#endif
+
+// Entries written by another version of the format are ignored
+static const char* entryHeader = "MEMcpp weight cache 1";
+
+void ContentHash::AddWord(const uint64_t word){
+  _h1 = mixSeed(_h1 ^ word);
+  _h2 = mixSeed(_h2 + word*0x9fb21c651e98df25ULL);
+}
+
+void ContentHash::Add(const void *data, const size_t size){
+  const unsigned char *bytes = static_cast<const unsigned char*>(data);
+  for(size_t i = 0; i < size; i += 8){
+    uint64_t word = 0;
+    memcpy(&word, bytes + i, min(static_cast<size_t>(8), size - i));
+    AddWord(word);
+  }
+}
+
+void ContentHash::Add(const double value){
+  uint64_t word;
+  memcpy(&word, &value, sizeof(word));
+  AddWord(word);
+}
+
+void ContentHash::Add(const std::string &value){
+  AddWord(value.size());
+  Add(value.data(), value.size());
+}
+
+std::string ContentHash::GetHex() const {
+  char hex[33];
+  snprintf(hex, sizeof(hex), "%016llx%016llx", (unsigned long long) _h1, (unsigned long long) _h2);
+  return hex;
+}
+
+std::string HashFile(const std::string &fileName){
+  ifstream file(fileName, ios::binary);
+  if(!file)
+    return "";
+
+  ContentHash hash;
+  vector<char> buffer(1 << 20);
+  uint64_t size = 0;
+  while(file){
+    file.read(buffer.data(), buffer.size());
+    // Whole words, except at the end of the file
+    hash.Add(buffer.data(), file.gcount());
+    size += file.gcount();
+  }
+  hash.Add(size);
+  return hash.GetHex();
+}
+
+// Create the directory if needed (also if another process creates it at the same time)
+static bool makeDirectory(const std::string &path){
+  if(mkdir(path.c_str(), 0755) == 0 || errno == EEXIST)
+    return true;
+  cerr << "Error creating directory " << path << ": " << strerror(errno) << "." << endl;
+  return false;
+}
+
+WeightCache::WeightCache(const std::string &directory, const std::string &configuration):
+  _directory(directory),
+  _nHits(0),
+  _nMisses(0),
+  _nStored(0){
+
+  if(!makeDirectory(_directory))
+    exit(1);
+
+  ContentHash hash;
+  hash.Add(static_cast<uint64_t>(codeVersion));
+  hash.Add(GetBuildId());
+  hash.Add(configuration);
+  _configurationHash = hash.GetHex();
+}
+
+std::string WeightCache::GetBuildId(){
+  return MEM_BUILD_ID;
+}
+
+std::string WeightCache::GetKey(const MEPermutations &permutations, const long eventID) const {
+  ContentHash hash;
+  hash.Add(_configurationHash);
+  hash.Add(static_cast<uint64_t>(eventID));
+  hash.Add(static_cast<uint64_t>(permutations.GetNumberOfPermutations()));
+
+  for(size_t i = 0; i < permutations.GetNumberOfPermutations(); ++i){
+    const MEEvent &event = permutations.GetPermutation(i);
+    for(int particle = 3; particle <= 6; ++particle){
+      const FourVector &p = event.GetVector(particle);
+      hash.Add(p.px); hash.Add(p.py); hash.Add(p.pz); hash.Add(p.e);
+    }
+    const FourVector &met = event.GetMetVector();
+    hash.Add(met.px); hash.Add(met.py); hash.Add(met.pz); hash.Add(met.e);
+  }
+
+  return hash.GetHex();
+}
+
+std::string WeightCache::GetPath(const std::string &key) const {
+  return _directory + "/" + key.substr(0, 2) + "/" + key;
+}
+
+bool WeightCache::Lookup(const std::string &key, Result &result){
+  ifstream file(GetPath(key));
+  string header, fileKey;
+  size_t nMembers = 0;
+
+  bool valid = file && getline(file, header) && header == entryHeader;
+  valid = valid && (file >> fileKey) && fileKey == key;
+  valid = valid && (file >> result.weighted >> result.weight >> result.error >> result.time >> nMembers);
+  if(valid){
+    result.memberWeights.resize(nMembers);
+    result.memberErrors.resize(nMembers);
+    for(size_t i = 0; i < nMembers; ++i)
+      file >> result.memberWeights[i] >> result.memberErrors[i];
+    valid = !file.fail();
+  }
+
+  if(valid)
+    ++_nHits;
+  else
+    ++_nMisses;
+  return valid;
+}
+
+void WeightCache::Store(const std::string &key, const Result &result){
+  const string path = GetPath(key);
+  if(!makeDirectory(_directory + "/" + key.substr(0, 2)))
+    return;
+
+  // Unique temporary name, renamed atomically
+  ostringstream tmpPath;
+  tmpPath << path << ".tmp." << getpid() << "." << _nStored++;
+
+  ofstream file(tmpPath.str());
+  file.precision(17);
+  file << entryHeader << "\n" << key << "\n";
+  file << result.weighted << " " << result.weight << " " << result.error << " " << result.time << " " << result.memberWeights.size() << "\n";
+  for(size_t i = 0; i < result.memberWeights.size(); ++i)
+    file << result.memberWeights[i] << " " << result.memberErrors[i] << "\n";
+  file.close();
+
+  if(!file || rename(tmpPath.str().c_str(), path.c_str()) != 0){
+    cerr << "Warning: could not write the weight cache entry " << path << "." << endl;
+    unlink(tmpPath.str().c_str());
+  }
+}
@@ -0,0 +1,121 @@
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <stdlib.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "weightsIndex.h"
+
+using namespace std;
+
+static const char indexMagic[8] = { 'M', 'E', 'M', 'W', 'E', 'I', 'G', 'H' };
+
+static const uint64_t fnvOffset = 0xcbf29ce484222325ULL;
+
+static uint64_t fnv1a(const char *data, const size_t size, uint64_t hash = fnvOffset){
+  for(size_t i = 0; i < size; ++i){
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+WeightsIndexWriter::WeightsIndexWriter(const std::string &fileName, const long firstEntry):
+  _fileName(fileName){
+
+  memset(&_header, 0, sizeof(_header));
+  memcpy(_header.magic, indexMagic, sizeof(indexMagic));
+  _header.version = WeightsIndex::version;
+  _header.recordSize = sizeof(WeightsIndexRecord);
+  _header.firstEntry = firstEntry;
+  _header.checksum = fnvOffset;
+
+  // Written to a temporary file and renamed when complete; the header is written last
+  _file.open(_fileName + ".tmp", ios::binary | ios::trunc);
+  if(!_file){
+    cerr << "Error creating " << _fileName << ".tmp: " << strerror(errno) << ".\n";
+    exit(1);
+  }
+  _file.write(reinterpret_cast<const char*>(&_header), sizeof(_header));
+}
+
+void WeightsIndexWriter::Add(const WeightsIndexRecord &record){
+  _file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+  _header.checksum = fnv1a(reinterpret_cast<const char*>(&record), sizeof(record), _header.checksum);
+  ++_header.nEntries;
+  if(record.status == WEIGHTS_MISSING)
+    ++_header.nMissing;
+}
+
+bool WeightsIndexWriter::Close(){
+  _file.seekp(0);
+  _file.write(reinterpret_cast<const char*>(&_header), sizeof(_header));
+  _file.close();
+
+  const string tmpName = _fileName + ".tmp";
+  if(!_file || rename(tmpName.c_str(), _fileName.c_str()) != 0){
+    cerr << "Error writing " << _fileName << ".\n";
+    unlink(tmpName.c_str());
+    return false;
+  }
+  return true;
+}
+
+WeightsIndex::WeightsIndex(const std::string &fileName):
+  _fileName(fileName),
+  _data(nullptr),
+  _size(0){
+
+  const int fd = open(fileName.c_str(), O_RDONLY);
+  struct stat status;
+  if(fd < 0 || fstat(fd, &status) < 0){
+    cerr << "Error opening weights index " << fileName << ": " << strerror(errno) << ".\n";
+    exit(1);
+  }
+  _size = status.st_size;
+
+  if(_size < sizeof(WeightsIndexHeader)){
+    cerr << "Error: " << fileName << " is not a weights index (too small).\n";
+    exit(1);
+  }
+
+  void *data = mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(data == MAP_FAILED){
+    cerr << "Error mapping weights index " << fileName << ": " << strerror(errno) << ".\n";
+    exit(1);
+  }
+  _data = static_cast<const char*>(data);
+
+  _header = reinterpret_cast<const WeightsIndexHeader*>(_data);
+  _records = reinterpret_cast<const WeightsIndexRecord*>(_data + sizeof(WeightsIndexHeader));
+  if(memcmp(_header->magic, indexMagic, sizeof(indexMagic)) != 0){
+    cerr << "Error: " << fileName << " is not a weights index.\n";
+    exit(1);
+  }
+  if(_header->version != version || _header->recordSize != sizeof(WeightsIndexRecord)){
+    cerr << "Error: weights index " << fileName << " has version " << _header->version << ", expected " << version << ". Please merge the weights again with tools/merge_weights.\n";
+    exit(1);
+  }
+  if(_size != sizeof(WeightsIndexHeader) + _header->nEntries*sizeof(WeightsIndexRecord)){
+    cerr << "Error: weights index " << fileName << " is truncated.\n";
+    exit(1);
+  }
+  if(fnv1a(_data + sizeof(WeightsIndexHeader), _size - sizeof(WeightsIndexHeader)) != _header->checksum){
+    cerr << "Error: wrong checksum for weights index " << fileName << ".\n";
+    exit(1);
+  }
+}
+
+WeightsIndex::~WeightsIndex(){
+  if(_data)
+    munmap(const_cast<char*>(_data), _size);
+  _data = nullptr;
+}
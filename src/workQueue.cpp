@@ -0,0 +1,362 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <stdlib.h>
+#include <mutex>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "workQueue.h"
+
+using namespace std;
+
+static const char* statusNames[] = { "weighted", "not_weighted", "failed" };
+
+const char* GetQueueStatusName(const QueueStatus status){
+  return statusNames[status];
+}
+
+bool ParseQueueStatus(const std::string &name, QueueStatus &status){
+  for(int i = 0; i <= QUEUE_FAILED; ++i){
+    if(name == statusNames[i]){
+      status = static_cast<QueueStatus>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+static sockaddr_un makeAddress(const std::string &socketPath){
+  sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if(socketPath.size() >= sizeof(address.sun_path)){
+    cerr << "Error: socket path " << socketPath << " is too long.\n";
+    exit(1);
+  }
+  strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+  return address;
+}
+
+WorkQueueCoordinator::WorkQueueCoordinator(const std::string &socketPath, const long first, const long last, const long maxChunk, const std::string &resultFile):
+  _socketPath(socketPath),
+  _listenFd(-1),
+  _results(nullptr),
+  _maxChunk(max(maxChunk, 1L)),
+  _nEvents(0),
+  _nDone(0),
+  _nAssigned(0),
+  _nFailed(0),
+  _nConnections(0),
+  _defaultCost(1.),
+  _pendingCost(0.){
+
+  for(long entry = first; entry <= last; ++entry)
+    _pending.push_back(entry);
+  _nEvents = _pending.size();
+
+  _results = fopen(resultFile.c_str(), "a");
+  if(!_results){
+    cerr << "Error opening result file " << resultFile << ".\n";
+    exit(1);
+  }
+
+  _listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(_listenFd < 0){
+    cerr << "Error creating socket: " << strerror(errno) << ".\n";
+    exit(1);
+  }
+
+  const sockaddr_un address = makeAddress(socketPath);
+  unlink(socketPath.c_str());
+  if(bind(_listenFd, (const sockaddr*) &address, sizeof(address)) < 0 || listen(_listenFd, 64) < 0){
+    cerr << "Error listening on socket " << socketPath << ": " << strerror(errno) << ".\n";
+    exit(1);
+  }
+
+  cout << "Work queue: distributing " << _nEvents << " events on " << socketPath << endl;
+}
+
+WorkQueueCoordinator::~WorkQueueCoordinator(){
+  for(auto &worker: _workers)
+    close(worker.first);
+  if(_listenFd >= 0){
+    close(_listenFd);
+    unlink(_socketPath.c_str());
+  }
+  if(_results)
+    fclose(_results);
+}
+
+void WorkQueueCoordinator::SetPredictedCosts(const std::map<long, double> &costs){
+  _costs = costs;
+  
+  double sum = 0.;
+  for(const auto &cost: _costs)
+    sum += cost.second;
+  _defaultCost = _costs.size() ? sum/_costs.size() : 1.;
+
+  // Longest processing time first: the slow events don't end up at the end of the job
+  stable_sort(_pending.begin(), _pending.end(), [this](const long a, const long b){ return GetCost(a) > GetCost(b); });
+  _pendingCost = 0.;
+  for(const long entry: _pending)
+    _pendingCost += GetCost(entry);
+
+  if(_pending.size())
+    cout << "Work queue: predicted cost " << _pendingCost << " s, from " << GetCost(_pending.front()) << " s to " << GetCost(_pending.back()) << " s per event" << endl;
+}
+
+double WorkQueueCoordinator::GetCost(const long entry) const {
+  const auto cost = _costs.find(entry);
+  return cost != _costs.end() ? cost->second : _defaultCost;
+}
+
+void WorkQueueCoordinator::Run(){
+  
+  while(_nDone < _nEvents){
+    vector<pollfd> fds;
+    fds.push_back( { _listenFd, POLLIN, 0 } );
+    for(const auto &worker: _workers)
+      fds.push_back( { worker.first, POLLIN, 0 } );
+
+    // All the workers have left (nothing can be assigned then): wait a bit for new ones
+    const bool idle = _workers.empty() && _nConnections > 0;
+    const int nReady = poll(fds.data(), fds.size(), idle ? idleTimeout*1000 : -1);
+    if(nReady < 0){
+      if(errno == EINTR)
+        continue;
+      cerr << "Error in work queue: " << strerror(errno) << ".\n";
+      exit(1);
+    }
+    if(nReady == 0){
+      cerr << "Warning: no worker left in the work queue, recording the " << _pending.size() << " remaining events as failed.\n";
+      while(!_pending.empty()){
+        WriteResult(_pending.front(), 0., 0., 0., QUEUE_FAILED);
+        _pending.pop_front();
+      }
+      break;
+    }
+
+    if(fds[0].revents & POLLIN){
+      const int fd = accept(_listenFd, nullptr, nullptr);
+      if(fd >= 0){
+        _workers[fd] = WorkerState();
+        ++_nConnections;
+      }
+    }
+
+    for(size_t i = 1; i < fds.size(); ++i){
+      if(!fds[i].revents)
+        continue;
+
+      const int fd = fds[i].fd;
+      char buffer[4096];
+      const ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+      
+      if(n <= 0){
+        Disconnect(fd);
+        continue;
+      }
+
+      string &workerBuffer = _workers[fd].buffer;
+      workerBuffer.append(buffer, n);
+
+      size_t eol;
+      while(_workers.count(fd) && (eol = _workers[fd].buffer.find('\n')) != string::npos){
+        const string line = _workers[fd].buffer.substr(0, eol);
+        _workers[fd].buffer.erase(0, eol + 1);
+        ProcessLine(fd, line);
+      }
+    }
+  }
+
+  cout << "Work queue: all " << _nEvents << " events done";
+  if(_nFailed)
+    cout << ", " << _nFailed << " failed";
+  cout << "." << endl;
+}
+
+void WorkQueueCoordinator::ProcessLine(const int fd, const std::string &line){
+  istringstream stream(line);
+  string command;
+  stream >> command;
+
+  WorkerState &worker = _workers[fd];
+
+  if(command == "GET"){
+    if(_pending.empty()){
+      // Events which are still being processed might come back in the queue if a worker fails
+      Send(fd, _nAssigned ? "WAIT\n" : "DONE\n");
+      return;
+    }
+
+    // Guided scheduling: hand out a fraction of the remaining events (of their predicted cost if known),
+    // so that the chunks get smaller towards the end
+    const long nWorkers = _workers.size();
+    vector<long> chunk;
+    if(_costs.size()){
+      double chunkCost = 0.;
+      const double targetCost = _pendingCost / (2*nWorkers);
+      while(!_pending.empty() && (long) chunk.size() < _maxChunk && (chunk.empty() || chunkCost + GetCost(_pending.front()) <= targetCost)){
+        chunkCost += GetCost(_pending.front());
+        chunk.push_back(_pending.front());
+        _pending.pop_front();
+      }
+      _pendingCost = max(_pendingCost - chunkCost, 0.);
+    }else{
+      const long size = min( _maxChunk, max(1L, (long) _pending.size() / (2*nWorkers)) );
+      for(long i = 0; i < size; ++i){
+        chunk.push_back(_pending.front());
+        _pending.pop_front();
+      }
+    }
+
+    ostringstream message;
+    message << "CHUNK " << chunk.size();
+    for(const long entry: chunk){
+      worker.assigned.insert(entry);
+      ++_attempts[entry];
+      message << " " << entry;
+    }
+    message << "\n";
+    _nAssigned += chunk.size();
+    
+    Send(fd, message.str());
+  
+  }else if(command == "RESULT"){
+    long entry;
+    double weight, error, time;
+    string statusName;
+    stream >> entry >> weight >> error >> time >> statusName;
+    QueueStatus status;
+    if(!ParseQueueStatus(statusName, status)){
+      cerr << "Warning: work queue received a result with unknown status for event " << entry << ", recorded as failed.\n";
+      status = QUEUE_FAILED;
+    }
+
+    if(!worker.assigned.erase(entry)){
+      cerr << "Warning: work queue received unexpected result for event " << entry << ".\n";
+      return;
+    }
+    --_nAssigned;
+    WriteResult(entry, weight, error, time, status);
+  
+  }else{
+    cerr << "Warning: work queue received unknown command " << line << ".\n";
+  }
+}
+
+void WorkQueueCoordinator::Disconnect(const int fd){
+  WorkerState &worker = _workers[fd];
+  
+  if(worker.assigned.size()){
+    cerr << "Warning: worker disconnected with " << worker.assigned.size() << " unfinished events, putting them back in the queue.\n";
+    for(const long entry: worker.assigned){
+      // Probably the event which makes the workers crash
+      if(_attempts[entry] >= maxAttempts){
+        cerr << "Warning: event " << entry << " was handed out " << maxAttempts << " times without result, recording it as failed.\n";
+        WriteResult(entry, 0., 0., 0., QUEUE_FAILED);
+        continue;
+      }
+      _pending.push_front(entry);
+      if(_costs.size())
+        _pendingCost += GetCost(entry);
+    }
+    _nAssigned -= worker.assigned.size();
+  }
+  
+  close(fd);
+  _workers.erase(fd);
+}
+
+void WorkQueueCoordinator::WriteResult(const long entry, const double weight, const double error, const double time, const QueueStatus status){
+  ++_nDone;
+  if(status == QUEUE_FAILED)
+    ++_nFailed;
+
+  fprintf(_results, "%ld %.10e %.10e %g %s\n", entry, weight, error, time, GetQueueStatusName(status));
+  fflush(_results);
+
+  cout << "Work queue: event " << entry << (status == QUEUE_FAILED ? " failed" : " done") << " (" << _nDone << "/" << _nEvents << ")." << endl;
+}
+
+void WorkQueueCoordinator::Send(const int fd, const std::string &message){
+  if(send(fd, message.c_str(), message.size(), MSG_NOSIGNAL) < 0)
+    Disconnect(fd);
+}
+
+WorkQueueClient::WorkQueueClient(const std::string &socketPath){
+  _fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  const sockaddr_un address = makeAddress(socketPath);
+  
+  if(_fd < 0 || connect(_fd, (const sockaddr*) &address, sizeof(address)) < 0){
+    cerr << "Error connecting to work queue " << socketPath << ": " << strerror(errno) << ".\n";
+    exit(1);
+  }
+}
+
+WorkQueueClient::~WorkQueueClient(){
+  close(_fd);
+}
+
+bool WorkQueueClient::NextChunk(std::vector<long> &entries){
+  entries.clear();
+  
+  while(true){
+    if(!Send("GET\n"))
+      return false;
+    
+    const string line = ReadLine();
+    istringstream stream(line);
+    string command;
+    stream >> command;
+    
+    if(command == "CHUNK"){
+      long n, entry;
+      stream >> n;
+      for(long i = 0; i < n && stream >> entry; ++i)
+        entries.push_back(entry);
+      return true;
+    }else if(command == "WAIT"){
+      sleep(1);
+    }else{
+      // "DONE", or the coordinator has exited
+      return false;
+    }
+  }
+}
+
+void WorkQueueClient::SendResult(const long entry, const double weight, const double error, const double time, const QueueStatus status){
+  char message[256];
+  snprintf(message, sizeof(message), "RESULT %ld %.17g %.17g %.17g %s\n", entry, weight, error, time, GetQueueStatusName(status));
+  if(!Send(message))
+    cerr << "Warning: unable to send result for event " << entry << " to the work queue: " << strerror(errno) << ".\n";
+}
+
+std::string WorkQueueClient::ReadLine(){
+  size_t eol;
+  while( (eol = _buffer.find('\n')) == string::npos ){
+    char buffer[4096];
+    const ssize_t n = recv(_fd, buffer, sizeof(buffer), 0);
+    if(n <= 0)
+      return "";
+    _buffer.append(buffer, n);
+  }
+  
+  const string line = _buffer.substr(0, eol);
+  _buffer.erase(0, eol + 1);
+  return line;
+}
+
+bool WorkQueueClient::Send(const std::string &message){
+  lock_guard<mutex> lock(_sendMutex);
+  return send(_fd, message.c_str(), message.size(), MSG_NOSIGNAL) >= 0;
+}
@@ -0,0 +1,61 @@
+// Check of the closed-form ISR correction (transverseBoostPartons, fourVector.h) against the general
+// ROOT::Math::Boost computation, on random total momenta. Returns a non-zero exit code on a mismatch.
+
+#include <iostream>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+#include "Math/Vector4D.h"
+#include "Math/Vector3D.h"
+#include "Math/Boost.h"
+
+#include "fourVector.h"
+
+using namespace std;
+
+int main(){
+  mt19937_64 generator(1);
+  uniform_real_distribution<double> transverse(-300., 300.), longitudinal(-2000., 2000.), mass(20., 2000.);
+
+  const int nPoints = 100000;
+  double maxDiff = 0.;
+  int nFailed = 0;
+
+  for(int i = 0; i < nPoints; ++i){
+    FourVector tot = { transverse(generator), transverse(generator), longitudinal(generator), 0. };
+    tot.e = sqrt(tot.P2() + pow(mass(generator), 2));
+
+    double q1Pz, q2Pz;
+    FourVector parton1, parton2;
+    if(!transverseBoostPartons(tot, q1Pz, q2Pz, parton1, parton2)){
+      cout << "Total momentum " << tot.px << "," << tot.py << "," << tot.pz << "," << tot.e << " rejected" << endl;
+      ++nFailed;
+      continue;
+    }
+
+    // Boost to the transverse rest frame of the total momentum, partons along z there, and back
+    ROOT::Math::PxPyPzEVector tempTot( ToPxPyPzEVector(tot) );
+    tempTot.SetPz(0.);
+    const ROOT::Math::XYZVector isrDeBoostVector( tempTot.BoostToCM() );
+    const ROOT::Math::PxPyPzEVector newTot( ROOT::Math::Boost(isrDeBoostVector)*ToPxPyPzEVector(tot) );
+    const double refQ1Pz = (newTot.Pz() + newTot.E())/2.;
+    const double refQ2Pz = (newTot.Pz() - newTot.E())/2.;
+    const ROOT::Math::Boost isrBoost( -isrDeBoostVector );
+    const ROOT::Math::PxPyPzEVector refParton1( isrBoost*ROOT::Math::PxPyPzEVector(0., 0., refQ1Pz, refQ1Pz) );
+    const ROOT::Math::PxPyPzEVector refParton2( isrBoost*ROOT::Math::PxPyPzEVector(0., 0., refQ2Pz, fabs(refQ2Pz)) );
+
+    const double diff = max( { fabs(refQ1Pz - q1Pz), fabs(refQ2Pz - q2Pz),
+      fabs(refParton1.Px() - parton1.px), fabs(refParton1.Py() - parton1.py), fabs(refParton1.Pz() - parton1.pz), fabs(refParton1.E() - parton1.e),
+      fabs(refParton2.Px() - parton2.px), fabs(refParton2.Py() - parton2.py), fabs(refParton2.Pz() - parton2.pz), fabs(refParton2.E() - parton2.e) } )/tot.e;
+    maxDiff = max(maxDiff, diff);
+    if(diff > 1e-10){
+      if(nFailed < 10)
+        cout << "Closed-form ISR correction differs from ROOT::Math::Boost by " << diff << " (relative to the total energy " << tot.e << ")" << endl;
+      ++nFailed;
+    }
+  }
+
+  cout << (nFailed ? "FAILED " : "OK     ") << "ISR correction: " << nPoints << " points, maximal relative difference " << maxDiff << endl;
+  return nFailed ? 1 : 0;
+}
@@ -0,0 +1,84 @@
+// Checks of the built-in integrators on integrands which vanish almost everywhere.
+// Returns a non-zero exit code if a check fails.
+
+#include <iostream>
+#include <cmath>
+
+#include "vegasGrid.h"
+#include "qmcIntegrator.h"
+#include "vegasIntegrator.h"
+
+using namespace std;
+
+static int nFailed = 0;
+
+static void check(const bool ok, const string &name){
+  cout << (ok ? "OK     " : "FAILED ") << name << endl;
+  if(!ok)
+    ++nFailed;
+}
+
+// Narrow 2D Gaussian (sigma = 0.0016) around (0.6, 0.3), truncated at 4 sigma and normalized to 1: the first
+// iterations of a few thousand points usually miss it entirely
+static const double sigma = 0.0016;
+// Number of evaluations before the first non-zero value
+static long nCalls = 0, firstHit = -1;
+
+static int peaked(const int *nDim, const double *x, const int *nComp, double *f, void *userData, const int *nVec, const int *core, const double *weight){
+  for(int k = 0; k < *nVec; ++k){
+    const double *p = x + k*(*nDim);
+    const double r2 = pow(p[0] - 0.6, 2) + pow(p[1] - 0.3, 2);
+    const bool inside = r2 < 16.*sigma*sigma;
+    f[k*(*nComp)] = inside ? exp(-r2/(2.*sigma*sigma))/(2.*M_PI*sigma*sigma*(1. - exp(-8.))) : 0.;
+    if(inside && firstHit < 0)
+      firstHit = nCalls;
+    ++nCalls;
+  }
+  return 0;
+}
+
+// The seeds are chosen so that the first iteration (firstIteration evaluations) has no point in the peak,
+// which used to give 0 +- 0
+static void checkPeaked(const string &name, const double result, const double error, const long firstIteration){
+  cout << "  " << result << " +- " << error << ", first non-zero value after " << firstHit << " evaluations" << endl;
+  check(firstHit >= firstIteration && error > 0. && fabs(result - 1.) < max(5.*error, 0.01), name + ": peaked integrand missed by the first iteration");
+  nCalls = 0;
+  firstHit = -1;
+}
+
+int main(){
+  // An iteration with a vanishing variance must not hide the following ones
+  IterationResults results;
+  results.Add(0., 0.);
+  results.Add(1., 0.01);
+  results.Add(1.2, 0.01);
+  check(fabs(results.GetResult() - 1.1) < 1e-12 && results.GetError() > 0. && !results.IsExact(), "IterationResults: zero-variance iteration followed by finite-variance ones");
+
+  IterationResults exact;
+  exact.Add(2., 0.);
+  exact.Add(2., 0.);
+  check(exact.IsExact() && exact.GetResult() == 2. && exact.GetError() == 0., "IterationResults: exact iterations");
+
+  IterationResults inconsistent;
+  inconsistent.Add(0., 0.);
+  inconsistent.Add(1., 0.);
+  check(!inconsistent.IsExact() && inconsistent.GetError() > 0., "IterationResults: inconsistent zero-variance iterations");
+
+  const int nDim = 2, nStart = 2048, maxEval = 400000;
+  double result, error, prob;
+
+  QMCIntegrator lattice(nDim, QMCIntegrator::LATTICE, 1);
+  lattice.Integrate(peaked, nullptr, 1, maxEval, nStart, 0.02, 0., &result, &error, &prob);
+  checkPeaked("QMC lattice", result, error, nStart);
+
+  QMCIntegrator sobol(nDim, QMCIntegrator::SOBOL, 3);
+  sobol.Integrate(peaked, nullptr, 1, maxEval, nStart, 0.02, 0., &result, &error, &prob);
+  checkPeaked("QMC Sobol", result, error, nStart);
+
+  // 22^2 sub-cubes with 4 points each in the first iteration
+  VegasIntegrator vegas(nDim, 1, 1);
+  vegas.Integrate(peaked, nullptr, 1, maxEval, nStart, 0.02, 0., &result, &error, &prob);
+  checkPeaked("Native Vegas", result, error, 22*22*4);
+
+  return nFailed ? 1 : 0;
+}
@@ -0,0 +1,87 @@
+// Checks of the neutrino solver (solve2QuadsPolished) on systems where eliminating E1^2 is ill-conditioned.
+// Returns a non-zero exit code if a check fails.
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+#include "utils.h"
+
+using namespace std;
+
+static int nFailed = 0;
+
+static void check(const bool ok, const string &name){
+  cout << (ok ? "OK     " : "FAILED ") << name << endl;
+  if(!ok)
+    ++nFailed;
+}
+
+// Reference solution, refined by Newton's method in long double from a starting point (e1, e2).
+// Coefficients of E1^2, E2^2, E1*E2, E1, E2, 1
+static pair<double, double> refine(const double *a, const double *b, const double e1, const double e2){
+  long double x = e1, y = e2;
+  for(int i = 0; i < 100; ++i){
+    const long double f = a[0]*x*x + a[1]*y*y + a[2]*x*y + a[3]*x + a[4]*y + a[5];
+    const long double g = b[0]*x*x + b[1]*y*y + b[2]*x*y + b[3]*x + b[4]*y + b[5];
+    const long double fx = 2*a[0]*x + a[2]*y + a[3], fy = 2*a[1]*y + a[2]*x + a[4];
+    const long double gx = 2*b[0]*x + b[2]*y + b[3], gy = 2*b[1]*y + b[2]*x + b[4];
+    const long double det = fx*gy - fy*gx;
+    x -= (f*gy - g*fy)/det;
+    y -= (g*fx - f*gx)/det;
+  }
+  return make_pair(static_cast<double>(x), static_cast<double>(y));
+}
+
+// Solves the system, and checks that exactly the expected solutions are found, within a relative precision
+static void checkSystem(const string &name, const double *a, const double *b, const vector< pair<double, double> > &expected){
+  vector<double> E1, E2;
+  int nRejected = 0;
+  solve2QuadsPolished(a[0], a[1], a[2], a[3], a[4], a[5], b[0], b[1], b[2], b[3], b[4], b[5], E1, E2, nRejected);
+
+  cout << " ";
+  for(size_t i = 0; i < E1.size(); ++i)
+    cout << " (" << E1[i] << ", " << E2[i] << ")";
+  cout << ", " << nRejected << " rejected" << endl;
+
+  bool ok = E1.size() == expected.size();
+  for(const auto &solution: expected){
+    bool found = false;
+    for(size_t i = 0; i < E1.size() && !found; ++i)
+      found = fabs(E1[i] - solution.first) <= 1e-6*max(1., fabs(solution.first)) && fabs(E2[i] - solution.second) <= 1e-6*max(1., fabs(solution.second));
+    ok = ok && found;
+  }
+  check(ok, name);
+}
+
+int main(){
+  // Coefficients of E1^2, E2^2, E1*E2, E1, E2, 1
+  const double eps = 1e-9;
+
+  // Well-conditioned system: ellipse E1^2 + 2E2^2 = 6 and hyperbola E1*(E2 + 1) = 2, two solutions
+  {
+    const double a[6] = { 1., 2., 0., 0., 0., -6. };
+    const double b[6] = { 0., 0., 1., 1., 0., -2. };
+    checkSystem("well-conditioned system", a, b, { refine(a, b, 0.8, 1.6), refine(a, b, 2.4, -0.2) });
+  }
+
+  // The same conics with tiny E1^2 terms: (2, 1) and (-20, 3) as without them, and two solutions far away, where
+  // eps*E1^2 = (E2 - 1)(3 - E2) (difference of both conics) with E2 ~ 2. Eliminating E1^2 only finds the first two.
+  {
+    const double a[6] = { eps, 2., 1., -2., 1., -1. };
+    const double b[6] = { 2.*eps, 3., 1., -2., -3., 2. };
+    checkSystem("tiny E1^2 terms: solutions far away", a, b, { refine(a, b, 2., 1.), refine(a, b, -20., 3.), refine(a, b, 1./sqrt(eps), 2.), refine(a, b, -1./sqrt(eps), 2.) });
+  }
+
+  // Tiny E1^2 terms, where eliminating E1^2 finds (-1, 3) twice instead of the solution near (1/eps, -1):
+  // the lost root polishes to the other one, and nothing is rejected
+  {
+    const double a[6] = { eps, 1., 3., 2., 1., -1. };
+    const double b[6] = { 3.*eps, 0., 0., -3., -1., 0. };
+    checkSystem("tiny E1^2 terms: lost root", a, b, { refine(a, b, -1., 3.), refine(a, b, 1./eps, -1.) });
+  }
+
+  if(nFailed)
+    cout << nFailed << " check(s) failed" << endl;
+  return nFailed ? 1 : 0;
+}
@@ -16,13 +16,24 @@ evt_per_job = 50
 max_evt= 10000
 i = 0
 
-while start_evt < max_evt:
-	end_evt += evt_per_job
+# Predicted costs (ME_ttbar --cost-predict=FILE): if set, the events are split into n_jobs ranges of equal predicted duration
+cost_file = ""
+n_jobs = 200
+if cost_file:
+	import costSplit
+	job_ranges = [(start, end) for start, end, cost in costSplit.split_ranges(cost_file, n_jobs)]
+else:
+	job_ranges = []
+	while start_evt < max_evt:
+		end_evt += evt_per_job
+		job_ranges.append((start_evt, end_evt))
+		start_evt = end_evt+1
+
+for start_evt, end_evt in job_ranges:
 	#LaunchOnCondor.SendCluster_Push(["BASH", os.path.join(path, "condor.sh"), os.path.join(path, "data/ttbar.root"), "ttbar_DMEM_MTTbar_noTF_try0_" + str(i) + ".root", start_evt, end_evt])
 	#LaunchOnCondor.SendCluster_Push(["BASH", os.path.join(path, "condor.sh"), os.path.join(path, "data/ttbar_weighted_binnedTF_wholeWidths_isr0_pdfMtop_noMCoPerms_10000evt.root"), "ttbar_binnedTF_wholeWidths_isr0_pdfMtop_noMCoPerms_as013_cuba_sobol_try0_" + str(i) + ".root", start_evt, end_evt])
 	LaunchOnCondor.SendCluster_Push(["BASH", os.path.join(path, "condor.sh"), os.path.join(path, "data/ttbar_weighted_binnedTF_doubleWidths_isr0_pdfMtop_noMCoPerms_sobol_10000evt.root"), "ttbar_binnedTF_doubleWidths_isr0_pdfMtop_noMCoPerms_as013_cuba_sobol_bugFix_" + str(i) + ".root", os.path.join(path, "../binnedTF/TF_generator/Control_plots_hh_TF.root"), start_evt, end_evt])
 	#LaunchOnCondor.SendCluster_Push(["BASH", path + "/condor.sh", path + "/results/ttbar_noTF_isr0_pdfMtop_noMCoPerms_as013_cuba_Mersenne_noSmooth_50000.root", "ttbar_noTF_isr0_pdfMtop_noMCoPerms_as013_cuba_Mersenne_noSmooth_50000_bis_" + str(i) + ".root", start_evt, end_evt])
-	start_evt = end_evt+1
 	i += 1
 
 LaunchOnCondor.SendCluster_Submit()
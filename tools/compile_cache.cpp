@@ -0,0 +1,91 @@
+// Compile the TF histograms and the PDF tables at a fixed scale into a binary table cache (see interface/tableCache.h),
+// which can be given to ME_ttbar instead of the TF file.
+//
+// Usage: tools/compile_cache output TF_file PDF_name Q2 [histogram ...]
+// Default histograms: those used by ME_ttbar. Q2 must be the scale used in the integrand (M_T^2 for ttbar).
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cmath>
+#include <stdlib.h>
+
+#include "LHAPDF/LHAPDF.h"
+
+#include "TFile.h"
+
+#include "tableCache.h"
+#include "binnedTF.h"
+
+using namespace std;
+
+// Nodes of the PDF tables, equally spaced in log(x)
+static const int nPdfNodes = 2000;
+static const double pdfXMin = 1e-6;
+
+int main(int argc, char *argv[]){
+  if(argc < 5){
+    cerr << "Usage: " << argv[0] << " output TF_file PDF_name Q2 [histogram ...]" << endl;
+    exit(1);
+  }
+
+  const string outputFile(argv[1]);
+  const string fileTF(argv[2]);
+  const string pdfName(argv[3]);
+  const double q2 = atof(argv[4]);
+
+  vector<string> histograms;
+  for(int i = 5; i < argc; ++i)
+    histograms.push_back(argv[i]);
+  if(!histograms.size())
+    histograms = { "Binned_Egen_DeltaE_Norm_ele", "Binned_Egen_DeltaE_Norm_muon", "Binned_Egen_DeltaE_Norm_jet" };
+
+  vector<string> names;
+  vector<TableView> tables;
+  // Storage of the values (one vector per table, so that the pointers remain valid)
+  vector< vector<double> > values;
+  values.reserve(histograms.size() + PdfTable::pids.size());
+
+  TFile file(fileTF.c_str(), "READ");
+  if(file.IsZombie()){
+    cerr << "Error opening TF file " << fileTF << ".\n";
+    exit(1);
+  }
+
+  for(const string &histName: histograms){
+    values.emplace_back();
+    TableView table;
+    if(!BinnedTF::ReadHistogram(&file, histName, values.back(), table)){
+      cerr << "Error: unable to retrieve " << histName << " from file " << fileTF << ".\n";
+      exit(1);
+    }
+    names.push_back(histName);
+    tables.push_back(table);
+    cout << "TF histogram " << histName << ": " << table.nx << " x " << table.ny << " bins" << endl;
+  }
+
+  LHAPDF::PDF* pdf = LHAPDF::mkPDF(pdfName, 0);
+  const double logXMin = log(pdfXMin);
+
+  for(const int pid: PdfTable::pids){
+    values.emplace_back(nPdfNodes);
+    vector<double> &nodes = values.back();
+    for(int i = 0; i < nPdfNodes; ++i){
+      const double x = exp(logXMin*(1. - i/(nPdfNodes - 1.)));
+      nodes[i] = pdf->xfxQ2(pid, min(x, 1.), q2);
+    }
+
+    names.push_back( PdfTable::GetTableName(pdfName, 0, pid) );
+    tables.push_back( { nPdfNodes, 1, logXMin, 0., q2, q2, nodes.data() } );
+  }
+  cout << "PDF " << pdfName << " at Q^2 = " << q2 << ": " << PdfTable::pids.size() << " partons, " << nPdfNodes << " nodes in log(x) from " << pdfXMin << " to 1" << endl;
+
+  delete pdf; pdf = nullptr;
+
+  if(!TableCache::Write(outputFile, names, tables))
+    exit(1);
+
+  cout << "Table cache written to " << outputFile << endl;
+
+  return 0;
+}
@@ -0,0 +1,60 @@
+"""Split a range of events into jobs of equal predicted duration.
+
+The costs are those written by `ME_ttbar ... --cost-model=MODEL --cost-predict=COSTS` (one line
+"entry cost" per event). Each job gets a contiguous range of entries, so that it can be run with the
+usual start_evt and end_evt arguments.
+
+    python costSplit.py COSTS n_jobs   # prints one line "start_evt end_evt predicted_time" per job
+"""
+
+import sys
+
+
+def read_costs(cost_file):
+    costs = {}
+    with open(cost_file) as f:
+        for line in f:
+            fields = line.split()
+            if len(fields) >= 2:
+                costs[int(fields[0])] = float(fields[1])
+    return costs
+
+
+def split_ranges(cost_file, n_jobs):
+    """Contiguous ranges (start, end, predicted time) of about total/n_jobs predicted time each."""
+    costs = read_costs(cost_file)
+    if not costs:
+        return []
+    entries = range(min(costs), max(costs) + 1)
+    # Events without a prediction count as the average
+    average = sum(costs.values()) / len(costs)
+    total = sum(costs.get(entry, average) for entry in entries)
+    target = total / n_jobs
+
+    ranges = []
+    start = entries[0]
+    cumulative = 0.
+    start_cumulative = 0.
+    for entry in entries:
+        cost = costs.get(entry, average)
+        # The boundary is placed where the cumulative cost crosses the next multiple of the target,
+        # before or after this event, whichever is closer
+        boundary = (len(ranges) + 1) * target
+        if cumulative + cost >= boundary and len(ranges) < n_jobs - 1:
+            if boundary - cumulative < cumulative + cost - boundary and entry > start:
+                ranges.append((start, entry - 1, cumulative - start_cumulative))
+                start, start_cumulative = entry, cumulative
+            else:
+                ranges.append((start, entry, cumulative + cost - start_cumulative))
+                start, start_cumulative = entry + 1, cumulative + cost
+        cumulative += cost
+    if start <= entries[-1]:
+        ranges.append((start, entries[-1], cumulative - start_cumulative))
+    return ranges
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 3:
+        sys.exit("Usage: python costSplit.py COSTS n_jobs")
+    for start, end, cost in split_ranges(sys.argv[1], int(sys.argv[2])):
+        print("%d %d %g" % (start, end, cost))
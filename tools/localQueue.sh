@@ -0,0 +1,38 @@
+#!/bin/bash
+# Compute the weights for events start_evt to end_evt using a work queue and several local workers.
+# Each worker writes its own ROOT file (output_prefix_i.root), and the coordinator collects all
+# the weights in output_prefix_results.txt (one line "entry weight error time status" per event).
+# Usage: localQueue.sh n_workers input output_prefix TF_file start_evt end_evt [--name=value ...]
+# If COST_FILE is set (predicted costs written by ME_ttbar --cost-predict), the slow events are processed first.
+
+if [ $# -lt 6 ]; then
+  echo "Usage: $0 n_workers input output_prefix TF_file start_evt end_evt [--name=value ...]"
+  exit 1
+fi
+
+exe=$(dirname $0)/../ttbar/ME_ttbar
+n_workers=${1}
+input=${2}
+prefix=${3}
+tf=${4}
+start_evt=${5}
+end_evt=${6}
+shift 6
+
+socket=/tmp/ME_ttbar_queue_$$.sock
+
+${exe} coordinator ${socket} ${start_evt} ${end_evt} ${prefix}_results.txt ${COST_FILE:+10 ${COST_FILE}} &
+coordinator=$!
+
+# Wait for the coordinator to be listening
+while [ ! -S ${socket} ]; do
+  sleep 0.1
+done
+
+for i in $(seq 0 $((n_workers-1)))
+do
+  ${exe} ${input} ${prefix}_${i}.root ${tf} 0 0 --queue=${socket} "$@" > ${prefix}_${i}.log 2>&1 &
+done
+
+wait ${coordinator}
+wait
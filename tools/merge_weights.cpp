@@ -0,0 +1,228 @@
+// Merge the weights of many jobs into one indexed binary file (see interface/weightsIndex.h), in a single pass.
+//
+// Usage: tools/merge_weights output start_evt end_evt input [input ...]
+// The inputs are ME_ttbar output files (.root, Delphes tree with the Entry and Weight_TT_cpp* branches, in any order:
+// they are read through an index on Entry) or text files with lines `entry weight error time status` (work queue
+// results, sorted by entry with `sort -n`). They are merged as streams (k-way merge): only the current event of each
+// input (and the entry index of the ROOT inputs) is in memory. Missing entries of the start_evt-end_evt range
+// (end_evt = -1: up to the last entry found) are kept in the output with the status WEIGHTS_MISSING (as are failed
+// events of the work queue), and entries found in several inputs are only taken from the first one.
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <functional>
+#include <utility>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TTreeIndex.h"
+
+#include "weightsIndex.h"
+#include "workQueue.h"
+
+using namespace std;
+
+// Number of missing ranges and duplicate entries printed
+static const int maxPrinted = 20;
+
+// Events of one input, in the order of the file
+class WeightsInput{
+  public:
+  virtual ~WeightsInput() {}
+  // Returns false at the end of the input
+  virtual bool Next(long &entry, WeightsIndexRecord &record) = 0;
+};
+
+class RootWeightsInput: public WeightsInput{
+  public:
+
+  RootWeightsInput(const string &fileName):
+    _file(fileName.c_str()),
+    _tree(nullptr),
+    _order(nullptr),
+    _next(0){
+
+    _tree = _file.IsZombie() ? nullptr : dynamic_cast<TTree*>(_file.Get("Delphes"));
+    const vector<string> branches = { "Entry", "Weight_TT_cpp", "Weight_TT_Error_cpp", "Weighted_TT_cpp", "Weight_TT_cpp_me" };
+    for(const string &branch: branches){
+      if(!_tree || !_tree->GetBranch(branch.c_str())){
+        cerr << "Error: " << fileName << " does not contain the " << branch << " branch." << endl;
+        exit(1);
+      }
+    }
+    // Only the weights are read
+    _tree->SetBranchStatus("*", 0);
+    for(const string &branch: branches)
+      _tree->SetBranchStatus(branch.c_str(), 1);
+    _tree->SetBranchAddress("Entry", &_entry);
+    _tree->SetBranchAddress("Weight_TT_cpp", &_weight);
+    _tree->SetBranchAddress("Weight_TT_Error_cpp", &_error);
+    _tree->SetBranchAddress("Weighted_TT_cpp", &_weighted);
+    _tree->SetBranchAddress("Weight_TT_cpp_me", &_time);
+
+    // Work queue workers write the events in the order they are handed out (e.g. longest first), not by entry:
+    // the tree is read in the order of its Entry index
+    if(_tree->BuildIndex("Entry") < 0){
+      cerr << "Error: could not index " << fileName << " by entry." << endl;
+      exit(1);
+    }
+    _order = static_cast<TTreeIndex*>(_tree->GetTreeIndex())->GetIndex();
+  }
+
+  bool Next(long &entry, WeightsIndexRecord &record) override {
+    if(_next >= _tree->GetEntries())
+      return false;
+    _tree->GetEntry(_order[_next++]);
+    entry = _entry;
+    record.weight = _weight;
+    record.error = _error;
+    record.time = _time;
+    record.status = _weighted ? WEIGHTS_WEIGHTED : WEIGHTS_NOT_WEIGHTED;
+    return true;
+  }
+
+  private:
+
+  TFile _file;
+  TTree *_tree;
+  // Tree entries sorted by event entry
+  const Long64_t *_order;
+  long _next;
+  long _entry;
+  double _weight, _error, _time;
+  bool _weighted;
+};
+
+// Work queue results: the status is missing in older files, where events with a non-zero weight are counted as weighted
+class TextWeightsInput: public WeightsInput{
+  public:
+
+  TextWeightsInput(const string &fileName): _file(fileName) {
+    if(!_file){
+      cerr << "Error opening " << fileName << "." << endl;
+      exit(1);
+    }
+  }
+
+  bool Next(long &entry, WeightsIndexRecord &record) override {
+    string line;
+    while(getline(_file, line)){
+      istringstream stream(line);
+      if(!(stream >> entry >> record.weight >> record.error >> record.time))
+        continue;
+      string statusName;
+      QueueStatus status;
+      if(stream >> statusName && ParseQueueStatus(statusName, status))
+        record.status = status == QUEUE_WEIGHTED ? WEIGHTS_WEIGHTED : status == QUEUE_NOT_WEIGHTED ? WEIGHTS_NOT_WEIGHTED : WEIGHTS_MISSING;
+      else
+        record.status = record.weight != 0. ? WEIGHTS_WEIGHTED : WEIGHTS_NOT_WEIGHTED;
+      return true;
+    }
+    return false;
+  }
+
+  private:
+
+  ifstream _file;
+};
+
+int main(int argc, char *argv[]){
+  if(argc < 5){
+    cerr << "Usage: " << argv[0] << " output start_evt end_evt input [input ...]" << endl;
+    exit(1);
+  }
+
+  const string outputFile(argv[1]);
+  const long start_evt = atol(argv[2]);
+  const long end_evt = atol(argv[3]);
+
+  vector<string> inputFiles(argv + 4, argv + argc);
+  vector<WeightsInput*> inputs;
+  // Current event of each input
+  vector<WeightsIndexRecord> records(inputFiles.size());
+  // (entry, input): for equal entries, the first input comes first
+  priority_queue< pair<long, int>, vector< pair<long, int> >, greater< pair<long, int> > > heap;
+
+  for(size_t i = 0; i < inputFiles.size(); ++i){
+    const string &fileName = inputFiles[i];
+    if(fileName.size() > 5 && fileName.compare(fileName.size() - 5, 5, ".root") == 0)
+      inputs.push_back( new RootWeightsInput(fileName) );
+    else
+      inputs.push_back( new TextWeightsInput(fileName) );
+
+    long entry;
+    if(inputs[i]->Next(entry, records[i])){
+      records[i].input = i;
+      heap.push( make_pair(entry, i) );
+    }
+  }
+
+  WeightsIndexWriter writer(outputFile, start_evt);
+  long nOutside = 0, nMissing = 0, nPrintedMissing = 0, nPrintedDuplicates = 0;
+
+  // Missing records up to entry (excluded)
+  auto addMissing = [&](const long entry){
+    if(writer.GetNextEntry() >= entry)
+      return;
+    if(nPrintedMissing++ < maxPrinted)
+      cout << "Missing entries " << writer.GetNextEntry() << "-" << entry - 1 << endl;
+    nMissing += entry - writer.GetNextEntry();
+    const WeightsIndexRecord missing = { 0., 0., 0., WEIGHTS_MISSING, -1 };
+    while(writer.GetNextEntry() < entry)
+      writer.Add(missing);
+  };
+
+  while(!heap.empty()){
+    const long entry = heap.top().first;
+    const int i = heap.top().second;
+    heap.pop();
+
+    if(entry < start_evt || (end_evt >= 0 && entry > end_evt)){
+      ++nOutside;
+    }else if(records[i].status == WEIGHTS_MISSING){
+      // Failed event: another input may have its weight, otherwise it is missing
+    }else if(entry < writer.GetNextEntry()){
+      writer.AddDuplicate();
+      if(nPrintedDuplicates++ < maxPrinted)
+        cout << "Duplicate entry " << entry << " in " << inputFiles[i] << ", ignored" << endl;
+    }else{
+      addMissing(entry);
+      writer.Add(records[i]);
+    }
+
+    long next;
+    if(inputs[i]->Next(next, records[i])){
+      if(next < entry){
+        cerr << "Error: " << inputFiles[i] << " is not sorted by entry (" << next << " after " << entry << ")." << endl;
+        exit(1);
+      }
+      records[i].input = i;
+      heap.push( make_pair(next, i) );
+    }
+  }
+  if(end_evt >= 0)
+    addMissing(end_evt + 1);
+
+  if(nPrintedMissing > maxPrinted)
+    cout << "... and " << nPrintedMissing - maxPrinted << " more missing ranges" << endl;
+  if(nPrintedDuplicates > maxPrinted)
+    cout << "... and " << nPrintedDuplicates - maxPrinted << " more duplicate entries" << endl;
+  if(nOutside)
+    cout << nOutside << " events outside of the range " << start_evt << "-" << end_evt << " ignored" << endl;
+
+  for(auto &input: inputs){
+    delete input; input = nullptr;
+  }
+
+  const long nEntries = writer.GetNextEntry() - start_evt;
+  if(!writer.Close())
+    exit(1);
+  cout << "Weights of " << nEntries << " entries written to " << outputFile << " (" << nMissing << " missing in " << nPrintedMissing << " ranges, " << nPrintedDuplicates << " duplicates)" << endl;
+
+  return 0;
+}
@@ -2,14 +2,12 @@
 #include <vector>
 #define _USE_MATH_DEFINES // include M_PI constant
 #include <cmath>
-
-#include "Math/Vector4D.h"
-#include "Math/Vector3D.h"
-#include "Math/Boost.h"
-#include "TMath.h"
+#include <algorithm>
 
 #include "MEWeight.h"
+#include "fourVector.h"
 #include "jacobianD.h"
+#include "cpuDispatch.h"
 #include "utils.h"
 
 #define M_T 173.
@@ -22,72 +20,61 @@
 
 using namespace std;
 
-double MEWeight::Integrand(const double* psPoint, const double *weight){
-  double returnValue = 0.;
+// Final state of the matrix element: e+, nu_e, b, mu-, nu_mu~, b~
+const std::vector<int>& MEWeight::GetFinalState(){
+  static const vector<int> finalState = { -11, 12, 5, 13, -14, -5 };
+  return finalState;
+}
+
+// Fixed factorization scale of the PDFs
+double MEWeight::GetPdfScale(){
+  return SQ(M_T);
+}
+
+// Per-event stage: visible particles in the order of the integration variables psPoint[4..7]
+void MEWeight::PrepareEvent(const MEEvent &event, EventStage &stage) const {
+  stage.Clear();
+  stage.AddVisible(event.GetVector(3), _TF->GetComponent("electron"), _tfSampling);
+  stage.AddVisible(event.GetVector(4), _TF->GetComponent("jet"), _tfSampling);
+  stage.AddVisible(event.GetVector(5), _TF->GetComponent("muon"), _tfSampling);
+  stage.AddVisible(event.GetVector(6), _TF->GetComponent("jet"), _tfSampling);
+  // ISR vector from the observed particles and MET, computed once per event
+  stage.SetInvisibles(event.GetMetVector(), event.GetISR());
+}
+
+void MEWeight::IntegrandKinematics(const double* psPoint, const EventStage &stage, const int index, MEBatch &batch, const int thread){
+  StageCounters &counters = _counters[thread];
+  counters.Increment(StageCounters::POINTS);
+  // Time spent in each stage, measured on a fraction of the points
+  StageClock clock(counters);
 
   for(int i=0; i<4; ++i){
     if(psPoint[i] == 1.)
-      return 0;
+      return;
+  }
+
+  const FourVector &ISR = stage.GetISR();
+  const FourVector &Met = stage.GetMet();
+
+  ///// Transfer functions and phase space density for the observed particles (per phase-space point)
+  
+  // The generated vectors have the same direction and mass as the reconstructed ones, only the energy changes.
+  // The direction, mass and TF ranges are computed once per event (see PrepareEvent), which avoids any trigonometric function here.
+  // dPhi = |P|^2 sin(theta)/(2*E*(2pi)^3) does not depend on the neutrino solutions, so it is included here as well.
+
+  FourVector visibles[4];
+  const double visiblesWeight = stage.GenerateVisibles(&psPoint[4], visibles);
+  clock.Lap(StageCounters::VISIBLES_STAGE);
+  if(visiblesWeight == 0.){
+    counters.Increment(StageCounters::REJECTED_VISIBLES);
+    return;
   }
+  const FourVector &p3 = visibles[0];
+  const FourVector &p4 = visibles[1];
+  const FourVector &p5 = visibles[2];
+  const FourVector &p6 = visibles[3];
 
-  const ROOT::Math::PtEtaPhiEVector p3rec( _recEvent->GetP3() );
-  const ROOT::Math::PtEtaPhiEVector p4rec( _recEvent->GetP4() );
-  const ROOT::Math::PtEtaPhiEVector p5rec( _recEvent->GetP5() );
-  const ROOT::Math::PtEtaPhiEVector p6rec( _recEvent->GetP6() );
-  const ROOT::Math::PtEtaPhiEVector RecMet( _recEvent->GetMet() );
-
-  // Define ISR vector from the observed particles and MET
-  // Do this in PxPyPzE basis as this will be more practical for the next stages (transverse boost)
-  ROOT::Math::PxPyPzEVector ISR( -(p3rec + p4rec + p5rec + p6rec + RecMet) );
-
-  ///// Transfer functions
-
-  double TFreturnValue = 1.;
-
-  ROOT::Math::PtEtaPhiEVector p3gen = p3rec;
-  const double E3rec = p3rec.E();
-  const double p3DeltaRange = _TF->GetDeltaRange("electron", E3rec);
-  const double E3gen = E3rec - _TF->GetDeltaMax("electron", E3rec) + p3DeltaRange * psPoint[4];
-  const double pt3gen = sqrt( SQ(E3gen) - SQ(p3rec.M()) ) / cosh(p3rec.Eta());
-  p3gen.SetCoordinates(pt3gen, p3rec.Eta(), p3rec.Phi(), E3gen);
-  if(p3DeltaRange != 0.)
-    TFreturnValue *= _TF->Evaluate("electron", E3rec, E3gen) * p3DeltaRange * dEoverdP(E3gen, p3gen.M());
-
-  ROOT::Math::PtEtaPhiEVector p5gen = p5rec;
-  const double E5rec = p5rec.E();
-  const double p5DeltaRange = _TF->GetDeltaRange("muon", E5rec);
-  const double E5gen = E5rec - _TF->GetDeltaMax("muon", E5rec) + p5DeltaRange * psPoint[6];
-  const double pt5gen = sqrt( SQ(E5gen) - SQ(p5rec.M()) ) / cosh(p5rec.Eta());
-  p5gen.SetCoordinates(pt5gen, p5rec.Eta(), p5rec.Phi(), E5gen);
-  if(p5DeltaRange != 0.)
-    TFreturnValue *= _TF->Evaluate("muon", E5rec, E5gen) * p5DeltaRange * dEoverdP(E5gen, p5gen.M());
-
-  ROOT::Math::PtEtaPhiEVector p4gen = p4rec;
-  const double E4rec = p4rec.E();
-  const double p4DeltaRange = _TF->GetDeltaRange("jet", E4rec);
-  const double E4gen = E4rec - _TF->GetDeltaMax("jet", E4rec) + p4DeltaRange * psPoint[5];
-  const double pt4gen = sqrt( SQ(E4gen) - SQ(p4rec.M()) ) / cosh(p4rec.Eta());
-  p4gen.SetCoordinates(pt4gen, p4rec.Eta(), p4rec.Phi(), E4gen);
-  if(p4DeltaRange != 0.)
-    TFreturnValue *= _TF->Evaluate("jet", E4rec, E4gen) * p4DeltaRange * dEoverdP(E4gen, p4gen.M());
-
-  ROOT::Math::PtEtaPhiEVector p6gen = p6rec;
-  const double E6rec = p6rec.E();
-  const double p6DeltaRange = _TF->GetDeltaRange("jet", E6rec);
-  const double E6gen = p6rec.E() - _TF->GetDeltaMax("jet", E6rec) + p6DeltaRange * psPoint[7];
-  const double pt6gen = sqrt( SQ(E6gen) - SQ(p6rec.M()) ) / cosh(p6rec.Eta());
-  p6gen.SetCoordinates(pt6gen, p6rec.Eta(), p6rec.Phi(), E6gen);
-  if(p6DeltaRange != 0.)
-    TFreturnValue *= _TF->Evaluate("jet", E6rec, E6gen) * p6DeltaRange * dEoverdP(E6gen, p6gen.M());
-
-  // In the following, we want to use PxPyPzE vectors, since the change of variables is done over those variables => we are already in the right basis, no need to recompute quantities every time
-  ROOT::Math::PxPyPzEVector p3(p3gen);
-  ROOT::Math::PxPyPzEVector p4(p4gen);
-  ROOT::Math::PxPyPzEVector p5(p5gen);
-  ROOT::Math::PxPyPzEVector p6(p6gen);
-  ROOT::Math::PxPyPzEVector Met(RecMet);
-
-  //cout << "Final TF = " << TFreturnValue << endl;
+  //cout << "Final TF = " << visiblesWeight << endl;
 
   // We flatten the Breit-Wigners by doing a change of variable for each resonance separately
   // The new integration variables are now the Lorentz invariants of the Breit-Wigners (sXXX)
@@ -99,102 +86,89 @@ double MEWeight::Integrand(const double* psPoint, const double *weight){
   flattenBW(psPoint[3], M_T, G_T, s256, jac256);
   double flatterJac = jac13 * jac134 * jac25 * jac256;
 
-  if(s13 > s134 || s25 > s256 || s13 < p3.M() || s25 < p5.M() || s134 < p4.M() || s256 < p6.M())
-    return 0;
+  if(s13 > s134 || s25 > s256 || s13 < stage.GetVisible(0).GetMass() || s25 < stage.GetVisible(2).GetMass() || s134 < stage.GetVisible(1).GetMass() || s256 < stage.GetVisible(3).GetMass()){
+    counters.Increment(StageCounters::REJECTED_INVARIANTS);
+    return;
+  }
 
-  //cout << "weight = " << *weight << endl;
-  
-  std::vector<ROOT::Math::PxPyPzEVector> p1vec, p2vec;
+  std::vector<FourVector> p1vec, p2vec;
+  int nRejectedRoots = 0;
 
-  ComputeTransformD(s13, s134, s25, s256,
-                    p3, p4, p5, p6, Met, ISR,
-                    p1vec, p2vec);
+  // Neutrino solutions and jacobian: kernels compiled for the instruction set of the CPU
+  const ISAKernels &kernels = GetISAKernels();
+  kernels.computeTransformD(s13, s134, s25, s256,
+                            p3, p4, p5, p6, Met, ISR,
+                            p1vec, p2vec, nRejectedRoots);
+  clock.Lap(StageCounters::NEUTRINOS_STAGE);
 
-  int countSol = 0;
+  counters.Increment(StageCounters::REJECTED_ROOTS, nRejectedRoots);
+  if(!p1vec.size())
+    counters.Increment(StageCounters::NO_SOLUTION);
+  counters.Increment(StageCounters::SOLUTIONS, p1vec.size());
 
   for(unsigned short i = 0; i < p1vec.size(); ++i){
 
-    const ROOT::Math::PxPyPzEVector p1 = p1vec.at(i);
-    const ROOT::Math::PxPyPzEVector p2 = p2vec.at(i);
+    const FourVector &p1 = p1vec[i];
+    const FourVector &p2 = p2vec[i];
 
-    /*const ROOT::Math::PxPyPzEVector p13 = p1 + p3;
-    const ROOT::Math::PxPyPzEVector p134 = p1 + p3 + p4;
-    const ROOT::Math::PxPyPzEVector p25 = p2 + p5;
-    const ROOT::Math::PxPyPzEVector p256 = p2 + p5 + p6;
+    /*const double m13 = sqrt((p1 + p3).M2());
+    const double m134 = sqrt((p1 + p3 + p4).M2());
+    const double m25 = sqrt((p2 + p5).M2());
+    const double m256 = sqrt((p2 + p5 + p6).M2());
 
     cout << "Solution " << i << ":" << endl;
     cout << "Input: W+ mass=" << sqrt(s13) << ", Top mass=" << sqrt(s134) << ", W- mass=" << sqrt(s25) << ", Anti-top mass=" << sqrt(s256) << endl;
-    cout << "Output: W+ mass=" << p13.M() << ", Top mass=" << p134.M() << ", W- mass=" << p25.M() << ", Anti-top mass=" << p256.M() << endl << endl;
-    //cout << "Differences: W+ mass=" << sqrt(s13)-p13.M() << ", Top mass=" << sqrt(s134)-p134.M() << ", W- mass=" << sqrt(s25)-p25.M() << ", Anti-top mass=" << sqrt(s256)-p256.M() << endl << endl;
+    cout << "Output: W+ mass=" << m13 << ", Top mass=" << m134 << ", W- mass=" << m25 << ", Anti-top mass=" << m256 << endl << endl;
+    //cout << "Differences: W+ mass=" << sqrt(s13)-m13 << ", Top mass=" << sqrt(s134)-m134 << ", W- mass=" << sqrt(s25)-m25 << ", Anti-top mass=" << sqrt(s256)-m256 << endl << endl;
     cout << "Accuracies: " << endl;
-    cout << "W+ mass=" << (sqrt(s13)-p13.M())/p13.M() << endl;
-    cout << "Top mass=" << (sqrt(s134)-p134.M())/p134.M() << endl;
-    cout << "W- mass=" << (sqrt(s25)-p25.M())/p25.M() << endl;
-    cout << "Anti-top mass=" << (sqrt(s256)-p256.M())/p256.M() << endl << endl;*/
+    cout << "W+ mass=" << (sqrt(s13)-m13)/m13 << endl;
+    cout << "Top mass=" << (sqrt(s134)-m134)/m134 << endl;
+    cout << "W- mass=" << (sqrt(s25)-m25)/m25 << endl;
+    cout << "Anti-top mass=" << (sqrt(s256)-m256)/m256 << endl << endl;*/
     
     /*cout << "Electron (E,Px,Py,Pz) = ";
-    cout << p3.E() << "," << p3.Px() << "," << p3.Py() << "," << p3.Pz() << endl;
+    cout << p3.e << "," << p3.px << "," << p3.py << "," << p3.pz << endl;
     cout << "Electron neutrino (E,Px,Py,Pz) = ";
-    cout << p1.E() << "," << p1.Px() << "," << p1.Py() << "," << p1.Pz() << endl;
+    cout << p1.e << "," << p1.px << "," << p1.py << "," << p1.pz << endl;
     cout << "b quark (E,Px,Py,Pz) = ";
-    cout << p4.E() << "," << p4.Px() << "," << p4.Py() << "," << p4.Pz() << endl;
+    cout << p4.e << "," << p4.px << "," << p4.py << "," << p4.pz << endl;
     cout << "Muon (E,Px,Py,Pz) = ";
-    cout << p5.E() << "," << p5.Px() << "," << p5.Py() << "," << p5.Pz() << endl;
+    cout << p5.e << "," << p5.px << "," << p5.py << "," << p5.pz << endl;
     cout << "Muon neutrino (E,Px,Py,Pz) = ";
-    cout << p2.E() << "," << p2.Px() << "," << p2.Py() << "," << p2.Pz() << endl;
+    cout << p2.e << "," << p2.px << "," << p2.py << "," << p2.pz << endl;
     cout << "Anti b quark (E,Px,Py,Pz) = ";
-    cout << p6.E() << "," << p6.Px() << "," << p6.Py() << "," << p6.Pz() << endl << endl;*/
+    cout << p6.e << "," << p6.px << "," << p6.py << "," << p6.pz << endl << endl;*/
   
-    const ROOT::Math::PxPyPzEVector tot = p1 + p2 + p3 + p4 + p5 + p6;
+    const FourVector tot = p1 + p2 + p3 + p4 + p5 + p6;
 
     //////////////////////////// ISR CORRECTION ////////////////////////////////
     /*cout << "**********************" << endl;
     cout << "Total: " << tot  << endl;
     cout << "ISR: " << ISR << endl;*/
     
-    // Define boost that puts the transverse total momentum vector in its CoM frame 
-    ROOT::Math::PxPyPzEVector tempTot( tot );
-    tempTot.SetPz(0.);
-    ROOT::Math::XYZVector isrDeBoostVector( tempTot.BoostToCM() );
-    
-    //ROOT::Math::XYZVector isrBoostVector = -ISR.BoostToCM(); // this does not give the same result as above, since beta_x(boost) = x/E, and while x_ISR = -x_tot, E_ISR != E_tot
-    
-    // In the "transverse" CoM frame, use total Pz and E to define initial longitudinal quark momenta
-    //cout << "Boost: " << isrBoostVector << endl;
-    const ROOT::Math::Boost isrDeBoost( isrDeBoostVector );
-    const ROOT::Math::PxPyPzEVector newTot( isrDeBoost*tot );
-    const double ETot = newTot.E();
-    const double PzTot = newTot.Pz();
-
-    const double q1Pz = (PzTot + ETot)/2.;
-    const double q2Pz = (PzTot - ETot)/2.;
-  
-    if(q1Pz > SQRT_S/2. || q2Pz < -SQRT_S/2. || q1Pz < 0. || q2Pz > 0.)
+    // Boost the total momentum to its "transverse" CoM frame, use there the total Pz and E to define initial longitudinal quark momenta,
+    // and boost these back by the opposite of the transverse boost. As the boost is purely transverse and the partons are along z, 
+    // all this is done in closed form (see transverseBoostPartons, checked against ROOT::Math::Boost by tests/testISRBoost).
+    //ROOT::Math::XYZVector isrBoostVector = -ISR.BoostToCM(); // this does not give the same result, since beta_x(boost) = x/E, and while x_ISR = -x_tot, E_ISR != E_tot
+    double q1Pz, q2Pz;
+    FourVector parton1, parton2;
+    if(!transverseBoostPartons(tot, q1Pz, q2Pz, parton1, parton2) || q1Pz > SQRT_S/2. || q2Pz < -SQRT_S/2. || q1Pz < 0. || q2Pz > 0.){
+      counters.Increment(StageCounters::REJECTED_PARTONS);
+      clock.Lap(StageCounters::KINEMATICS_STAGE);
       continue;
+    }
     
-    ROOT::Math::PxPyPzEVector parton1(0., 0., q1Pz, q1Pz);
-    ROOT::Math::PxPyPzEVector parton2(0., 0., q2Pz, abs(q2Pz));
-
-    /*cout << "Before:" << endl;
-    cout << " Parton1: " << parton1 << endl;
-    cout << " Parton2: " << parton2 << endl;*/
-   
-    // Boost initial parton momenta by the opposite of the transverse boost needed to put the whole system in its CoM
-    const ROOT::Math::Boost isrBoost( -isrDeBoostVector );
-    parton1 = isrBoost*parton1;
-    parton2 = isrBoost*parton2;
-
-    /*cout << "After:" << endl;
-    cout << " Parton1: " << parton1 << endl;
-    cout << " Parton2: " << parton2 << endl;*/
+    /*cout << "Partons:" << endl;
+    cout << " Parton1: " << parton1.e << "," << parton1.px << "," << parton1.py << "," << parton1.pz << endl;
+    cout << " Parton2: " << parton2.e << "," << parton2.px << "," << parton2.py << "," << parton2.pz << endl;*/
    
-    //ROOT::Math::PxPyPzEVector testT = parton1 + parton2 + ISR;
-    //ROOT::Math::PxPyPzEVector testT = -parton1 - parton2 + p1 + p2 + p3 + p4 + p5 + p6;
+    //FourVector testT = parton1 + parton2 + ISR;
+    //FourVector testT = -parton1 - parton2 + p1 + p2 + p3 + p4 + p5 + p6;
     //cout << "Test transverse: " << testT << endl;
     
     ///////////////// NO ISR CORRECTION //////////////////////////////////////////
-    /*const double ETot = tot.E();
-    const double PzTot = tot.Pz();
+    /*const double ETot = tot.e;
+    const double PzTot = tot.pz;
 
     const double q1Pz = (PzTot + ETot)/2.;
     const double q2Pz = (PzTot - ETot)/2.;
@@ -202,17 +176,18 @@ double MEWeight::Integrand(const double* psPoint, const double *weight){
     if(q1Pz > SQRT_S/2. || q2Pz < -SQRT_S/2. || q1Pz < 0. || q2Pz > 0.)
       continue;
   
-    ROOT::Math::PxPyPzEVector parton1(0., 0., q1Pz, q1Pz);
-    ROOT::Math::PxPyPzEVector parton2(0., 0., q2Pz, abs(q2Pz));*/
+    FourVector parton1 = { 0., 0., q1Pz, q1Pz };
+    FourVector parton2 = { 0., 0., q2Pz, abs(q2Pz) };*/
     //////////////////////////////////////////////////////////////////////////////   
     
     //cout << "===> Eext=" << ETot << ", Pzext=" << PzTot << ", q1Pz=" << q1Pz << ", q2Pz=" << q2Pz << endl << endl;
     
     // Compute jacobian from change of variable:
-    vector<ROOT::Math::PxPyPzEVector> momenta( { p1, p2, p3, p4, p5, p6 } );
-    const double jacobian = computeJacobianD(momenta, SQRT_S);
+    const FourVector momenta[6] = { p1, p2, p3, p4, p5, p6 };
+    const double jacobian = kernels.computeJacobianD(momenta, SQRT_S);
+    clock.Lap(StageCounters::KINEMATICS_STAGE);
     if(jacobian <= 0.){
-      cout << "Jac infinite!" << endl;
+      counters.Increment(StageCounters::REJECTED_JACOBIAN);
       continue;
     }
 
@@ -223,77 +198,77 @@ double MEWeight::Integrand(const double* psPoint, const double *weight){
     // Compute flux factor 1/(2*x1*x2*s)
     const double phaseSpaceIn = 1.0 / ( 2. * x1 * x2 * SQ(SQRT_S) ); 
 
-    // Compute phase space density for observed particles (not concerned by the change of variable)
-    // dPhi = |P|^2 sin(theta)/(2*E*(2pi)^3)
-    const double dPhip3 = SQ(p3.P())*sin(p3.Theta())/(2.0*p3.E()*CB(2.*M_PI));
-    const double dPhip4 = SQ(p4.P())*sin(p4.Theta())/(2.0*p4.E()*CB(2.*M_PI));
-    const double dPhip5 = SQ(p5.P())*sin(p5.Theta())/(2.0*p5.E()*CB(2.*M_PI));
-    const double dPhip6 = SQ(p6.P())*sin(p6.Theta())/(2.0*p6.E()*CB(2.*M_PI));
-    const double phaseSpaceOut = dPhip5 * dPhip6 * dPhip3 * dPhip4;
-
-    // Define initial momenta to be passed to matrix element
-    std::vector< std::vector<double> > initialMomenta = 
-    {
-      { parton1.E(), parton1.Px(), parton1.Py(), parton1.Pz() },
-      { parton2.E(), parton2.Px(), parton2.Py(), parton2.Pz() },
-    };
-    
-    // Define final PID and momenta to be passed to matrix element
-    std::vector< std::pair<int, std::vector<double> > > finalState = 
-    {
-      std::make_pair<int, std::vector<double> >( -11, { p3.E(), p3.Px(), p3.Py(), p3.Pz() } ),
-      std::make_pair<int, std::vector<double> >(  12, { p1.E(), p1.Px(), p1.Py(), p1.Pz() } ),
-      std::make_pair<int, std::vector<double> >(   5, { p4.E(), p4.Px(), p4.Py(), p4.Pz() } ),
-      std::make_pair<int, std::vector<double> >(  13, { p5.E(), p5.Px(), p5.Py(), p5.Pz() } ),
-      std::make_pair<int, std::vector<double> >( -14, { p2.E(), p2.Px(), p2.Py(), p2.Pz() } ),
-      std::make_pair<int, std::vector<double> >(  -5, { p6.E(), p6.Px(), p6.Py(), p6.Pz() } ),
-    };
-
-    // Evaluate matrix element
-    std::map< std::pair<int, int>, double > matrixElements = getMatrixElements(initialMomenta, finalState);
-
-    double thisSolResult = phaseSpaceIn * phaseSpaceOut * jacobian * flatterJac * TFreturnValue;
-
-    double pdfMESum = 0.;
-    // If no initial states have been defined explicitly, loop over all states returned by the matrix element
-    if(!_initialStates.size()){
-      for(auto const &me: matrixElements){
-        const double pdf1 = ComputePdf(me.first.first, x1, SQ(M_T));
-        const double pdf2 = ComputePdf(me.first.second, x2, SQ(M_T));
-        pdfMESum += me.second * pdf1 * pdf2;
-        //cout << "Initial state (" << me.first.first << ", " << me.first.second << "): " << me.second << endl;
-      }
-    }else{
-      // Otherwise, loop over all states defined by user
-      for(auto const &initialState: _initialStates){
-        const double pdf1 = ComputePdf(initialState.first, x1, SQ(M_T));
-        const double pdf2 = ComputePdf(initialState.second, x2, SQ(M_T));
-        pdfMESum += matrixElements[initialState] * pdf1 * pdf2;
-        //cout << "Initial state (" << initialState.first << ", " << initialState.second << "): " << matrixElements[initialState] << endl;
-      }
-    }
-
-    thisSolResult *= pdfMESum;
-    returnValue += thisSolResult; 
-    
     // Check whether the next solutions for the neutrinos are the same => don't redo all this!
     int countEqualSol = 1;
     for(unsigned int j = i+1; j<p1vec.size(); j++){
-      if(p1 == p1vec.at(j) && p2 == p2vec.at(j)){
-        returnValue += thisSolResult;
+      if(p1 == p1vec[j] && p2 == p2vec[j])
         countEqualSol++;
-      }
     }
 
+    // The matrix element and PDFs are evaluated later, for the whole batch (see IntegrandMatrixElements)
+    // Momenta in the order of GetFinalState, after the initial partons
+    const FourVector meMomenta[8] = { parton1, parton2, p3, p1, p4, p5, p2, p6 };
+    batch.Add(index, countEqualSol * phaseSpaceIn * jacobian * flatterJac * visiblesWeight, x1, x2, meMomenta);
+
     //cout << "Found PDF1 = " << pdf1_1 << ", PDF2 = " << pdf1_2 << ", PS in = " << PhaseSpaceIn << ", PS out = " << PhaseSpaceOut << ", jac = " << jac << endl;
     //cout << "===> Matrix element = " << matrix_elements1[0] << ", prod = " << thisSolResult << ", multiplicity = " << countEqualSol << endl << endl; 
 
     // If we have included the next solutions already, skip them!
     i += countEqualSol - 1;
-    countSol += countEqualSol;
   }
 
   //cout << "## Phase Space point done. Integrand = " << integrand << ", flatterjac = " << flatterJac << ", prod = " << integrand*flatterJac <<  endl;
+}
+
+void MEWeight::IntegrandMatrixElements(MEBatch &batch, double *values, const int thread){
+  StageCounters &counters = _counters[thread];
+  // Once per batch: always timed
+  StageClock clock(counters, 1);
+
+  MatrixElement &matrixElement = *_matrixElements[thread];
+  const std::vector< std::pair<int, int> > &meStates = matrixElement.GetInitialStates();
+  const int nStates = meStates.size();
+  double *matrixElements = batch.GetValues(nStates);
+
+  // Evaluate matrix elements
+  matrixElement.Evaluate(batch.Size(), batch.GetMomenta(), matrixElements);
+  counters.Increment(StageCounters::MATRIX_ELEMENTS, batch.Size());
+  clock.Lap(StageCounters::MATRIX_ELEMENT_STAGE);
+
+  // If no initial states have been defined explicitly, loop over all states returned by the matrix element,
+  // otherwise over all states defined by user (with a vanishing matrix element if not returned)
+  std::vector< std::pair<int, int> > states = meStates;
+  std::vector<int> stateIndices(nStates);
+  for(int s = 0; s < nStates; ++s)
+    stateIndices[s] = s;
+  if(_initialStates.size()){
+    states = _initialStates;
+    stateIndices.clear();
+    for(auto const &initialState: _initialStates)
+      stateIndices.push_back( find(meStates.begin(), meStates.end(), initialState) - meStates.begin() );
+  }
+
+  // Same matrix elements for all the PDF members, each contributing to its own component
+  const int nMembers = GetNumberOfPdfMembers();
+
+  for(int i = 0; i < batch.Size(); ++i){
+    const double x1 = batch.GetX1(i);
+    const double x2 = batch.GetX2(i);
+
+    for(int member = 0; member < nMembers; ++member){
+      double pdfMESum = 0.;
+      for(size_t s = 0; s < states.size(); ++s){
+        if(stateIndices[s] == nStates)
+          continue;
+        const double pdf1 = ComputePdf(states[s].first, x1, GetPdfScale(), thread, member);
+        const double pdf2 = ComputePdf(states[s].second, x2, GetPdfScale(), thread, member);
+        pdfMESum += matrixElements[i*nStates + stateIndices[s]] * pdf1 * pdf2;
+        //cout << "Initial state (" << states[s].first << ", " << states[s].second << "): " << matrixElements[i*nStates + stateIndices[s]] << endl;
+      }
+
+      values[batch.GetIndex(i)*nMembers + member] += batch.GetFactor(i) * pdfMESum;
+    }
+  }
 
-  return returnValue;
+  clock.Lap(StageCounters::PDF_STAGE);
 }
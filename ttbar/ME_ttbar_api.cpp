@@ -0,0 +1,201 @@
+#include <string>
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+#include "Math/Vector4D.h"
+#include "TStopwatch.h"
+
+#include "SubProcesses/P0_Sigma_sm_gg_mupvmbmumvmxbx/cpp_pp_ttx_fullylept.h"
+
+#include "MEMcpp.h"
+#include "MEWeight.h"
+#include "MEPermutations.h"
+#include "eventSelection.h"
+
+using namespace std;
+
+// Same objects as in ME_ttbar: one MEWeight, and one process per integration thread
+struct MEMcppHandle{
+  MEWeight* weight;
+  vector<cpp_pp_ttx_fullylept*> processes;
+  EventSelection selection;
+  MEPermutations permutations;
+};
+
+void memcpp_default_config(MEMcppConfig *config){
+  const SelectionCuts cuts;
+
+  config->tfFile = nullptr;
+  config->pdfName = "cteq6l1";
+  config->paramCard = "/home/fynu/swertz/scratch/Madgraph/madgraph5/cpp_ttbar_epmum/Cards/param_card.dat";
+  config->integrator = MEMCPP_VEGAS;
+  config->nThreads = 1;
+  config->prune = 0.;
+  config->preScreenPoints = 0;
+  config->preScreenMinWeight = 0.;
+  config->seed = 0;
+  config->tfSampling = 1;
+  for(int i = 0; i < 3; ++i){
+    config->tfTypes[i] = MEMCPP_TF_BINNED;
+    config->tfFiles[i] = nullptr;
+  }
+  config->leptonPtMin = cuts.leptonPtMin;
+  config->leptonEtaMax = cuts.leptonEtaMax;
+  config->jetPtMin = cuts.jetPtMin;
+  config->jetEtaMax = cuts.jetEtaMax;
+  config->bTagMask = cuts.bTagMask;
+  config->maxJets = cuts.maxJets;
+}
+
+MEMcppHandle* memcpp_create(const MEMcppConfig *config){
+  if(!config || !config->tfFile || !config->pdfName || !config->paramCard){
+    cerr << "Error: the configuration needs a TF file, a PDF and a param card." << endl;
+    return nullptr;
+  }
+  if(config->integrator < MEMCPP_VEGAS || config->integrator > MEMCPP_NATIVE || config->nThreads < 1){
+    cerr << "Error: invalid integrator " << config->integrator << " or number of threads " << config->nThreads << "." << endl;
+    return nullptr;
+  }
+
+  const char* particleNames[3] = { "electron", "muon", "jet" };
+  const char* histNames[3] = { "Binned_Egen_DeltaE_Norm_ele", "Binned_Egen_DeltaE_Norm_muon", "Binned_Egen_DeltaE_Norm_jet" };
+  for(int i = 0; i < 3; ++i){
+    if(config->tfTypes[i] < MEMCPP_TF_BINNED || config->tfTypes[i] > MEMCPP_TF_GAUSSIAN || (config->tfTypes[i] == MEMCPP_TF_GAUSSIAN && !config->tfFiles[i])){
+      cerr << "Error: invalid TF type " << config->tfTypes[i] << " for " << particleNames[i] << " (the gaussian TF needs a parameter file)." << endl;
+      return nullptr;
+    }
+  }
+
+  SelectionCuts cuts;
+  cuts.leptonPtMin = config->leptonPtMin;
+  cuts.leptonEtaMax = config->leptonEtaMax;
+  cuts.jetPtMin = config->jetPtMin;
+  cuts.jetEtaMax = config->jetEtaMax;
+  cuts.bTagMask = config->bTagMask;
+  cuts.requireBTag = cuts.bTagMask != 0;
+  cuts.maxJets = config->maxJets;
+
+  MEMcppHandle* handle = new MEMcppHandle{ nullptr, {}, EventSelection(cuts), MEPermutations() };
+
+  handle->processes.push_back( new cpp_pp_ttx_fullylept(config->paramCard) );
+  handle->weight = new MEWeight(*handle->processes[0], config->pdfName, config->tfFile);
+
+  const MEWeight::IntegratorType integrator = static_cast<MEWeight::IntegratorType>(config->integrator);
+  if(integrator == MEWeight::NATIVE_VEGAS){
+    for(int i = 1; i < config->nThreads; ++i){
+      handle->processes.push_back( new cpp_pp_ttx_fullylept(config->paramCard) );
+      handle->weight->AddThreadProcess(*handle->processes.back());
+    }
+  }
+
+  const TFComponent::Type tfTypes[3] = { TFComponent::BINNED, TFComponent::SPLINE, TFComponent::DOUBLE_GAUSSIAN };
+  for(int i = 0; i < 3; ++i)
+    handle->weight->AddTF(particleNames[i], config->tfTypes[i] == MEMCPP_TF_GAUSSIAN ? config->tfFiles[i] : histNames[i], tfTypes[config->tfTypes[i]]);
+
+  handle->weight->SetTFSampling(config->tfSampling != 0);
+  handle->weight->SetPermutationPruning(config->prune);
+  handle->weight->SetPreScreening(config->preScreenPoints, config->preScreenMinWeight);
+  handle->weight->SetIntegrator(integrator);
+  if(config->seed)
+    handle->weight->SetRunSeed(config->seed);
+
+  return handle;
+}
+
+void memcpp_destroy(MEMcppHandle *handle){
+  if(!handle)
+    return;
+
+  delete handle->weight;
+  for(auto &process: handle->processes){
+    delete process; process = nullptr;
+  }
+  delete handle;
+}
+
+int memcpp_compute(MEMcppHandle *handle, const MEMcppEvents *events, MEMcppResults *results){
+  if(!handle || !events || !results || events->nEvents < 0){
+    cerr << "Error: memcpp_compute needs a handle, events and results." << endl;
+    return 1;
+  }
+  const bool missingArrays = !events->positronPt || !events->positronEta || !events->positronPhi || !events->positronE
+    || !events->muonPt || !events->muonEta || !events->muonPhi || !events->muonE
+    || !events->nJets || !events->jetPt || !events->jetEta || !events->jetPhi || !events->jetE
+    || !events->metPt || !events->metPhi
+    || !results->weight || !results->error || !results->time || !results->status;
+  if(missingArrays || (!events->jetBTag && handle->selection.GetCuts().bTagMask)){
+    cerr << "Error: missing event or result arrays (the b-tagging words are needed if the b-tagging mask is not 0)." << endl;
+    return 1;
+  }
+  for(long i = 0; i < events->nEvents; ++i){
+    if(events->nJets[i] < 0 || events->nJets[i] > events->jetStride){
+      cerr << "Error: event " << i << " has " << events->nJets[i] << " jets, more than the jet stride " << events->jetStride << "." << endl;
+      return 1;
+    }
+  }
+
+  MEWeight &weight = *handle->weight;
+  EventSelection &selection = handle->selection;
+  MEPermutations &permutations = handle->permutations;
+  const int nCounters = StageCounters::N_COUNTERS;
+
+  vector<double> weights, errors;
+
+  for(long i = 0; i < events->nEvents; ++i){
+    selection.Clear();
+    selection.AddElectron(ROOT::Math::PtEtaPhiEVector(events->positronPt[i], events->positronEta[i], events->positronPhi[i], events->positronE[i]), 1);
+    selection.AddMuon(ROOT::Math::PtEtaPhiEVector(events->muonPt[i], events->muonEta[i], events->muonPhi[i], events->muonE[i]), -1);
+    for(int j = 0; j < events->nJets[i]; ++j){
+      const long k = i*events->jetStride + j;
+      const bool bTagged = events->jetBTag ? selection.IsBTagged(events->jetBTag[k]) : false;
+      selection.AddJet(ROOT::Math::PtEtaPhiEVector(events->jetPt[k], events->jetEta[k], events->jetPhi[k], events->jetE[k]), bTagged);
+    }
+    selection.SetMet(ROOT::Math::PtEtaPhiEVector(events->metPt[i], 0., events->metPhi[i], events->metPt[i]));
+
+    weight.ResetStageCounters();
+    results->weight[i] = 0.;
+    results->error[i] = 0.;
+    results->time[i] = 0.;
+    results->status[i] = MEMCPP_NOT_SELECTED;
+
+    if(selection.BuildPermutations(permutations)){
+      TStopwatch chrono;
+      chrono.Start();
+
+      weight.SetEventID(events->ids ? events->ids[i] : i);
+      const bool weighted = weight.ComputeWeights(permutations, weights, errors);
+
+      // Average over the permutations, as in ME_ttbar
+      const size_t nPerm = permutations.GetNumberOfPermutations();
+      double sumWeights = 0., sumErrors2 = 0.;
+      for(size_t permutation = 0; permutation < nPerm; permutation++){
+        sumWeights += weights[permutation]/nPerm;
+        sumErrors2 += pow(errors[permutation]/nPerm, 2.);
+      }
+
+      results->weight[i] = sumWeights;
+      results->error[i] = sqrt(sumErrors2);
+      results->time[i] = chrono.CpuTime();
+      results->status[i] = weighted ? MEMCPP_WEIGHTED : MEMCPP_PRESCREENED;
+    }
+
+    if(results->counters){
+      const StageCounters counters = weight.GetStageCounters();
+      for(int k = 0; k < nCounters; ++k)
+        results->counters[i*nCounters + k] = counters.Get(k);
+    }
+  }
+
+  return 0;
+}
+
+int memcpp_n_counters(void){
+  return StageCounters::N_COUNTERS;
+}
+
+const char* memcpp_counter_name(const int counter){
+  if(counter < 0 || counter >= StageCounters::N_COUNTERS)
+    return nullptr;
+  return StageCounters::GetName(counter);
+}
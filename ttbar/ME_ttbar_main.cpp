@@ -1,5 +1,9 @@
 #include <string>
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <map>
 
 #include "classes/DelphesClasses.h"
 
@@ -9,61 +13,362 @@
 #include "TChain.h"
 #include "TFile.h"
 #include "TClonesArray.h"
+#include "TLorentzVector.h"
+#include "TROOT.h"
 
 //#include "SubProcesses/P0_Sigma_sm_gg_epvebmumvmxbx/cpp_test_gg_ttx_epmum_Wb.h"
 #include "SubProcesses/P0_Sigma_sm_gg_mupvmbmumvmxbx/cpp_pp_ttx_fullylept.h"
 //#include "SubProcesses/P0_Sigma_sm_gg_epvebmumvmxbx/CPPProcess.h"
 
 #include "MEWeight.h"
+#include "MEPermutations.h"
+#include "LHCOReader.h"
+#include "eventSelection.h"
+#include "workQueue.h"
+#include "regression.h"
+#include "eventPipeline.h"
+#include "cpuDispatch.h"
+#include "jobTelemetry.h"
+#include "costModel.h"
+#include "weightCache.h"
 
 using namespace std;
 
+// Convert Delphes 4-vectors to the ROOT::Math vectors used in MEWeight
+static ROOT::Math::PtEtaPhiEVector toPtEtaPhiE(const TLorentzVector &v){
+  return ROOT::Math::PtEtaPhiEVector(v.Pt(), v.Eta(), v.Phi(), v.E());
+}
+
 int main(int argc, char *argv[])
 {
+  // Work queue coordinator: distributes the events to the workers started with --queue=socket
+  if(argc > 1 && string(argv[1]) == "coordinator"){
+    if(argc < 6){
+      cerr << "Usage: " << argv[0] << " coordinator socket start_evt end_evt result_file [max_chunk [cost_file]]" << endl;
+      exit(1);
+    }
+    WorkQueueCoordinator coordinator(argv[2], atol(argv[3]), atol(argv[4]), argc > 6 ? atol(argv[6]) : 10, argv[5]);
+    // Predicted costs (see --cost-predict): longest events first
+    if(argc > 7){
+      map<long, double> costs;
+      if(!ReadPredictedCosts(argv[7], costs))
+        exit(1);
+      coordinator.SetPredictedCosts(costs);
+    }
+    coordinator.Run();
+    return coordinator.GetNumberOfFailed() ? 1 : 0;
+  }
+
+  if(argc < 6){
+    cerr << "Usage: " << argv[0] << " input output TF_file start_evt end_evt [--name=value ...]" << endl;
+    exit(1);
+  }
+
   std::string inputFile(argv[1]);
   std::string outputFile(argv[2]);
   std::string fileTF(argv[3]);
   int start_evt = atoi(argv[4]);
   int end_evt = atoi(argv[5]);
 
+  // Optional arguments are given as --name=value after the positional arguments
+  map<string, string> options;
+  for(int i = 6; i < argc; ++i){
+    const string arg(argv[i]);
+    const size_t equal = arg.find('=');
+    if(arg.compare(0, 2, "--") != 0 || equal == string::npos){
+      cerr << "Error: invalid argument " << arg << ", expected --name=value." << endl;
+      exit(1);
+    }
+    options[arg.substr(2, equal - 2)] = arg.substr(equal + 1);
+  }
+  auto numberOption = [&options](const string &name, const double defaultValue){
+    const auto option = options.find(name);
+    return option == options.end() ? defaultValue : atof(option->second.c_str());
+  };
+  auto stringOption = [&options](const string &name, const string &defaultValue){
+    const auto option = options.find(name);
+    return option == options.end() ? defaultValue : option->second;
+  };
+
+  // Permutations whose quick estimate is below this fraction of the largest one are not fully integrated
+  const double pruneThreshold = numberOption("prune", 0.);
+  // If non-zero, the weights of all the members of the PDF set are also computed, in the same integration
+  const bool pdfMembers = numberOption("pdf-members", 0) != 0;
+  const string pdfName = stringOption("pdf", "cteq6l1");
+  // Number of points used for the pre-screening estimate (0 => no pre-screening), and minimal estimated weight
+  const int preScreenPoints = numberOption("prescreen-points", 0);
+  const double preScreenMinWeight = numberOption("prescreen-min", 0.);
+  // Integration engine: CUBA Vegas ("vegas", default), adaptive randomized QMC with Owen-scrambled Sobol points ("sobol") or a rank-1 lattice ("lattice"),
+  // or the built-in multi-threaded Vegas+ ("native")
+  const string integratorName = stringOption("integrator", "vegas");
+  MEWeight::IntegratorType integrator = MEWeight::CUBA_VEGAS;
+  if(integratorName == "sobol"){
+    integrator = MEWeight::QMC_SOBOL;
+  }else if(integratorName == "lattice"){
+    integrator = MEWeight::QMC_LATTICE;
+  }else if(integratorName == "native"){
+    integrator = MEWeight::NATIVE_VEGAS;
+  }else if(integratorName != "vegas"){
+    cerr << "Error: unknown integrator " << integratorName << ", expected vegas, sobol, lattice or native." << endl;
+    exit(1);
+  }
+  // If non-zero, each integration is done with all the engines, and their results and timings are printed
+  const bool compareIntegrators = numberOption("compare-integrators", 0) != 0;
+  // Number of threads of the native Vegas integrator, and files to read the starting grid from / write the last grid to
+  const int nThreads = numberOption("threads", 1);
+  const string vegasGridIn = stringOption("vegas-grid-in", "");
+  const string vegasGridOut = stringOption("vegas-grid-out", "");
+  // Reproducible mode if non-zero: the random numbers of each event are derived from this seed and the entry number
+  const uint64_t runSeed = strtoull(stringOption("seed", "0").c_str(), nullptr, 10);
+  // If set, the events are taken from the work queue instead of the start_evt-end_evt range
+  const string queuePath = stringOption("queue", "");
+  // Number of event slots of the pipeline (0 => no pipeline): the next events are read by one thread
+  // and the results written by another one, while the current event is integrated
+  const int prefetch = numberOption("prefetch", 0);
+  // Regression mode: the events listed in the reference file are processed (instead of start_evt-end_evt), and their
+  // weights, errors and stage counters are compared to the reference values. The results can also be written as a new reference.
+  const string referenceFile = stringOption("reference", "");
+  const string writeReferenceFile = stringOption("write-reference", "");
+  // Job metrics written every telemetry-interval seconds (JSON, or Prometheus text format for .prom files)
+  const string telemetryFile = stringOption("telemetry", "");
+  const double telemetryInterval = numberOption("telemetry-interval", 30.);
+  // Cost model (see costModel.h), without integrating the events of the range: fit it on the times recorded in
+  // cost-timings (output of a past run, or work queue results) and save it to cost-model, or write the costs
+  // predicted by cost-model for each event to cost-predict (used by the coordinator and tools/costSplit.py)
+  const string costTimings = stringOption("cost-timings", "");
+  const string costModelFile = stringOption("cost-model", "");
+  const string costPredict = stringOption("cost-predict", "");
+  if((costTimings.size() || costPredict.size()) && (costModelFile.empty() || queuePath.size())){
+    cerr << "Error: --cost-timings and --cost-predict need --cost-model, and a range of events." << endl;
+    exit(1);
+  }
+  // Cache of the weights in this directory: events already integrated with the same configuration are not integrated again
+  const string weightCacheDir = stringOption("weight-cache", "");
+  if(weightCacheDir.size() && (referenceFile.size() || writeReferenceFile.size())){
+    cerr << "Error: the weight cache can't be used in the regression mode (the stage counters are not cached)." << endl;
+    exit(1);
+  }
+  RegressionTolerances tolerances;
+  tolerances.weightRel = numberOption("tol-weight", tolerances.weightRel);
+  tolerances.weightSigma = numberOption("tol-sigma", tolerances.weightSigma);
+  tolerances.errorRel = numberOption("tol-error", tolerances.errorRel);
+  tolerances.countersRel = numberOption("tol-counters", tolerances.countersRel);
+  vector<RegressionRecord> referenceRecords, records;
+  if(referenceFile.size()){
+    if(queuePath.size()){
+      cerr << "Error: the regression mode can't be used with a work queue." << endl;
+      exit(1);
+    }
+    if(!ReadRegressionFile(referenceFile, referenceRecords))
+      exit(1);
+    cout << "Regression mode: " << referenceRecords.size() << " reference events from " << referenceFile << endl;
+  }
+  
+  // Instruction set of the integrand kernels: "auto" (default) is the best one supported by the CPU
+  const string isaName = stringOption("isa", "auto");
+  if(isaName != "auto"){
+    ISALevel isaLevel;
+    if(!ParseISALevel(isaName, isaLevel)){
+      cerr << "Error: unknown instruction set " << isaName << ", expected auto, generic, sse4, avx2 or avx512." << endl;
+      exit(1);
+    }
+    SelectISALevel(isaLevel);
+  }
+  cout << "Integrand kernels: " << GetISAName(GetISALevel()) << " (CPU supports " << GetISAName(DetectISALevel()) << ")" << endl;
+  
+  // Selection of reconstructed objects
+  SelectionCuts cuts;
+  cuts.leptonPtMin = numberOption("lepton-pt", cuts.leptonPtMin);
+  cuts.leptonEtaMax = numberOption("lepton-eta", cuts.leptonEtaMax);
+  cuts.jetPtMin = numberOption("jet-pt", cuts.jetPtMin);
+  cuts.jetEtaMax = numberOption("jet-eta", cuts.jetEtaMax);
+  cuts.bTagMask = numberOption("btag", cuts.bTagMask);
+  cuts.requireBTag = cuts.bTagMask != 0;
+  cuts.maxJets = numberOption("max-jets", cuts.maxJets);
+  EventSelection selection(cuts);
+
+  // Input files ending in .lhco are read using the native LHCO reader, 
+  // otherwise the input is a Delphes ROOT file, using generator-level particles ("gen", default) or reconstructed objects ("reco")
+  const bool lhcoInput = inputFile.size() > 5 && inputFile.compare(inputFile.size() - 5, 5, ".lhco") == 0;
+  const string inputLevel = stringOption("input", "gen");
+  const bool recoInput = !lhcoInput && inputLevel == "reco";
+  if(inputLevel != "gen" && inputLevel != "reco"){
+    cerr << "Error: unknown input level " << inputLevel << "." << endl;
+    exit(1);
+  }
+
+  // With the pipeline, ROOT objects are used from several threads
+  if(prefetch > 0)
+    ROOT::EnableThreadSafety();
+
+  // Addresses the input branches are read into
+  struct InputBranches{
+    double madWeight = 0., madWeightError = 0.;
+    TClonesArray *gen = nullptr, *electron = nullptr, *muon = nullptr, *jet = nullptr, *met = nullptr;
+  };
+
   // Create chain of root trees
-  TChain chain("Delphes");
-  chain.Add(inputFile.c_str());
+  // With the pipeline, the events are decoded by the reader thread from a second chain, while the output tree
+  // copies the input branches of the first one, read again by the writer thread
+  TChain chain("Delphes"), prefetchChain("Delphes");
+  InputBranches chainInput, prefetchInput;
+  LHCOReader* lhcoReader = nullptr;
+  LHCOEvent lhcoEvent;
+  long entries = 0;
+  bool hasMadWeight = false;
+
+  auto setupChain = [&](TChain &inputChain, InputBranches &input){
+    inputChain.Add(inputFile.c_str());
+
+    // Only read the branches (and the members of the objects) we need
+    inputChain.SetBranchStatus("*", 0);
 
-  double MadWeight, MadWeight_Error;
-  chain.SetBranchAddress("Weight_TT", &MadWeight);
-  chain.SetBranchAddress("Weight_TT_Error", &MadWeight_Error);
+    if(inputChain.GetBranch("Weight_TT")){
+      hasMadWeight = true;
+      inputChain.SetBranchStatus("Weight_TT", 1);
+      inputChain.SetBranchStatus("Weight_TT_Error", 1);
+      inputChain.SetBranchAddress("Weight_TT", &input.madWeight);
+      inputChain.SetBranchAddress("Weight_TT_Error", &input.madWeightError);
+    }
+
+    // Get pointers to branches used in this analysis
+    if(recoInput){
+      const vector<string> readBranches = { 
+        "Electron.PT", "Electron.Eta", "Electron.Phi", "Electron.Charge",
+        "Muon.PT", "Muon.Eta", "Muon.Phi", "Muon.Charge",
+        "Jet.PT", "Jet.Eta", "Jet.Phi", "Jet.Mass", "Jet.BTag",
+        "MissingET.MET", "MissingET.Eta", "MissingET.Phi" 
+      };
+      for(const string &branch: readBranches)
+        inputChain.SetBranchStatus(branch.c_str(), 1);
 
-  // Get pointers to branches used in this analysis
-  TClonesArray *branchGen = NULL;
-  chain.SetBranchAddress("Particle", &branchGen);
+      inputChain.SetBranchAddress("Electron", &input.electron);
+      inputChain.SetBranchAddress("Muon", &input.muon);
+      inputChain.SetBranchAddress("Jet", &input.jet);
+      inputChain.SetBranchAddress("MissingET", &input.met);
+    }else{
+      const vector<string> readBranches = { "Particle.Status", "Particle.PID", "Particle.Px", "Particle.Py", "Particle.Pz", "Particle.E" };
+      for(const string &branch: readBranches)
+        inputChain.SetBranchStatus(branch.c_str(), 1);
+      
+      inputChain.SetBranchAddress("Particle", &input.gen);
+    }
+  };
+  
+  if(lhcoInput){
+    lhcoReader = new LHCOReader(inputFile);
+    entries = lhcoReader->GetEntries();
+  }else{
+    setupChain(chain, chainInput);
+    if(prefetch > 0)
+      setupChain(prefetchChain, prefetchInput);
+    entries = chain.GetEntries();
+  }
+  // Chain used to decode the events
+  TChain &inputChain = prefetch > 0 ? prefetchChain : chain;
+  InputBranches &input = prefetch > 0 ? prefetchInput : chainInput;
 
-  cout << "Entries:" << chain.GetEntries() << endl;
+  cout << "Entries:" << entries << endl;
 
   TFile* outFile = new TFile(outputFile.c_str(), "RECREATE");
-  TTree* outTree = chain.CloneTree(0);
+  TTree* outTree = nullptr;
+  long eventNumber = 0;
+  if(lhcoInput){
+    // Same tree name as for Delphes inputs, so that the same tools can be used on the output
+    outTree = new TTree("Delphes", "MEMcpp weights");
+    outTree->Branch("Event", &eventNumber);
+  }else{
+    // Only the branches which have been read are copied
+    outTree = chain.CloneTree(0);
+  }
 
   double Weight_TT_cpp, Weight_TT_Error_cpp;
   bool Weighted_TT_cpp;
   double time;
+  long Entry;
+  outTree->Branch("Entry", &Entry);
   outTree->Branch("Weight_TT_cpp", &Weight_TT_cpp);
   outTree->Branch("Weight_TT_Error_cpp", &Weight_TT_Error_cpp);
   outTree->Branch("Weighted_TT_cpp", &Weighted_TT_cpp);
   outTree->Branch("Weight_TT_cpp_me", &time);
+  // Weights of the PDF members (the first one is the central member)
+  vector<double> Weight_TT_cpp_pdf, Weight_TT_Error_cpp_pdf;
+  if(pdfMembers){
+    outTree->Branch("Weight_TT_cpp_pdf", &Weight_TT_cpp_pdf);
+    outTree->Branch("Weight_TT_Error_cpp_pdf", &Weight_TT_Error_cpp_pdf);
+  }
 
-  if(end_evt >= chain.GetEntries())
-    end_evt = chain.GetEntries()-1;
+  if(end_evt >= entries)
+    end_evt = entries-1;
 
   //_process = new cpp_test_gg_ttx_epmum_Wb(paramCardPath);
   //_process = new CPPProcess();
   //_process->initProc(paramCardPath);
   // Create CPPProcess and MEWeight objects
-  cpp_pp_ttx_fullylept myProcess("/home/fynu/swertz/scratch/Madgraph/madgraph5/cpp_ttbar_epmum/Cards/param_card.dat");
-  MEWeight* myWeight = new MEWeight(myProcess, "cteq6l1", fileTF);
+  const string paramCard("/home/fynu/swertz/scratch/Madgraph/madgraph5/cpp_ttbar_epmum/Cards/param_card.dat");
+  cpp_pp_ttx_fullylept myProcess(paramCard);
+  MEWeight* myWeight = nullptr;
+  
+  // Each additional integration thread uses its own process instance
+  const int nProcesses = (integrator == MEWeight::NATIVE_VEGAS || compareIntegrators) ? nThreads : 1;
+  vector<cpp_pp_ttx_fullylept*> threadProcesses;
+  myWeight = new MEWeight(myProcess, pdfName, fileTF);
+  for(int i = 1; i < nProcesses; ++i){
+    threadProcesses.push_back( new cpp_pp_ttx_fullylept(paramCard) );
+    myWeight->AddThreadProcess(*threadProcesses.back());
+  }
   
-  myWeight->AddTF("electron", "Binned_Egen_DeltaE_Norm_ele");
-  myWeight->AddTF("muon", "Binned_Egen_DeltaE_Norm_muon");
-  myWeight->AddTF("jet", "Binned_Egen_DeltaE_Norm_jet");
+  // TF of each particle: "binned" (default) or "spline" histogram from the TF file, or "gaussian:FILE" (double-Gaussian with parameters from FILE)
+  auto addTF = [&](const string &particleName, const string &histName){
+    const string type = stringOption("tf-" + particleName, "binned");
+    if(type == "binned"){
+      myWeight->AddTF(particleName, histName, TFComponent::BINNED);
+    }else if(type == "spline"){
+      myWeight->AddTF(particleName, histName, TFComponent::SPLINE);
+    }else if(type.compare(0, 9, "gaussian:") == 0){
+      myWeight->AddTF(particleName, type.substr(9), TFComponent::DOUBLE_GAUSSIAN);
+    }else{
+      cerr << "Error: unknown TF type " << type << " for " << particleName << ", expected binned, spline or gaussian:FILE." << endl;
+      exit(1);
+    }
+  };
+  addTF("electron", "Binned_Egen_DeltaE_Norm_ele");
+  addTF("muon", "Binned_Egen_DeltaE_Norm_muon");
+  addTF("jet", "Binned_Egen_DeltaE_Norm_jet");
+  // Sample the energies of the visible particles from their TF (default), or uniformly over the TF range
+  myWeight->SetTFSampling(numberOption("tf-sampling", 1) != 0);
+
+  myWeight->SetPdfMembers(pdfMembers);
+  myWeight->SetPermutationPruning(pruneThreshold);
+  myWeight->SetPreScreening(preScreenPoints, preScreenMinWeight);
+  myWeight->SetIntegrator(integrator, compareIntegrators);
+  if(vegasGridIn != "")
+    myWeight->LoadVegasGrid(vegasGridIn);
+  if(runSeed){
+    cout << "Reproducible mode, run seed " << runSeed << endl;
+    myWeight->SetRunSeed(runSeed);
+  }
+
+  // Everything the weights depend on, besides the event itself
+  WeightCache* weightCache = nullptr;
+  if(weightCacheDir.size()){
+    ostringstream configuration;
+    configuration.precision(17);
+    configuration << "process cpp_pp_ttx_fullylept " << HashFile(paramCard);
+    configuration << "\nTF " << HashFile(fileTF);
+    for(const string particleName: { "electron", "muon", "jet" }){
+      const string type = stringOption("tf-" + particleName, "binned");
+      configuration << " " << particleName << " " << (type.compare(0, 9, "gaussian:") == 0 ? "gaussian " + HashFile(type.substr(9)) : type);
+    }
+    configuration << " sampling " << (numberOption("tf-sampling", 1) != 0);
+    configuration << "\nPDF " << pdfName << " members " << pdfMembers;
+    configuration << "\nintegrator " << integratorName << " prune " << pruneThreshold << " prescreen " << preScreenPoints << " " << preScreenMinWeight;
+    configuration << " seed " << runSeed << " grid " << (vegasGridIn.size() ? HashFile(vegasGridIn) : "none");
+    // The kernels of the ISA levels can differ in the last bits (FMA)
+    configuration << "\nISA " << GetISAName(GetISALevel());
+    weightCache = new WeightCache(weightCacheDir, configuration.str());
+    cout << "Weight cache in " << weightCacheDir << " (code version " << WeightCache::codeVersion << ", build " << (WeightCache::GetBuildId().size() ? WeightCache::GetBuildId() : "unknown") << ")" << endl;
+  }
 
   /*myWeight->AddInitialState(21, 21);
   myWeight->AddInitialState(1, -1);
@@ -71,79 +376,360 @@ int main(int argc, char *argv[])
   myWeight->AddInitialState(3, -3);
   myWeight->AddInitialState(4, -4);*/
 
-  for(int entry = start_evt; entry <= end_evt ; ++entry){
-    // Load selected branches with data from specified event
-    chain.GetEntry(entry);
+  // Everything needed to compute and store one event. The slots are allocated once, and reused from one event to the next.
+  struct EventSlot{
+    long entry = 0;
+    long eventNumber = 0;
+    bool selected = false;
+    MEPermutations permutations;
+    double madWeight = 0., madWeightError = 0.;
+    double weight = 0., error = 0., time = 0., realTime = 0.;
+    std::vector<double> memberWeights, memberErrors;
+    bool weighted = false;
+    StageCounters counters;
+  };
+
+  // Read and select the objects of an entry, and build the permutations
+  auto readEvent = [&](const long entry, EventSlot &slot){
+    slot.entry = entry;
+    slot.selected = true;
+
+    if(lhcoInput){
+      lhcoReader->ReadEntry(entry, lhcoEvent);
+      slot.eventNumber = lhcoEvent.number;
+
+      selection.Clear();
+      for(const LHCOObject &object: lhcoEvent.objects){
+        if(object.type == LHCO_ELECTRON)
+          selection.AddElectron(object.GetP4(), object.GetCharge());
+        else if(object.type == LHCO_MUON)
+          selection.AddMuon(object.GetP4(), object.GetCharge());
+        else if(object.type == LHCO_JET)
+          selection.AddJet(object.GetP4(), object.IsBTagged());
+        else if(object.type == LHCO_MET)
+          selection.SetMet(object.GetP4());
+      }
+      slot.selected = selection.BuildPermutations(slot.permutations);
+    
+    }else if(recoInput){
+      // Load selected branches with data from specified event
+      inputChain.GetEntry(entry);
+
+      selection.Clear();
+      for(int i = 0; i < input.electron->GetEntriesFast(); i++){
+        const Electron* electron = (Electron*) input.electron->At(i);
+        selection.AddElectron(toPtEtaPhiE(electron->P4()), electron->Charge);
+      }
+      for(int i = 0; i < input.muon->GetEntriesFast(); i++){
+        const Muon* muon = (Muon*) input.muon->At(i);
+        selection.AddMuon(toPtEtaPhiE(muon->P4()), muon->Charge);
+      }
+      for(int i = 0; i < input.jet->GetEntriesFast(); i++){
+        const Jet* jet = (Jet*) input.jet->At(i);
+        selection.AddJet(toPtEtaPhiE(jet->P4()), selection.IsBTagged(jet->BTag));
+      }
+      if(input.met->GetEntriesFast())
+        selection.SetMet( toPtEtaPhiE( ((MissingET*) input.met->At(0))->P4() ) );
+      slot.selected = selection.BuildPermutations(slot.permutations);
+    
+    }else{
+      // Load selected branches with data from specified event
+      inputChain.GetEntry(entry);
 
-    ROOT::Math::PtEtaPhiEVector gen_ep, gen_mum, gen_b, gen_bbar, gen_nue, gen_num, gen_Met;
+      ROOT::Math::PtEtaPhiEVector gen_ep, gen_mum, gen_b, gen_bbar, gen_nue, gen_num, gen_Met;
 
-    GenParticle *gen;
+      GenParticle *gen;
 
-    for (int i = 0; i < branchGen->GetEntries(); i++){
-      gen = (GenParticle*) branchGen->At(i);
-      //cout << "Status=" << gen->Status << ", PID=" << gen->PID << ", E=" << gen->P4().E() << endl;
-      if (gen->Status == 1){
-        if (gen->PID == -11) gen_ep.SetCoordinates(gen->P4().Pt(), gen->P4().Eta(), gen->P4().Phi(), gen->P4().E());
-        else if (gen->PID == 13) gen_mum.SetCoordinates(gen->P4().Pt(), gen->P4().Eta(), gen->P4().Phi(), gen->P4().E());
-        else if (gen->PID == 12) gen_nue.SetCoordinates(gen->P4().Pt(), gen->P4().Eta(), gen->P4().Phi(), gen->P4().E());
-        else if (gen->PID == -14) gen_num.SetCoordinates(gen->P4().Pt(), gen->P4().Eta(), gen->P4().Phi(), gen->P4().E());
-        else if (gen->PID == 5) gen_b.SetCoordinates(gen->P4().Pt(), gen->P4().Eta(), gen->P4().Phi(), gen->P4().E());
-        else if (gen->PID == -5) gen_bbar.SetCoordinates(gen->P4().Pt(), gen->P4().Eta(), gen->P4().Phi(), gen->P4().E());
+      for (int i = 0; i < input.gen->GetEntries(); i++){
+        gen = (GenParticle*) input.gen->At(i);
+        //cout << "Status=" << gen->Status << ", PID=" << gen->PID << ", E=" << gen->P4().E() << endl;
+        if (gen->Status == 1){
+          if (gen->PID == -11) gen_ep.SetCoordinates(gen->P4().Pt(), gen->P4().Eta(), gen->P4().Phi(), gen->P4().E());
+          else if (gen->PID == 13) gen_mum.SetCoordinates(gen->P4().Pt(), gen->P4().Eta(), gen->P4().Phi(), gen->P4().E());
+          else if (gen->PID == 12) gen_nue.SetCoordinates(gen->P4().Pt(), gen->P4().Eta(), gen->P4().Phi(), gen->P4().E());
+          else if (gen->PID == -14) gen_num.SetCoordinates(gen->P4().Pt(), gen->P4().Eta(), gen->P4().Phi(), gen->P4().E());
+          else if (gen->PID == 5) gen_b.SetCoordinates(gen->P4().Pt(), gen->P4().Eta(), gen->P4().Phi(), gen->P4().E());
+          else if (gen->PID == -5) gen_bbar.SetCoordinates(gen->P4().Pt(), gen->P4().Eta(), gen->P4().Phi(), gen->P4().E());
+        }
       }
+
+      gen_Met = gen_num + gen_nue;
+      
+      slot.permutations.SetObjects(gen_ep, gen_mum, { gen_b, gen_bbar }, gen_Met);
     }
 
-    gen_Met = gen_num + gen_nue;
+    slot.madWeight = input.madWeight;
+    slot.madWeightError = input.madWeightError;
+  };
 
-    cout << "From MadGraph:" << endl;
+  // Integrate all the permutations of a selected event
+  auto computeEvent = [&](EventSlot &slot){
+    myWeight->ResetStageCounters();
+    slot.weight = 0.;
+    slot.error = 0.;
+    slot.weighted = false;
+    slot.time = 0.;
+    slot.realTime = 0.;
+    const int nMembers = myWeight->GetNumberOfPdfMembers();
+    slot.memberWeights.assign(pdfMembers ? nMembers : 0, 0.);
+    slot.memberErrors.assign(pdfMembers ? nMembers : 0, 0.);
+
+    if(!slot.selected){
+      cout << "Event " << slot.entry << " does not pass the selection, skipping it." << endl << endl;
+      slot.counters = myWeight->GetStageCounters();
+      return;
+    }
+
+    const MEPermutations &permutations = slot.permutations;
+    const MEEvent &firstPermutation = permutations.GetPermutation(0);
+    cout << "Selected objects:" << endl;
     cout << "Electron" << endl;
-    cout << gen_ep.E() << "," << gen_ep.Px() << "," << gen_ep.Py() << "," << gen_ep.Pz() << endl;
+    cout << firstPermutation.GetP3().E() << "," << firstPermutation.GetP3().Px() << "," << firstPermutation.GetP3().Py() << "," << firstPermutation.GetP3().Pz() << endl;
     cout << "b quark" << endl;
-    cout << gen_b.E() << "," << gen_b.Px() << "," << gen_b.Py() << "," << gen_b.Pz() << endl;
+    cout << firstPermutation.GetP4().E() << "," << firstPermutation.GetP4().Px() << "," << firstPermutation.GetP4().Py() << "," << firstPermutation.GetP4().Pz() << endl;
     cout << "Muon" << endl;
-    cout << gen_mum.E() << "," << gen_mum.Px() << "," << gen_mum.Py() << "," << gen_mum.Pz() << endl;
+    cout << firstPermutation.GetP5().E() << "," << firstPermutation.GetP5().Px() << "," << firstPermutation.GetP5().Py() << "," << firstPermutation.GetP5().Pz() << endl;
     cout << "Anti b quark" << endl;
-    cout << gen_bbar.E() << "," << gen_bbar.Px() << "," << gen_bbar.Py() << "," << gen_bbar.Pz() << endl;
+    cout << firstPermutation.GetP6().E() << "," << firstPermutation.GetP6().Px() << "," << firstPermutation.GetP6().Py() << "," << firstPermutation.GetP6().Pz() << endl;
     cout << "MET" << endl;
-    cout << gen_Met.E() << "," << gen_Met.Px() << "," << gen_Met.Py() << "," << gen_Met.Pz() << endl << endl;
+    cout << firstPermutation.GetMet().E() << "," << firstPermutation.GetMet().Px() << "," << firstPermutation.GetMet().Py() << "," << firstPermutation.GetMet().Pz() << endl << endl;
+
+    // The entry number only matters in the reproducible mode, where it determines the random numbers
+    string cacheKey;
+    if(weightCache){
+      cacheKey = weightCache->GetKey(permutations, runSeed ? slot.entry : -1);
+      WeightCache::Result cached;
+      if(weightCache->Lookup(cacheKey, cached)){
+        slot.weighted = cached.weighted;
+        slot.weight = cached.weight;
+        slot.error = cached.error;
+        slot.time = cached.time;
+        if(pdfMembers){
+          slot.memberWeights = cached.memberWeights;
+          slot.memberErrors = cached.memberErrors;
+        }
+        slot.counters = myWeight->GetStageCounters();
+        cout << "====> Event " << slot.entry << ": weight = " << slot.weight << " +- " << slot.error << " (from the weight cache)" << endl << endl;
+        return;
+      }
+    }
 
-    Weight_TT_cpp = 0.;
-    Weight_TT_Error_cpp = 0.;
-    time = 0.;
-  
     TStopwatch chrono;
     chrono.Start();
 
-    for(int permutation = 1; permutation <= 2; permutation++){
-      double weight = 0;
-      double error = 0;
-
-      if(permutation == 1)
-        myWeight->SetEvent(gen_ep, gen_mum, gen_b, gen_bbar, gen_Met);
-      if(permutation == 2)
-        myWeight->SetEvent(gen_ep, gen_mum, gen_bbar, gen_b, gen_Met);
-
-      weight = myWeight->ComputeWeight(error)/2.; 
+    // All the possible assignments of the jets to the b and anti-b quarks are integrated at once
+    const size_t nPerm = permutations.GetNumberOfPermutations();
+    
+    vector<double> weights, errors;
+    // If the event is rejected by the pre-screening, the weight is only a rough estimate
+    myWeight->SetEventID(slot.entry);
+    slot.weighted = myWeight->ComputeWeights(permutations, weights, errors);
 
-      Weight_TT_cpp += weight;
-      Weight_TT_Error_cpp += pow(error/2,2.);
+    for(size_t permutation = 0; permutation < nPerm; permutation++){
+      slot.weight += weights[permutation]/nPerm;
+      slot.error += pow(errors[permutation]/nPerm, 2.);
+    }
+    // Same combination of the permutations for each PDF member
+    const vector<double> &memberWeights = myWeight->GetMemberWeights();
+    const vector<double> &memberErrors = myWeight->GetMemberErrors();
+    for(size_t member = 0; member < slot.memberWeights.size(); ++member){
+      for(size_t permutation = 0; permutation < nPerm; permutation++){
+        slot.memberWeights[member] += memberWeights[permutation*nMembers + member]/nPerm;
+        slot.memberErrors[member] += pow(memberErrors[permutation*nMembers + member]/nPerm, 2.);
+      }
+      slot.memberErrors[member] = TMath::Sqrt(slot.memberErrors[member]);
     }
 
-    time = chrono.CpuTime();
+    slot.time = chrono.CpuTime();
+    slot.realTime = chrono.RealTime();
     
-    Weight_TT_Error_cpp = TMath::Sqrt(Weight_TT_Error_cpp);
-    Weighted_TT_cpp = true;
+    slot.error = TMath::Sqrt(slot.error);
+    slot.counters = myWeight->GetStageCounters();
 
-    cout << "====> Event " << entry << ": weight = " << Weight_TT_cpp << " +- " << Weight_TT_Error_cpp << endl;
+    if(weightCache)
+      weightCache->Store(cacheKey, { slot.weighted, slot.weight, slot.error, slot.time, slot.memberWeights, slot.memberErrors });
+
+    cout << "====> Event " << slot.entry << ": weight = " << slot.weight << " +- " << slot.error << endl;
     cout << "      CPU time : " << chrono.CpuTime() << "  Real-time : " << chrono.RealTime() << endl;
-    cout << "      MadWeight: " << MadWeight << " +- " << MadWeight_Error << endl << endl;
+    if(hasMadWeight)
+      cout << "      MadWeight: " << slot.madWeight << " +- " << slot.madWeightError << endl;
+    cout << endl;
+  };
+
+  WorkQueueClient* queue = nullptr;
+  JobTelemetry* telemetry = nullptr;
+
+  // Fill the output tree, and send the result to the work queue
+  auto writeEvent = [&](const EventSlot &slot){
+    // The input branches copied to the output tree are read again
+    if(prefetch > 0 && !lhcoInput)
+      chain.GetEntry(slot.entry);
 
+    Entry = slot.entry;
+    eventNumber = slot.eventNumber;
+    Weight_TT_cpp = slot.weight;
+    Weight_TT_Error_cpp = slot.error;
+    Weighted_TT_cpp = slot.weighted;
+    Weight_TT_cpp_pdf = slot.memberWeights;
+    Weight_TT_Error_cpp_pdf = slot.memberErrors;
+    time = slot.time;
     outTree->Fill();
+
+    const RegressionRecord::Status status = !slot.selected ? RegressionRecord::NOT_SELECTED : slot.weighted ? RegressionRecord::WEIGHTED : RegressionRecord::PRESCREENED;
+    records.push_back( { slot.entry, status, slot.weight, slot.error, slot.time, slot.counters } );
+
+    if(queue)
+      queue->SendResult(slot.entry, slot.weight, slot.error, slot.time, slot.weighted ? QUEUE_WEIGHTED : QUEUE_NOT_WEIGHTED);
+    if(telemetry)
+      telemetry->AddEvent(slot.realTime, slot.time, slot.selected, slot.counters);
+  };
+
+  // Events to process: from the work queue, the regression reference, or the start_evt-end_evt range
+  vector<long> chunk;
+  size_t nextIndex = 0;
+  long nextEntry = start_evt;
+  auto getNextEntry = [&](long &entry){
+    if(queue){
+      while(true){
+        if(nextIndex == chunk.size()){
+          if(!queue->NextChunk(chunk))
+            return false;
+          nextIndex = 0;
+          continue;
+        }
+        entry = chunk[nextIndex++];
+        if(entry < entries)
+          return true;
+        // Not in the input: reported as failed, so that it can't be mistaken for a zero weight
+        cerr << "Warning: entry " << entry << " from the work queue is not in the input (" << entries << " entries)." << endl;
+        queue->SendResult(entry, 0., 0., 0., QUEUE_FAILED);
+      }
+    }else if(referenceFile.size()){
+      while(nextIndex < referenceRecords.size()){
+        entry = referenceRecords[nextIndex++].entry;
+        if(entry < entries)
+          return true;
+      }
+      return false;
+    }else{
+      if(nextEntry > end_evt)
+        return false;
+      entry = nextEntry++;
+      return true;
+    }
+  };
+
+  if(costTimings.size() || costPredict.size()){
+    CostModel costModel;
+    map<long, double> times;
+    if(costTimings.size() ? !ReadRecordedTimes(costTimings, times) : !costModel.Load(costModelFile))
+      exit(1);
+    ofstream predictions;
+    if(costPredict.size())
+      predictions.open(costPredict);
+
+    EventSlot slot;
+    long entry;
+    while(getNextEntry(entry)){
+      readEvent(entry, slot);
+      if(costTimings.size()){
+        const auto time = times.find(entry);
+        if(slot.selected && time != times.end())
+          costModel.AddSample(CostModel::GetFeatures(slot.permutations), time->second);
+      }else{
+        // Events failing the selection are not integrated
+        predictions << entry << " " << (slot.selected ? costModel.Predict(CostModel::GetFeatures(slot.permutations)) : 0.) << "\n";
+      }
+    }
+
+    if(costTimings.size()){
+      if(!costModel.Fit() || !costModel.Save(costModelFile))
+        exit(1);
+      cout << "Cost model fitted on " << costModel.GetNumberOfSamples() << " events (resolution on log(time): " << costModel.GetResolution() << "), written to " << costModelFile << endl;
+    }else if(!predictions.flush()){
+      cerr << "Error writing predicted costs to " << costPredict << "." << endl;
+      exit(1);
+    }else{
+      cout << "Predicted costs written to " << costPredict << endl;
+    }
+    
+    outFile->cd();
+    outTree->Write();
+    delete outFile; outFile = nullptr;
+    return 0;
   }
+
+  TStopwatch jobChrono;
+  jobChrono.Start();
+
+  if(queuePath.size())
+    queue = new WorkQueueClient(queuePath);
+  if(telemetryFile.size()){
+    telemetry = new JobTelemetry(telemetryFile, outputFile, telemetryInterval);
+    if(referenceFile.size())
+      telemetry->SetTotalEvents(referenceRecords.size());
+    else if(!queue)
+      telemetry->SetTotalEvents(max(end_evt - start_evt + 1, 0));
+  }
+
+  if(prefetch > 0){
+    // Pipeline: the next events are read, and the results written, while the current event is integrated
+    vector<EventSlot> slots(prefetch);
+    EventPipeline pipeline(prefetch);
+    pipeline.Run(
+      [&](const size_t i){
+        long entry;
+        if(!getNextEntry(entry))
+          return false;
+        readEvent(entry, slots[i]);
+        return true;
+      },
+      [&](const size_t i){ computeEvent(slots[i]); },
+      [&](const size_t i){ writeEvent(slots[i]); }
+    );
+  }else{
+    EventSlot slot;
+    long entry;
+    while(getNextEntry(entry)){
+      readEvent(entry, slot);
+      computeEvent(slot);
+      writeEvent(slot);
+    }
+  }
+
+  jobChrono.Stop();
+  // Final snapshot
+  delete telemetry; telemetry = nullptr;
+  cout << "Processed " << records.size() << " events in " << jobChrono.RealTime() << " s (real time), " << jobChrono.CpuTime() << " s (CPU time)";
+  if(jobChrono.RealTime() > 0.)
+    cout << ": " << 3600.*records.size()/jobChrono.RealTime() << " events/hour";
+  cout << endl;
+
+  if(weightCache)
+    cout << "Weight cache: " << weightCache->GetHits() << " hits, " << weightCache->GetMisses() << " misses" << endl;
+
+  if(writeReferenceFile.size() && WriteRegressionFile(writeReferenceFile, records))
+    cout << "Reference weights written to " << writeReferenceFile << endl;
+
+  int nFailed = 0;
+  if(referenceFile.size())
+    nFailed = CompareRegression(referenceRecords, records, tolerances);
   
   outFile->cd();
   outTree->Write();
   
+  if(vegasGridOut != "")
+    myWeight->SaveVegasGrid(vegasGridOut);
+
   delete myWeight; myWeight = nullptr;
+  for(auto &process: threadProcesses){
+    delete process; process = nullptr;
+  }
+  delete queue; queue = nullptr;
+  delete weightCache; weightCache = nullptr;
+  delete lhcoReader; lhcoReader = nullptr;
   delete outFile; outFile = nullptr;
+
+  return nFailed ? 1 : 0;
 }
 